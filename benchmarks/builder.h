@@ -0,0 +1,243 @@
+#ifndef MVE_BENCHMARK_BUILDER_H
+#define MVE_BENCHMARK_BUILDER_H
+
+/**
+ * A small helper to write MicroVE programs in C, with labels for the jumps.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define BUILDER_CAPACITY 65536
+#define BUILDER_LABELS 32
+#define BUILDER_FIXUPS 128
+
+
+typedef struct {
+    uint8_t data[BUILDER_CAPACITY];
+    uint32_t size;
+
+    uint32_t labels[BUILDER_LABELS];            // Program index of each label.
+
+    uint32_t fixups[BUILDER_FIXUPS];            // Where the program index of a label must be written, once it is known.
+    uint8_t fixup_labels[BUILDER_FIXUPS];
+    uint32_t fixups_count;
+} Builder;
+
+
+static void builder_u8(Builder *b, uint8_t value)
+{
+    b->data[b->size++] = value;
+}
+
+
+static void builder_u16(Builder *b, uint16_t value)
+{
+    builder_u8(b, value & 0xFF);
+    builder_u8(b, value >> 8);
+}
+
+
+static void builder_u32(Builder *b, uint32_t value)
+{
+    builder_u16(b, value & 0xFFFF);
+    builder_u16(b, value >> 16);
+}
+
+
+/**
+ * @brief Sets a label at the current position.
+ */
+static void builder_label(Builder *b, uint8_t label)
+{
+    b->labels[label] = b->size;
+}
+
+
+/**
+ * @brief Writes the program index of a label, which may be set later.
+ */
+static void builder_ref(Builder *b, uint8_t label)
+{
+    b->fixups[b->fixups_count] = b->size;
+    b->fixup_labels[b->fixups_count] = label;
+    b->fixups_count++;
+
+    builder_u32(b, 0);
+}
+
+
+/**
+ * @brief Starts a program with the given external functions and main scope memory.
+ *
+ * @param names External function names.
+ * @param names_count Amount of external functions.
+ * @param memory Initial bytes of the main scope. Can be NULL if length is 0.
+ * @param length Amount of initial bytes.
+ * @param zero_length Amount of zero filled bytes after the initial ones.
+ */
+static void builder_begin(Builder *b, const char **names, uint32_t names_count, const uint8_t *memory, uint32_t length, uint32_t zero_length)
+{
+    memset(b, 0, sizeof(Builder));
+
+    builder_u16(b, MVE_VERSION_MAJOR);
+    builder_u16(b, MVE_VERSION_MINOR);
+    builder_u8(b, MVE_HEADER_END);
+
+    builder_u32(b, names_count);
+
+    for (uint32_t i = 0; i < names_count; i++) {
+        memcpy(b->data + b->size, names[i], strlen(names[i]) + 1);
+        b->size += strlen(names[i]) + 1;
+    }
+
+    if (zero_length == 0)
+    {
+        builder_u32(b, length);
+    }
+    else
+    {
+        builder_u32(b, length | MVE_SCOPE_ZERO_FILL);
+        builder_u32(b, zero_length);
+    }
+
+    for (uint32_t i = 0; i < length; i++)
+        builder_u8(b, memory[i]);
+}
+
+
+/**
+ * @brief Writes the program indices of the labels into the jumps.
+ */
+static void builder_end(Builder *b)
+{
+    for (uint32_t i = 0; i < b->fixups_count; i++) {
+        uint32_t at = b->fixups[i];
+        uint32_t index = b->labels[b->fixup_labels[i]];
+
+        b->data[at] = index & 0xFF;
+        b->data[at + 1] = (index >> 8) & 0xFF;
+        b->data[at + 2] = (index >> 16) & 0xFF;
+        b->data[at + 3] = index >> 24;
+    }
+}
+
+
+static void emit_ldi(Builder *b, uint8_t reg, uint32_t value)
+{
+    builder_u8(b, MVE_OP_LDI);
+    builder_u8(b, reg);
+    builder_u8(b, 4);
+    builder_u32(b, value);
+}
+
+
+static void emit_rrr(Builder *b, uint8_t op, uint8_t reg_result, uint8_t reg_op1, uint8_t reg_op2)
+{
+    builder_u8(b, op);
+    builder_u8(b, reg_result);
+    builder_u8(b, reg_op1);
+    builder_u8(b, reg_op2);
+}
+
+
+static void emit_r(Builder *b, uint8_t op, uint8_t reg)
+{
+    builder_u8(b, op);
+    builder_u8(b, reg);
+}
+
+
+static void emit_cmp(Builder *b, uint8_t operation, uint8_t reg_result, uint8_t reg_op1, uint8_t reg_op2)
+{
+    builder_u8(b, MVE_OP_CMP);
+    emit_rrr(b, operation, reg_result, reg_op1, reg_op2);
+}
+
+
+static void emit_jmp(Builder *b, uint8_t label)
+{
+    builder_u8(b, MVE_OP_JMP);
+    builder_ref(b, label);
+}
+
+
+static void emit_jnz(Builder *b, uint8_t reg, uint8_t label)
+{
+    builder_u8(b, MVE_OP_JNZ);
+    builder_u8(b, reg);
+    builder_ref(b, label);
+}
+
+
+static void emit_call(Builder *b, uint8_t op, uint8_t label)
+{
+    builder_u8(b, op);
+    builder_ref(b, label);
+}
+
+
+/**
+ * @brief Counts down a register and jumps to a label while it is not 0, with a LOOP or with a DEC and a JNZ.
+ */
+static void emit_count_down(Builder *b, uint8_t reg, uint8_t label, MVEbool use_loop)
+{
+    if (!use_loop)
+    {
+        emit_r(b, MVE_OP_DEC, reg);
+        emit_jnz(b, reg, label);
+        return;
+    }
+
+    builder_u8(b, MVE_OP_LOOP);
+    builder_u8(b, reg);
+    builder_ref(b, label);
+}
+
+
+/**
+ * @brief Writes a SWITCH jumping to the label of each case, or to the default label.
+ */
+static void emit_switch(Builder *b, uint8_t reg, uint8_t default_label, const uint8_t *labels, uint32_t count)
+{
+    builder_u8(b, MVE_OP_SWITCH);
+    builder_u8(b, reg);
+    builder_ref(b, default_label);
+    builder_u32(b, count);
+
+    for (uint32_t i = 0; i < count; i++)
+        builder_ref(b, labels[i]);
+}
+
+
+static void emit_stack(Builder *b, uint8_t op, uint8_t reg, int32_t address, uint8_t length)
+{
+    builder_u8(b, op);
+    builder_u8(b, reg);
+    builder_u32(b, (uint32_t) address);
+    builder_u8(b, length);
+}
+
+
+static void emit_memory(Builder *b, uint8_t op, uint8_t reg, uint8_t length)
+{
+    builder_u8(b, op);
+    builder_u8(b, reg);
+    builder_u8(b, length);
+}
+
+
+static void emit_invoke(Builder *b, uint16_t function_index)
+{
+    builder_u8(b, MVE_OP_INVOKE);
+    builder_u16(b, function_index);
+}
+
+
+static void emit_scope(Builder *b, uint32_t length)
+{
+    builder_u8(b, MVE_OP_SCOPE);
+    builder_u32(b, length);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Runs every workload and prints one JSON object per line with the results.
+ * The mode is chosen at build time: MVE_LOCAL_PROGRAM, or streaming with MVE_BUFFER_SIZE.
+ *
+ * Usage: MicroVE_Benchmark_<Mode> [scale] [repetitions]
+ */
+
+#define MVE_STACK_SIZE 1024
+#define MVE_USE_BYTE_OPS
+
+#include "../src/mve.c"
+
+#include "workloads.h"
+
+#ifndef MVE_BENCHMARK_COMMIT
+#define MVE_BENCHMARK_COMMIT "unknown"
+#endif
+
+
+static Builder builder;
+
+
+#ifndef MVE_LOCAL_PROGRAM
+void load_next_block(MVE_VM *vm, uint8_t *buffer, uint32_t read_index, uint32_t read_length)
+{
+    uint32_t available = read_index < builder.size ? builder.size - read_index : 0;
+    uint32_t length = read_length < available ? read_length : available;
+
+    memcpy(buffer, builder.data + read_index, length);
+    memset(buffer + length, 0, read_length - length);
+}
+#endif
+
+
+void nop(MVE_VM *vm)
+{
+    (void) vm;
+}
+
+
+static MVEbool start_vm(MVE_VM *vm)
+{
+#ifdef MVE_LOCAL_PROGRAM
+    if (!mve_init(vm, builder.data))
+        return MVE_FALSE;
+#else
+    if (!mve_init(vm, &load_next_block))
+        return MVE_FALSE;
+#endif
+
+    mve_link_function(vm, "nop", &nop);
+    mve_start(vm);
+
+    return MVE_TRUE;
+}
+
+
+static uint64_t now_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+
+int main(int argc, char **argv)
+{
+    uint32_t scale = argc > 1 ? (uint32_t) atoi(argv[1]) : 1;
+    uint32_t repetitions = argc > 2 ? (uint32_t) atoi(argv[2]) : 5;
+
+    static MVE_VM vm;
+
+#ifdef MVE_LOCAL_PROGRAM
+    const char *mode = "local";
+    uint32_t buffer_size = 0;
+#else
+    const char *mode = "stream";
+    uint32_t buffer_size = MVE_BUFFER_SIZE;
+#endif
+
+    for (uint32_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        const Workload *workload = &workloads[w];
+
+        workload->build(&builder, workload->n * scale);
+
+        // Count the instructions once, apart from the measured runs.
+        uint64_t instructions = 0;
+
+        if (!start_vm(&vm))
+        {
+            fprintf(stderr, "%s: failed to init the VM.\n", workload->name);
+            return 1;
+        }
+
+        while (mve_is_running(&vm)) {
+            mve_run(&vm);
+            instructions++;
+        }
+
+        uint64_t best = UINT64_MAX;
+
+        for (uint32_t r = 0; r < repetitions; r++) {
+            start_vm(&vm);
+
+            uint64_t start = now_ns();
+
+            while (mve_is_running(&vm))
+                mve_run(&vm);
+
+            uint64_t elapsed = now_ns() - start;
+
+            if (elapsed < best)
+                best = elapsed;
+        }
+
+        if (best == 0)
+            best = 1;
+
+        printf("{\"commit\":\"%s\",\"benchmark\":\"%s\",\"kind\":\"%s\",\"mode\":\"%s\",\"buffer_size\":%u,\"program_size\":%u,"
+               "\"instructions\":%llu,\"ns\":%llu,\"ns_per_instruction\":%.3f,\"instructions_per_second\":%.0f}\n",
+            MVE_BENCHMARK_COMMIT, workload->name, workload->kind, mode, buffer_size, builder.size,
+            (unsigned long long) instructions, (unsigned long long) best,
+            (double) best / instructions, instructions * 1e9 / best);
+    }
+
+    return 0;
+}
@@ -0,0 +1,470 @@
+#ifndef MVE_BENCHMARK_WORKLOADS_H
+#define MVE_BENCHMARK_WORKLOADS_H
+
+/**
+ * Programs measured by the benchmarks. Each one repeats its work `n` times, counted down in R0.
+ * The micro benchmarks stress a class of instructions, while the macro ones are small real tasks.
+ */
+
+#include "builder.h"
+
+
+static const char *workload_functions[] = { "nop" };
+
+
+static void build_alu(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R1, 3);
+    emit_ldi(b, MVE_R2, 5);
+
+    builder_label(b, 0);
+    emit_rrr(b, MVE_OP_ADD, MVE_R3, MVE_R1, MVE_R2);
+    emit_rrr(b, MVE_OP_SUB, MVE_R3, MVE_R3, MVE_R1);
+    emit_rrr(b, MVE_OP_MUL, MVE_R4, MVE_R3, MVE_R2);
+    emit_rrr(b, MVE_OP_AND, MVE_R4, MVE_R4, MVE_R3);
+    emit_rrr(b, MVE_OP_XOR, MVE_R3, MVE_R3, MVE_R4);
+    emit_rrr(b, MVE_OP_ORR, MVE_R4, MVE_R3, MVE_R1);
+    emit_rrr(b, MVE_OP_LSL, MVE_R3, MVE_R4, MVE_R1);
+    emit_rrr(b, MVE_OP_LSR, MVE_R4, MVE_R3, MVE_R1);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_lds_sts(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 8);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_stack(b, MVE_OP_LDS, MVE_R1, 0, 4);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    emit_stack(b, MVE_OP_STS, MVE_R1, 0, 4);
+    emit_stack(b, MVE_OP_LDS, MVE_R2, -4, 4);
+    emit_rrr(b, MVE_OP_ADD, MVE_R2, MVE_R2, MVE_R1);
+    emit_stack(b, MVE_OP_STS, MVE_R2, -4, 4);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_push_pop(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R1, 1);
+    emit_ldi(b, MVE_R2, 2);
+
+    builder_label(b, 0);
+    emit_memory(b, MVE_OP_PUSH, MVE_R1, 4);
+    emit_memory(b, MVE_OP_PUSH, MVE_R2, 4);
+    emit_memory(b, MVE_OP_POP, MVE_R1, 4);
+    emit_memory(b, MVE_OP_POP, MVE_R2, 4);
+
+    builder_u8(b, MVE_OP_PUSHM);
+    builder_u16(b, (1 << MVE_R1) | (1 << MVE_R2) | (1 << MVE_R3));
+    builder_u8(b, 4);
+    builder_u8(b, MVE_OP_POPM);
+    builder_u16(b, (1 << MVE_R1) | (1 << MVE_R2) | (1 << MVE_R3));
+    builder_u8(b, 4);
+
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_invoke(Builder *b, uint32_t n)
+{
+    builder_begin(b, workload_functions, 1, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_invoke(b, 0);
+    emit_invoke(b, 0);
+    emit_invoke(b, 0);
+    emit_invoke(b, 0);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_call_end(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_call(b, MVE_OP_CALL, 1);
+    emit_call(b, MVE_OP_CALL, 1);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+
+    // The function being called.
+    builder_label(b, 1);
+    emit_scope(b, 0);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    builder_u8(b, MVE_OP_END);
+
+    builder_end(b);
+}
+
+
+/**
+ * The same calls as call_end, with frames instead of scopes.
+ */
+static void build_fcall_ret(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_call(b, MVE_OP_FCALL, 1);
+    emit_call(b, MVE_OP_FCALL, 1);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+
+    // The function being called.
+    builder_label(b, 1);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    builder_u8(b, MVE_OP_RET);
+
+    builder_end(b);
+}
+
+
+/**
+ * A function calling itself in tail position 4 times, so all the calls share a single frame.
+ */
+static void build_tcall(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_ldi(b, MVE_R2, 4);
+    emit_call(b, MVE_OP_FCALL, 1);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+
+    // The function being called, which counts down R2.
+    builder_label(b, 1);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    emit_r(b, MVE_OP_DEC, MVE_R2);
+    emit_jnz(b, MVE_R2, 2);
+    builder_u8(b, MVE_OP_RET);
+
+    builder_label(b, 2);
+    emit_call(b, MVE_OP_TCALL, 1);
+
+    builder_end(b);
+}
+
+
+/**
+ * Jumps between locations far from each other, so a small program buffer needs to be reloaded.
+ */
+static void build_jumps(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+
+    builder_label(b, 0);
+    emit_jmp(b, 1);
+
+    for (uint8_t i = 1; i < 4; i++) {
+        // Bytes never executed, between the jumps.
+        for (uint16_t j = 0; j < 160; j++)
+            builder_u8(b, MVE_OP_EOP);
+
+        builder_label(b, i);
+
+        if (i < 3)
+            emit_jmp(b, i + 1);
+    }
+
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+/**
+ * Dispatches on the low 3 bits of a counter to one of 8 cases, with a SWITCH or with the chain of CMP and JNZ it replaces.
+ */
+static void build_dispatch(Builder *b, uint32_t n, MVEbool use_switch)
+{
+    static const uint8_t cases[] = { 2, 3, 4, 5, 6, 7, 8, 9 };
+
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R3, 7);
+
+    builder_label(b, 0);
+    emit_rrr(b, MVE_OP_AND, MVE_R1, MVE_R0, MVE_R3);
+
+    if (use_switch)
+    {
+        emit_switch(b, MVE_R1, 1, cases, sizeof(cases));
+    }
+    else
+    {
+        for (uint8_t i = 0; i < sizeof(cases); i++) {
+            emit_ldi(b, MVE_R4, i);
+            emit_cmp(b, MVE_CMP_EQUAL, MVE_R4, MVE_R1, MVE_R4);
+            emit_jnz(b, MVE_R4, cases[i]);
+        }
+
+        emit_jmp(b, 1);
+    }
+
+    for (uint8_t i = 0; i < sizeof(cases); i++) {
+        builder_label(b, cases[i]);
+        emit_r(b, MVE_OP_INC, MVE_R2);
+        emit_jmp(b, 1);
+    }
+
+    builder_label(b, 1);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_switch(Builder *b, uint32_t n)
+{
+    build_dispatch(b, n, MVE_TRUE);
+}
+
+
+static void build_cmp_chain(Builder *b, uint32_t n)
+{
+    build_dispatch(b, n, MVE_FALSE);
+}
+
+
+/**
+ * Sums the numbers from 1 to 100, n times, with a nested loop counted with LOOP or with DEC and JNZ.
+ */
+static void build_counted_loops(Builder *b, uint32_t n, MVEbool use_loop)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 0);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R4, 0);
+
+    builder_label(b, 0);
+    emit_ldi(b, MVE_R1, 100);
+    emit_ldi(b, MVE_R2, 0);
+
+    builder_label(b, 1);
+    emit_rrr(b, MVE_OP_ADD, MVE_R2, MVE_R2, MVE_R1);
+    emit_count_down(b, MVE_R1, 1, use_loop);
+
+    emit_rrr(b, MVE_OP_ADD, MVE_R4, MVE_R4, MVE_R2);
+    emit_count_down(b, MVE_R0, 0, use_loop);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_loops(Builder *b, uint32_t n)
+{
+    build_counted_loops(b, n, MVE_FALSE);
+}
+
+
+static void build_loops_loop(Builder *b, uint32_t n)
+{
+    build_counted_loops(b, n, MVE_TRUE);
+}
+
+
+/**
+ * Fills an array of 256 bytes with its indices and sums it, n times.
+ */
+static void build_array(Builder *b, uint32_t n)
+{
+    builder_begin(b, NULL, 0, NULL, 0, 256);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R2, 256);
+    emit_ldi(b, MVE_R4, 1);
+
+    builder_label(b, 0);
+    // The counter is saved, so R0 can hold the sum.
+    emit_memory(b, MVE_OP_PUSH, MVE_R0, 4);
+    emit_ldi(b, MVE_R0, 0);
+    emit_ldi(b, MVE_R1, 0);
+
+    builder_label(b, 1);
+    emit_rrr(b, MVE_OP_STR, MVE_R1, MVE_R1, MVE_R4);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    emit_cmp(b, MVE_CMP_NOTEQUAL, MVE_R3, MVE_R1, MVE_R2);
+    emit_jnz(b, MVE_R3, 1);
+
+    emit_ldi(b, MVE_R1, 0);
+
+    builder_label(b, 2);
+    emit_rrr(b, MVE_OP_LDR, MVE_R3, MVE_R1, MVE_R4);
+    emit_rrr(b, MVE_OP_ADD, MVE_R0, MVE_R0, MVE_R3);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    emit_cmp(b, MVE_CMP_NOTEQUAL, MVE_R3, MVE_R1, MVE_R2);
+    emit_jnz(b, MVE_R3, 2);
+
+    emit_memory(b, MVE_OP_POP, MVE_R0, 4);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+/**
+ * Copies a string into another buffer, stopping at its end, n times.
+ */
+static void build_string(Builder *b, uint32_t n)
+{
+    static const char text[64] = "The quick brown fox jumps over the lazy dog.";
+
+    builder_begin(b, NULL, 0, (const uint8_t *) text, sizeof(text), sizeof(text));
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R2, sizeof(text));
+    emit_ldi(b, MVE_R4, 1);
+
+    builder_label(b, 0);
+    emit_memory(b, MVE_OP_PUSH, MVE_R0, 4);
+    emit_ldi(b, MVE_R1, 0);
+
+    builder_label(b, 1);
+    emit_rrr(b, MVE_OP_LDR, MVE_R3, MVE_R1, MVE_R4);
+    emit_rrr(b, MVE_OP_ADD, MVE_R0, MVE_R1, MVE_R2);
+    emit_rrr(b, MVE_OP_STR, MVE_R3, MVE_R0, MVE_R4);
+    emit_r(b, MVE_OP_INC, MVE_R1);
+    emit_jnz(b, MVE_R3, 1);
+
+    emit_memory(b, MVE_OP_POP, MVE_R0, 4);
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+/**
+ * Measures the length of a text in the main scope, with STRLEN or reading a byte at a time.
+ */
+static void build_text_length(Builder *b, uint32_t n, MVEbool use_strlen)
+{
+    static const char text[64] = "The quick brown fox jumps over the lazy dog.";
+
+    builder_begin(b, NULL, 0, (const uint8_t *) text, sizeof(text), 0);
+
+    emit_ldi(b, MVE_R0, n);
+    emit_ldi(b, MVE_R2, 0);
+    emit_ldi(b, MVE_R4, 1);
+
+    builder_label(b, 0);
+
+    if (use_strlen)
+    {
+        builder_u8(b, MVE_OP_STRLEN);
+        builder_u8(b, MVE_R1);
+        builder_u8(b, MVE_R2);
+    }
+    else
+    {
+        emit_ldi(b, MVE_R1, 0);
+
+        builder_label(b, 1);
+        emit_rrr(b, MVE_OP_LDR, MVE_R3, MVE_R1, MVE_R4);
+        emit_r(b, MVE_OP_INC, MVE_R1);
+        emit_jnz(b, MVE_R3, 1);
+
+        emit_r(b, MVE_OP_DEC, MVE_R1);
+    }
+
+    emit_r(b, MVE_OP_DEC, MVE_R0);
+    emit_jnz(b, MVE_R0, 0);
+
+    builder_u8(b, MVE_OP_EOP);
+    builder_end(b);
+}
+
+
+static void build_strlen(Builder *b, uint32_t n)
+{
+    build_text_length(b, n, MVE_TRUE);
+}
+
+
+static void build_strlen_loop(Builder *b, uint32_t n)
+{
+    build_text_length(b, n, MVE_FALSE);
+}
+
+
+typedef struct {
+    const char *name;
+    const char *kind;                           // "micro" or "macro".
+    void (*build)(Builder *, uint32_t);
+    uint32_t n;                                 // Repetitions for a scale of 1.
+} Workload;
+
+
+static const Workload workloads[] = {
+    { "alu",        "micro", build_alu,         200000 },
+    { "lds_sts",    "micro", build_lds_sts,     200000 },
+    { "push_pop",   "micro", build_push_pop,    200000 },
+    { "invoke",     "micro", build_invoke,      200000 },
+    { "call_end",   "micro", build_call_end,    200000 },
+    { "fcall_ret",  "micro", build_fcall_ret,   200000 },
+    { "tcall",      "micro", build_tcall,       100000 },
+    { "jumps",      "micro", build_jumps,       200000 },
+    { "switch",     "micro", build_switch,      200000 },
+    { "cmp_chain",  "micro", build_cmp_chain,   200000 },
+    { "loops",      "macro", build_loops,       5000 },
+    { "loops_loop", "macro", build_loops_loop,  5000 },
+    { "array",      "macro", build_array,       1000 },
+    { "string",     "macro", build_string,      5000 },
+    { "strlen",     "macro", build_strlen,      50000 },
+    { "strlen_loop","macro", build_strlen_loop, 50000 },
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <cinttypes>
+
+#include "../../src/microve.hpp"
+
+
+template <typename T>
+T add(T a, T b) {
+    return a + b;
+}
+
+
+static const uint8_t program[] = {  0x01, 0x00, // Version Major
+                                    0x00, 0x00, // Version Minor
+                                    0x01, 0x00, 0x00, 0x00, // External functions count
+                                    'a', 'd', 'd', 0x00, // Function 1
+                                    0x00, 0x00, 0x00, 0x00, // The main scope has no memory.
+                                    MVE_OP_LDI, MVE_R0, 4, 0x00, 0x00, 0x01, 0x00,
+                                    MVE_OP_MUL, MVE_R0, MVE_R0, MVE_R0, // 65536 * 65536 overflows with 32 bit values.
+                                    MVE_OP_LDI, MVE_R1, 1, 5,
+                                    MVE_OP_INVOKE, 0, 0,
+                                    MVE_OP_EOP
+};
+
+
+int main() {
+
+    // Two VMs with different sizes and value widths, in the same binary.
+    static microve::VM<128, 64> vm32;
+    static microve::VM<256, 128, 8, uint64_t> vm64;
+
+    if (!vm32.load(program) || !vm64.load(program))
+        return 1;
+
+    vm32.link<&add<uint32_t>>("add");
+    vm64.link<&add<uint64_t>>("add");
+
+    vm32.run();
+    vm64.run();
+
+    printf("32 bit: %" PRIu32 "\n", vm32.get(MVE_R0));
+    printf("64 bit: %" PRIu64 "\n", vm64.get(MVE_R0));
+
+    return 0;
+}
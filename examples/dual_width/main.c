@@ -0,0 +1,62 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "../../src/mve_dual.h"
+
+
+/**
+ * The same program, declared once with 32 bit values and once with 64 bit values, run by the same build.
+ * mve_dual_init reads the MVE_HEADER_WIDTH section of each one and picks the engine for it.
+ */
+#define PROGRAM(width) {    0x01, 0x00, /* Version Major */ \
+                            0x02, 0x00, /* Version Minor */ \
+                            MVE_HEADER_WIDTH, 0x01, 0x00, 0x00, 0x00, width, \
+                            MVE_HEADER_END, \
+                            0x01, 0x00, 0x00, 0x00, /* External functions count */ \
+                            'a', 'd', 'd', 0x00, /* Function 1 */ \
+                            0x00, 0x00, 0x00, 0x00, /* The main scope has no memory. */ \
+                            MVE_OP_LDI, MVE_R0, 4, 0x00, 0x00, 0x01, 0x00, \
+                            MVE_OP_MUL, MVE_R0, MVE_R0, MVE_R0, /* 65536 * 65536 overflows with 32 bit values. */ \
+                            MVE_OP_LDI, MVE_R1, 1, 5, \
+                            MVE_OP_INVOKE, 0, 0, \
+                            MVE_OP_EOP \
+}
+
+static uint8_t program32[] = PROGRAM(4);
+static uint8_t program64[] = PROGRAM(8);
+
+
+// The same function runs on both engines, since the registers are read through the MVE_Dual_VM.
+static void add(MVE_Dual_VM *vm)
+{
+    mve_dual_set_register(vm, MVE_R0, mve_dual_get_register(vm, MVE_R0) + mve_dual_get_register(vm, MVE_R1));
+}
+
+
+static int run(uint8_t *program)
+{
+    static uint64_t storage[512];
+    MVE_Dual_VM vm;
+
+    if (mve_dual_storage_size() > sizeof(storage) || !mve_dual_init(&vm, storage, sizeof(storage), program))
+        return 1;
+
+    mve_dual_link_function(&vm, "add", add);
+    mve_dual_start(&vm);
+
+    while (mve_dual_is_running(&vm))
+        mve_dual_run(&vm);
+
+    printf("%u bit: %" PRIu64 "\n", (unsigned) mve_dual_width(&vm) * 8, mve_dual_get_register(&vm, MVE_R0));
+
+    return 0;
+}
+
+
+int main() {
+
+    if (run(program32) != 0 || run(program64) != 0)
+        return 1;
+
+    return 0;
+}
@@ -17,13 +17,55 @@
 
 #define MVE_SCOPE_LIMIT 8
 
+#define MVE_FRAME_LIMIT 8
+
+#define MVE_GROWABLE_SCOPES
+#define MVE_SCOPE_MAX 65536
+#define MVE_FRAME_MAX 65536
+#define MVE_REALLOC(pointer, size) realloc(pointer, size)
+#define MVE_FREE(pointer) free(pointer)
+
 #define MVE_LOCAL_PROGRAM
 
 #define MVE_ERROR_LOG(vm, program_index, error_id, msg) printf("%s Program index: %u.", msg, program_index);
 
 #define MVE_USE_64BIT_TYPES
+#define MVE_DUAL_WIDTH
 #define MVE_BIG_ENDIAN
 
+#define MVE_RUNTIME_SIZES
+
+#define MVE_USE_CHANNELS
+#define MVE_CHANNELS_LIMIT 4
+#define MVE_CHANNEL_MESSAGE_SIZE 16
+#define MVE_CACHE_LINE_SIZE 64
+
+#define MVE_USE_REGIONS
+#define MVE_REGIONS_LIMIT 4
+
+#define MVE_USE_EXPORTS
+#define MVE_EXPORTS_LIMIT 8
+
+#define MVE_USE_IMAGES
+
+#define MVE_PROFILE
+#define MVE_PROFILE_HISTOGRAM_SIZE 16
+#define MVE_CLOCK() my_clock()
+
+#define MVE_LOADER_STATS
+#define MVE_LOADER_STATS_SITES 8
+
+#define MVE_TRACE
+#define MVE_TRACE_OPERANDS 10
+
+#define MVE_TRACK_USAGE
+#define MVE_USAGE_BLOCKS 256
+
+#define MVE_SAMPLING
+#define MVE_SAMPLE_DEPTH 8
+
+#define MVE_API static
+
 */
 
 #endif
\ No newline at end of file
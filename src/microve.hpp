@@ -0,0 +1,296 @@
+#ifndef MICROVE_HPP
+#define MICROVE_HPP
+
+/**
+ * Header-only C++17 wrapper of MicroVE, with the sizes of each VM as template parameters,
+ * so VMs of different sizes and value widths can be used in the same translation unit.
+ *
+ * mve.c is included twice, with MVE_API as static, into microve::detail::v32 and microve::detail::v64,
+ * once without and once with MVE_USE_64BIT_TYPES. Both are built with MVE_LOCAL_PROGRAM and MVE_RUNTIME_SIZES,
+ * so the sizes come from the template parameters, and the storage is a member of the VM, with no allocations.
+ * The other macros of config.h, like MVE_ERROR_LOG, apply to both.
+ *
+ * Functions are linked with link<&function>(name), which generates a trampoline that reads the arguments
+ * from r0 to r4, calls the function, and writes its result into r0. A function can also take the VM by reference,
+ * as its first argument, or the MVE_VM of the engine, like the functions of the C API.
+ *
+ *  int32_t add(int32_t a, int32_t b) { return a + b; }
+ *
+ *  microve::VM<256, 64, 8> vm;
+ *
+ *  vm.load(program);
+ *  vm.link<&add>("add");
+ *  vm.run();
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// The headers used by mve.c, included here so they are not included again inside the namespaces of the engines.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#include "config.h"
+#include "mve_bytes.h"
+
+// Each engine is a private copy of the C API, and only some of its functions are used by the wrapper.
+#undef MVE_API
+#if defined(__GNUC__) || defined(__clang__)
+#define MVE_API static __attribute__((unused))
+#else
+#define MVE_API static
+#endif
+
+#ifndef MVE_LOCAL_PROGRAM
+#define MVE_LOCAL_PROGRAM
+#endif
+
+#ifndef MVE_RUNTIME_SIZES
+#define MVE_RUNTIME_SIZES
+#endif
+
+#ifdef MVE_GROWABLE_SCOPES
+#define MICROVE_RELEASE(vm) mve_release(vm)
+#else
+#define MICROVE_RELEASE(vm) (void) (vm)
+#endif
+
+
+// The functions of the engine used by microve::VM, declared in the namespace of each engine.
+#define MICROVE_ENGINE                                                                                              \
+    struct Engine {                                                                                                 \
+        using Machine = MVE_VM;                                                                                     \
+        using Value = MVE_Value;                                                                                    \
+        using Config = MVE_Config;                                                                                  \
+        using Arena = MVE_Arena;                                                                                    \
+        using Scope = MVE_Scope_Info;                                                                               \
+                                                                                                                    \
+        static void arena_init(Arena *arena, void *memory, uint32_t size) { mve_arena_init(arena, memory, size); } \
+        static void arena_reset(Arena *arena) { mve_arena_reset(arena); }                                          \
+        static void configure(Machine *vm, const Config *config, Arena *arena) { mve_configure(vm, config, arena); } \
+        static bool init(Machine *vm, uint8_t *program) { return mve_init(vm, program); }                          \
+        static void link_function(Machine *vm, const char *name, void (*function)(Machine *)) { mve_link_function(vm, name, function); } \
+        static void start(Machine *vm) { mve_start(vm); }                                                          \
+        static void run(Machine *vm) { mve_run(vm); }                                                              \
+        static bool is_running(Machine *vm) { return mve_is_running(vm); }                                         \
+        static void stop(Machine *vm) { mve_stop(vm); }                                                            \
+        static void release(Machine *vm) { MICROVE_RELEASE(vm); }                                                  \
+    };
+
+
+namespace microve {
+namespace detail {
+
+#undef MVE_H
+#undef MVE_BASE_TYPE_SIZE
+#undef MVE_USE_64BIT_TYPES
+
+namespace v32 {
+#include "mve.c"
+MICROVE_ENGINE
+}
+
+#undef MVE_H
+#undef MVE_BASE_TYPE_SIZE
+#define MVE_USE_64BIT_TYPES
+
+namespace v64 {
+#include "mve.c"
+MICROVE_ENGINE
+}
+
+template <std::size_t Width>
+using Engine = std::conditional_t<Width == 8, v64::Engine, v32::Engine>;
+
+}
+
+
+/**
+ * A VM with its sizes and the type of its values fixed at compile time.
+ * It owns its storage, so it cannot be copied or moved. Programs can declare smaller sizes in their header, but not bigger ones.
+ *
+ * @tparam StackSize Size of the stack.
+ * @tparam MemorySize Size of the memory.
+ * @tparam ScopeLimit Maximum amount of scopes. At least 4.
+ * @tparam ValueT Type of the values returned by get: uint32_t, int32_t or float for 32 bit values, uint64_t, int64_t or double for 64 bit ones.
+ */
+template <uint32_t StackSize, uint32_t MemorySize, uint32_t ScopeLimit = MVE_SCOPE_LIMIT, typename ValueT = uint32_t>
+class VM {
+    static_assert(std::is_arithmetic_v<ValueT> && (sizeof(ValueT) == 4 || sizeof(ValueT) == 8), "The values must be numbers of 4 or 8 bytes.");
+    static_assert(ScopeLimit >= 4, "The scope limit must be at least 4.");
+
+public:
+    using Engine = detail::Engine<sizeof(ValueT)>;
+    using Machine = typename Engine::Machine;
+
+    static constexpr uint32_t stack_size = StackSize;
+    static constexpr uint32_t memory_size = MemorySize;
+    static constexpr uint32_t scope_limit = ScopeLimit;
+    static constexpr uint32_t width = sizeof(ValueT);
+
+    VM() : machine_{}, arena_{}
+    {
+        Engine::arena_init(&arena_, storage_, sizeof(storage_));
+    }
+
+    ~VM()
+    {
+        Engine::release(&machine_);
+    }
+
+    VM(const VM &) = delete;
+    VM &operator=(const VM &) = delete;
+
+    /**
+     * @brief Initiates the VM with a program, which must stay valid while it runs. The storage of the previous program is reused.
+     *
+     * @return Returns false if the program is not compatible, or needs more than the sizes of the VM.
+     */
+    bool load(const uint8_t *program)
+    {
+        typename Engine::Config config = { StackSize, MemorySize, ScopeLimit, 0 };
+
+        Engine::release(&machine_);
+        Engine::arena_reset(&arena_);
+        Engine::configure(&machine_, &config, &arena_);
+
+        return Engine::init(&machine_, const_cast<uint8_t *>(program));
+    }
+
+    /**
+     * @brief Links a function to the name declared in the program, through a trampoline made for its signature.
+     */
+    template <auto Function>
+    void link(const char *name)
+    {
+        Engine::link_function(&machine_, name, &Binding<decltype(Function)>::template call<Function>);
+    }
+
+    void start() { Engine::start(&machine_); }
+
+    /**
+     * @brief Executes the next instruction.
+     */
+    void step() { Engine::run(&machine_); }
+
+    /**
+     * @brief Starts the program and runs it until it stops.
+     */
+    void run()
+    {
+        Engine::start(&machine_);
+
+        while (Engine::is_running(&machine_))
+            Engine::run(&machine_);
+    }
+
+    bool running() { return Engine::is_running(&machine_); }
+
+    void stop() { Engine::stop(&machine_); }
+
+    ValueT get(uint8_t reg) const { return from_value<ValueT>(machine_.registers.all[reg]); }
+
+    void set(uint8_t reg, ValueT value) { to_value(machine_.registers.all[reg], value); }
+
+    uint8_t *stack() { return machine_.stack; }
+
+    uint8_t *memory() { return machine_.memory; }
+
+    /**
+     * @brief Returns the MVE_VM of the engine, to use the rest of the C API of mve.c, in the namespace of the engine.
+     */
+    Machine *native() { return &machine_; }
+
+    /**
+     * @brief Returns the VM that owns the MVE_VM of the engine.
+     */
+    static VM &from(Machine *machine)
+    {
+        static_assert(std::is_standard_layout_v<VM>, "The MVE_VM must be at the start of the VM.");
+        return *reinterpret_cast<VM *>(machine);
+    }
+
+private:
+    using Value = typename Engine::Value;
+
+    template <typename T>
+    static T from_value(const Value &value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return static_cast<T>(value.f);
+        else
+            return static_cast<T>(value.i);
+    }
+
+    template <typename T>
+    static void to_value(Value &value, T result)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            value.f = static_cast<decltype(value.f)>(result);
+        else
+            value.i = static_cast<decltype(value.i)>(result);
+    }
+
+    template <typename Function>
+    struct Binding;
+
+    template <typename R, typename... Args>
+    struct Binding<R (*)(Args...)> {
+        using First = std::tuple_element_t<0, std::tuple<Args..., void>>;
+
+        // The VM or the MVE_VM can be taken as the first argument. The registers are the rest.
+        static constexpr std::size_t offset = std::is_same_v<First, VM &> || std::is_same_v<First, Machine *> ? 1 : 0;
+
+        static_assert(sizeof...(Args) - offset <= 5, "The functions take at most 5 arguments, from r0 to r4.");
+
+        template <typename A, std::size_t I>
+        static A argument(Machine *machine)
+        {
+            if constexpr (std::is_same_v<A, VM &>)
+                return from(machine);
+            else if constexpr (std::is_same_v<A, Machine *>)
+                return machine;
+            else
+                return from_value<std::decay_t<A>>(machine->registers.all[I - offset]);
+        }
+
+        template <auto Function, std::size_t... I>
+        static void call(Machine *machine, std::index_sequence<I...>)
+        {
+            if constexpr (std::is_void_v<R>)
+                Function(argument<Args, I>(machine)...);
+            else
+                to_value(machine->registers.r0, Function(argument<Args, I>(machine)...));
+        }
+
+        template <auto Function>
+        static void call(Machine *machine)
+        {
+            call<Function>(machine, std::index_sequence_for<Args...>{});
+        }
+    };
+
+    template <typename R, typename... Args>
+    struct Binding<R (*)(Args...) noexcept> : Binding<R (*)(Args...)> {};
+
+    Machine machine_;                                               // The first member, so from can find the VM.
+    typename Engine::Arena arena_;
+
+    alignas(MVE_CACHE_LINE_SIZE) uint8_t storage_[ScopeLimit * sizeof(typename Engine::Scope) + StackSize + MemorySize + 4 * MVE_CACHE_LINE_SIZE];
+};
+
+}
+
+#undef MICROVE_ENGINE
+#undef MICROVE_RELEASE
+
+#endif
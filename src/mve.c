@@ -1,5 +1,169 @@
 #include "mve.h"
 
+#include <string.h>
+
+#ifdef MVE_USE_BYTE_OPS
+#include "mve_bytes.h"
+#endif
+
+#if defined(MVE_PROFILE) || defined(MVE_LOADER_STATS)
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#ifndef MVE_CLOCK
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MVE_CLOCK() __rdtsc()
+#define MVE_CLOCK_NAME "rdtsc"
+#elif defined(__GNUC__) && defined(__aarch64__)
+static inline uint64_t mve_clock(void)
+{
+    uint64_t ticks;
+    __asm__ volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+}
+#define MVE_CLOCK() mve_clock()
+#define MVE_CLOCK_NAME "cntvct"
+#elif defined(CLOCK_MONOTONIC)
+static inline uint64_t mve_clock(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+#define MVE_CLOCK() mve_clock()
+#define MVE_CLOCK_NAME "clock_gettime"
+#else
+// There is no clock, so only the executions are counted.
+#define MVE_CLOCK() ((uint64_t) 0)
+#define MVE_CLOCK_NAME "none"
+#endif
+#endif
+
+#ifndef MVE_CLOCK_NAME
+#define MVE_CLOCK_NAME "custom"
+#endif
+#endif
+
+
+#if defined(MVE_TRACK_USAGE) && !defined(MVE_LOCAL_PROGRAM)
+/**
+ * @brief Marks the blocks of the program being loaded as used. A block has the size of the program buffer.
+ * 
+ * @param vm VM loading the program.
+ * @param index Program index of the first byte loaded.
+ * @param length Amount of bytes loaded.
+ */
+static void mve_mark_blocks(MVE_VM *vm, uint32_t index, uint32_t length)
+{
+    uint32_t last = (index + length - 1) / MVE_VM_BUFFER_SIZE(vm);
+
+    for (uint32_t block = index / MVE_VM_BUFFER_SIZE(vm); block <= last && block < MVE_USAGE_BLOCKS; block++) {
+        uint8_t bit = 1 << (block % 8);
+
+        if ((vm->usage.blocks[block / 8] & bit) == 0)
+        {
+            vm->usage.blocks[block / 8] |= bit;
+            vm->usage.blocks_loaded++;
+        }
+    }
+}
+#endif
+
+
+#if (defined(MVE_LOADER_STATS) || defined(MVE_TRACK_USAGE)) && !defined(MVE_LOCAL_PROGRAM)
+/**
+ * @brief Calls fun_load_next_block, counting the call, the bytes, the time spent and the blocks loaded.
+ * 
+ * @param counter The counter of the reason of the call. NULL without MVE_LOADER_STATS.
+ */
+static inline void mve_fetch_program(MVE_VM *vm, uint8_t *destination, uint32_t index, uint32_t length, uint32_t *counter)
+{
+#ifdef MVE_LOADER_STATS
+    uint64_t start = MVE_CLOCK();
+#endif
+
+    vm->fun_load_next_block(vm, destination, index, length);
+
+#ifdef MVE_LOADER_STATS
+    vm->loader_stats.ticks += MVE_CLOCK() - start;
+    vm->loader_stats.bytes += length;
+    (*counter)++;
+#else
+    (void) counter;
+#endif
+
+#ifdef MVE_TRACK_USAGE
+    mve_mark_blocks(vm, index, length);
+#endif
+}
+
+#ifdef MVE_LOADER_STATS
+#define MVE_FETCH_PROGRAM(vm, destination, index, length, reason) mve_fetch_program(vm, destination, index, length, &(vm)->loader_stats.reason)
+#else
+#define MVE_FETCH_PROGRAM(vm, destination, index, length, reason) mve_fetch_program(vm, destination, index, length, NULL)
+#endif
+#else
+#define MVE_FETCH_PROGRAM(vm, destination, index, length, reason) (vm)->fun_load_next_block(vm, destination, index, length)
+#endif
+
+
+#if defined(MVE_LOADER_STATS) && !defined(MVE_LOCAL_PROGRAM)
+/**
+ * @brief Counts a reload of the buffer caused by a jump from a program index.
+ * 
+ * @param vm VM loading the program.
+ * @param program_index Program index right after the jumping instruction.
+ */
+static void mve_count_jump_site(MVE_VM *vm, uint32_t program_index)
+{
+    MVE_Loader_Site *least = &vm->loader_stats.sites[0];
+
+    for (uint8_t i = 0; i < MVE_LOADER_STATS_SITES; i++) {
+        MVE_Loader_Site *site = &vm->loader_stats.sites[i];
+
+        if (site->reloads != 0 && site->program_index == program_index) 
+        {
+            site->reloads++;
+            return;
+        }
+
+        if (site->reloads < least->reloads)
+            least = site;
+    }
+
+    least->program_index = program_index;
+    least->reloads++;
+}
+#endif
+
+
+#ifdef MVE_TRACE
+/**
+ * @brief Records the next operand bytes of the program into the trace entry of the instruction being executed.
+ * 
+ * @param vm VM being traced.
+ * @param length Amount of bytes being read.
+ */
+static inline void mve_trace_operands(MVE_VM *vm, uint8_t length)
+{
+    MVE_Trace_Entry *entry = vm->trace_entry;
+
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t index = entry->operands_length < MVE_TRACE_OPERANDS - 1 ? entry->operands_length : MVE_TRACE_OPERANDS - 1;
+
+        entry->operands[index] = vm->program_buffer[vm->buffer_index + i];
+        entry->operands_length++;
+    }
+}
+
+#define MVE_TRACE_READ(vm, length) mve_trace_operands(vm, length)
+#else
+#define MVE_TRACE_READ(vm, length)
+#endif
+
 
 static inline MVEbool string_equals(const char *str1, const char *str2) 
 {
@@ -17,6 +181,19 @@ static inline MVEbool string_equals(const char *str1, const char *str2)
 }
 
 
+#ifdef MVE_USE_EXPORTS
+#define MVE_HASH_START 2166136261u
+
+/**
+ * @brief Adds a byte to a FNV-1a hash, which starts with MVE_HASH_START.
+ */
+static inline uint32_t mve_hash_byte(uint32_t hash, uint8_t byte)
+{
+    return (hash ^ byte) * 16777619u;
+}
+#endif
+
+
 /**
  * @brief Loads the next bytes of the program file.
  * If the buffer index is not at the end of the buffer,
@@ -28,6 +205,7 @@ static inline MVEbool string_equals(const char *str1, const char *str2)
 static void mve_load_next_block(MVE_VM *vm) 
 {
 #ifdef MVE_LOCAL_PROGRAM
+    (void) vm;
 #else
     // TODO: This may cause infinite looping. Add verifications in the future.
     //if (vm->buffer_index == 0)
@@ -36,7 +214,7 @@ static void mve_load_next_block(MVE_VM *vm)
     int index = 0;
 
     // Move the last bytes to the start of the buffer.
-    for (uint32_t i = vm->buffer_index; i < MVE_BUFFER_SIZE; i++)
+    for (uint32_t i = vm->buffer_index; i < MVE_VM_BUFFER_SIZE(vm); i++)
     {
         vm->program_buffer[index] = vm->program_buffer[i];
         index++;
@@ -48,20 +226,62 @@ static void mve_load_next_block(MVE_VM *vm)
 
     if (vm->buffer_index == 0) 
     {
-        length = MVE_BUFFER_SIZE;
+        length = MVE_VM_BUFFER_SIZE(vm);
         buffer = vm->program_buffer;
     }
 
 
     vm->buffer_index = 0;
 
-    vm->fun_load_next_block(vm, buffer, vm->program_index, length);
+    MVE_FETCH_PROGRAM(vm, buffer, vm->program_index, length, sequential_loads);
 
     vm->program_index += length;
 #endif
 }
 
 
+/**
+ * @brief Returns the absolute index in the program of the next byte to be read.
+ * 
+ * @param vm The VM executing the program.
+ * @return Returns the index in the program.
+ */
+static inline uint32_t mve_get_program_index(MVE_VM *vm) 
+{
+    #ifdef MVE_LOCAL_PROGRAM
+        return vm->buffer_index;
+    #else
+        return vm->program_index - MVE_VM_BUFFER_SIZE(vm) + vm->buffer_index;
+    #endif
+}
+
+
+/**
+ * @brief Moves the reading of the program to an index, loading it if it's not in the buffer.
+ * Unlike mve_jump_to_program_index, it's not a jump of the program, so a reload is counted as sequential and has no jump site.
+ * 
+ * @param vm The VM executing the program.
+ * @param index Index in the program to read next.
+ */
+static void mve_seek_program_index(MVE_VM *vm, uint32_t index) 
+{
+    #ifdef MVE_LOCAL_PROGRAM
+        vm->buffer_index = index;
+    #else
+        if (vm->program_index - MVE_VM_BUFFER_SIZE(vm) <= index && index <= vm->program_index) 
+        {
+            vm->buffer_index = index - (vm->program_index - MVE_VM_BUFFER_SIZE(vm));
+            return;
+        }
+
+        vm->buffer_index = 0;
+        vm->program_index = index + MVE_VM_BUFFER_SIZE(vm);
+
+        MVE_FETCH_PROGRAM(vm, vm->program_buffer, index, MVE_VM_BUFFER_SIZE(vm), sequential_loads);
+    #endif
+}
+
+
 /**
  * @brief Jumps a given location in the program.
  * If it's not loaded, it will load that location first.
@@ -74,15 +294,21 @@ static void mve_jump_to_program_index(MVE_VM *vm, uint32_t index)
     #ifdef MVE_LOCAL_PROGRAM
         vm->buffer_index = index;
     #else
-        if (vm->program_index - MVE_BUFFER_SIZE <= index && index <= vm->program_index) 
+        if (vm->program_index - MVE_VM_BUFFER_SIZE(vm) <= index && index <= vm->program_index) 
         {
-            vm->buffer_index = index - (vm->program_index - MVE_BUFFER_SIZE);
+            vm->buffer_index = index - (vm->program_index - MVE_VM_BUFFER_SIZE(vm));
             return;
         }
 
+    #ifdef MVE_LOADER_STATS
+        mve_count_jump_site(vm, mve_get_program_index(vm));
+    #endif
+
+        // The whole buffer is replaced, so there are no bytes to keep.
         vm->buffer_index = 0;
-        vm->program_index = index;
-        mve_load_next_block(vm);
+        vm->program_index = index + MVE_VM_BUFFER_SIZE(vm);
+
+        MVE_FETCH_PROGRAM(vm, vm->program_buffer, index, MVE_VM_BUFFER_SIZE(vm), jump_loads);
     #endif
 }
 
@@ -97,9 +323,9 @@ static void mve_jump_to_program_index(MVE_VM *vm, uint32_t index)
  * @param index Index at the buffer.
  * @param size Size to ensure the buffer has after the index.
  */
-inline static void mve_ensure_buffer_size_at(MVE_VM *vm, uint16_t index, uint8_t length) 
+inline static void mve_ensure_buffer_size_at(MVE_VM *vm, uint32_t index, uint8_t length) 
 {
-    if (index + length > MVE_BUFFER_SIZE)
+    if (index + length > MVE_VM_BUFFER_SIZE(vm))
         mve_load_next_block(vm);
 }
 
@@ -131,6 +357,8 @@ static inline uint32_t mve_request_int32(MVE_VM *vm)
         mve_ensure_buffer_size(vm, 4);
     #endif
 
+    MVE_TRACE_READ(vm, 4);
+
     uint32_t value = MVE_BYTES_TO_INT32(vm->program_buffer, vm->buffer_index);
     vm->buffer_index += 4;
 
@@ -150,6 +378,8 @@ static inline uint32_t mve_request_uint32(MVE_VM *vm)
         mve_ensure_buffer_size(vm, 4);
     #endif
 
+    MVE_TRACE_READ(vm, 4);
+
     uint32_t value = MVE_BYTES_TO_UINT32(vm->program_buffer, vm->buffer_index);
     vm->buffer_index += 4;
 
@@ -169,6 +399,8 @@ static inline uint32_t mve_request_uint16(MVE_VM *vm)
         mve_ensure_buffer_size(vm, 2);
     #endif
 
+    MVE_TRACE_READ(vm, 2);
+
     uint32_t value = MVE_BYTES_TO_UINT16(vm->program_buffer, vm->buffer_index);
     vm->buffer_index += 2;
 
@@ -188,6 +420,8 @@ static inline uint8_t mve_request_uint8(MVE_VM *vm)
         mve_ensure_buffer_size(vm, 1);
     #endif
 
+    MVE_TRACE_READ(vm, 1);
+
     uint8_t byte = vm->program_buffer[vm->buffer_index];
     vm->buffer_index++;
 
@@ -195,610 +429,802 @@ static inline uint8_t mve_request_uint8(MVE_VM *vm)
 }
 
 
-static void mve_load_scope_memory(MVE_VM *vm) 
+/**
+ * @brief Copies the next bytes of the program and increases the buffer index.
+ * In streaming mode, bytes that are not in the buffer yet are loaded straight into the destination.
+ * 
+ * @param vm VM to read the bytes.
+ * @param destination Where to copy the bytes.
+ * @param length Amount of bytes to copy.
+ */
+static void mve_request_bytes(MVE_VM *vm, uint8_t *destination, uint32_t length) 
 {
-    uint32_t length = mve_request_uint32(vm);
+    #ifdef MVE_LOCAL_PROGRAM
+        memcpy(destination, vm->program_buffer + vm->buffer_index, length);
+        vm->buffer_index += length;
+    #else
+        uint32_t available = MVE_VM_BUFFER_SIZE(vm) - vm->buffer_index;
+
+        if (length <= available)
+        {
+            memcpy(destination, vm->program_buffer + vm->buffer_index, length);
+            vm->buffer_index += length;
+            return;
+        }
 
-    MVE_ASSERT_STACK_ADDRESS(length + STACK_POINTER(vm), "Error loading scope memory.", vm);
+        memcpy(destination, vm->program_buffer + vm->buffer_index, available);
+        vm->buffer_index += available;
 
-    for (uint32_t i = 0; i < length; i++) {
-        vm->stack[STACK_POINTER(vm)] = mve_request_uint8(vm);
-        STACK_POINTER(vm)++;
-    }
+        length -= available;
+        destination += available;
+
+        // Small rests are read through the buffer, which also loads the next instructions.
+        if (length <= MVE_VM_BUFFER_SIZE(vm))
+        {
+            mve_load_next_block(vm);
+            memcpy(destination, vm->program_buffer, length);
+            vm->buffer_index = length;
+            return;
+        }
+
+        uint32_t index = mve_get_program_index(vm);
+
+        MVE_FETCH_PROGRAM(vm, destination, index, length, direct_loads);
+
+        mve_seek_program_index(vm, index + length);
+    #endif
 }
 
 
 /**
- * @brief Loads and processes the header of the program.
- * It the bytecode version of the program is not compatible, it will abort.
+ * @brief Loads the memory of a scope into the end of the stack.
+ * The initial bytes are copied from the program, followed by the zero filled bytes, if the length has MVE_SCOPE_ZERO_FILL.
  * 
- * @param vm VM to load the header.
+ * @param vm VM to load the scope memory.
  */
-static MVEbool mve_load_header(MVE_VM *vm) 
+static void mve_load_scope_memory(MVE_VM *vm) 
 {
-    uint16_t major_version = MVE_BYTES_TO_UINT16(vm->program_buffer, 0);
-    uint16_t minor_version = MVE_BYTES_TO_UINT16(vm->program_buffer, 2);
+    uint32_t length = mve_request_uint32(vm);
+    uint32_t zero_length = 0;
 
-    if (major_version != MVE_VERSION_MAJOR)
-        return MVE_FALSE;
+    if (length & MVE_SCOPE_ZERO_FILL) 
+    {
+        length &= ~MVE_SCOPE_ZERO_FILL;
+        zero_length = mve_request_uint32(vm);
+    }
 
-    if (minor_version > MVE_VERSION_MINOR)
-        return MVE_FALSE;
+    MVE_ASSERT_STACK_ADDRESS(length + zero_length + STACK_POINTER(vm), "Error loading scope memory.", vm);
 
-    vm->buffer_index = 4;
-    uint16_t external_functions_length = mve_request_uint32(vm);
+    mve_request_bytes(vm, vm->stack + STACK_POINTER(vm), length);
+    STACK_POINTER(vm) += length;
 
-    uint8_t strings_counter = 0;
+    memset(vm->stack + STACK_POINTER(vm), 0, zero_length);
+    STACK_POINTER(vm) += zero_length;
+}
 
-    // Load the function names.
-    for (uint32_t i = 0; i < MVE_MEMORY_SIZE && strings_counter < external_functions_length; i++) {
-        vm->memory[i] = mve_request_uint8(vm);
-        
-        if (vm->memory[i] == '\0')
-            strings_counter++;
-    }
 
-    vm->external_functions_count = strings_counter;
+/**
+ * @brief Skips bytes of the program, without reading them.
+ * 
+ * @param vm VM to skip the bytes.
+ * @param length Amount of bytes to skip.
+ */
+static void mve_skip_program_bytes(MVE_VM *vm, uint32_t length) 
+{
+    mve_seek_program_index(vm, mve_get_program_index(vm) + length);
+}
 
-    mve_load_scope_memory(vm);
 
-    return MVE_TRUE;
+/**
+ * @brief Reads an uint32 at any index of the program, without moving the buffer index.
+ * In streaming mode, if it's not loaded, only its 4 bytes are loaded, and the buffer is kept.
+ * 
+ * @param vm VM to read the value.
+ * @param index Index in the program of the value.
+ * @return Returns the value readed.
+ */
+static uint32_t mve_read_program_uint32(MVE_VM *vm, uint32_t index) 
+{
+    #ifdef MVE_LOCAL_PROGRAM
+        return MVE_BYTES_TO_UINT32(vm->program_buffer, index);
+    #else
+        uint32_t start = vm->program_index - MVE_VM_BUFFER_SIZE(vm);
+
+        if (start <= index && index + 4 <= vm->program_index)
+            return MVE_BYTES_TO_UINT32(vm->program_buffer, index - start);
+
+        uint8_t bytes[4];
+
+        MVE_FETCH_PROGRAM(vm, bytes, index, 4, direct_loads);
+
+        return MVE_BYTES_TO_UINT32(bytes, 0);
+    #endif
 }
 
 
-static void mve_op_ldr(MVE_VM *vm)
+/**
+ * @brief Applies the sizes required by the program.
+ * With runtime sizes, they replace the ones from the config. Otherwise, the program is only accepted if they fit in the VM.
+ * 
+ * @param vm VM to apply the sizes.
+ * @param stack_size Stack size required by the program. 0 keeps the one of the VM.
+ * @param memory_size Memory size required by the program. 0 keeps the one of the VM.
+ * @param scope_limit Scope limit required by the program. 0 keeps the one of the VM.
+ * @return Returns false if the program does not fit in the VM.
+ */
+static MVEbool mve_apply_sizes(MVE_VM *vm, uint32_t stack_size, uint32_t memory_size, uint32_t scope_limit) 
 {
-    // The register to receive the value.
-    uint8_t reg = mve_request_uint8(vm);
-
-    // The register that contains the index to load.
-    uint8_t reg_index = mve_request_uint8(vm);
+    #ifdef MVE_USE_IMAGES
+        vm->image_sizes[0] = stack_size;
+        vm->image_sizes[1] = memory_size;
+        vm->image_sizes[2] = scope_limit;
+    #endif
 
-    // The register that contains the amount o bytes to load.
-    uint8_t reg_length = mve_request_uint8(vm);
+    #ifdef MVE_RUNTIME_SIZES
+        if (stack_size != 0)
+            vm->stack_size = stack_size;
 
-    MVE_ASSERT_REGISTER(reg, "LDR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_index, "LDR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_length, "LDR failed!", vm);
+        if (memory_size != 0)
+            vm->memory_size = memory_size;
 
-    MVE_Value value;
-    value.i = 0;
+        if (scope_limit != 0)
+            vm->scope_limit = scope_limit;
 
-    int32_t stack_address = vm->registers.all[reg_index].i;
-    uint32_t length = vm->registers.all[reg_length].i;
+        MVEbool result = vm->scope_limit >= 4;
+    #elif defined(MVE_GROWABLE_SCOPES)
+        // The scopes grow, so the limit is only allocated upfront.
+        if (scope_limit > vm->scope_limit)
+            vm->scope_limit = scope_limit;
 
-    uint32_t address = 0;
+        MVEbool result = stack_size <= MVE_STACK_SIZE && memory_size <= MVE_MEMORY_SIZE && scope_limit <= MVE_SCOPE_MAX;
+    #else
+        // Without MVE_USE_IMAGES and MVE_ERROR_LOG, the sizes are only compared with the ones of the build.
+        (void) vm;
 
-    // If the stack_address is negative then the end of the stack is used.
-    // This is used when accessing scope memory.
-    if (stack_address < 0)
-        address = STACK_POINTER(vm) - (-stack_address);
-    else
-        address = stack_address;
+        MVEbool result = stack_size <= MVE_STACK_SIZE && memory_size <= MVE_MEMORY_SIZE && scope_limit <= MVE_SCOPE_LIMIT;
+    #endif
 
-    // Copy the bytes from the stack into the value.
-    for (uint8_t i = 0; i < length; i++)
-    {
-        #ifdef MVE_BIG_ENDIAN
-            value.b[length - i - 1] = vm->stack[address + i];
-        #else
-            value.b[i] = vm->stack[address + i];
-        #endif
-    }
+    if (!result)
+        MVE_ASSERT(result, vm, MVE_ERROR_INCOMPATIBLE_SIZES, "Incompatible program. The program requires more stack, memory or scopes than the VM has.");
 
-    vm->registers.all[reg] = value;
+    return result;
 }
 
 
-static void mve_op_str(MVE_VM *vm)
+/**
+ * @brief Loads the section with the sizes required by the program.
+ * 
+ * @param vm VM to load the section.
+ * @param length Length of the section.
+ * @return Returns false if the program does not fit in the VM.
+ */
+static MVEbool mve_load_header_sizes(MVE_VM *vm, uint32_t length) 
 {
-    // The register to load the value from.
-    uint8_t reg = mve_request_uint8(vm);
+    uint32_t stack_size = mve_request_uint32(vm);
+    uint32_t memory_size = mve_request_uint32(vm);
+    uint32_t scope_limit = mve_request_uint32(vm);
 
-    // The register that contains the index to load.
-    uint8_t reg_index = mve_request_uint8(vm);
+    // Newer programs may have more sizes, that this VM does not know.
+    if (length > 12)
+        mve_skip_program_bytes(vm, length - 12);
 
-    // The register that contains the amount o bytes to load.
-    uint8_t reg_length = mve_request_uint8(vm);
+    return mve_apply_sizes(vm, stack_size, memory_size, scope_limit);
+}
 
-    MVE_ASSERT_REGISTER(reg, "STR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_index, "STR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_length, "STR failed!", vm);
 
-    int32_t stack_address = vm->registers.all[reg_index].i;
-    uint32_t length = vm->registers.all[reg_length].i;
+/**
+ * @brief Loads the section with the size of the values of the program.
+ * 
+ * @param vm VM to load the section.
+ * @param length Length of the section.
+ * @return Returns false if the values of the program do not have the size of the values of the VM.
+ */
+static MVEbool mve_load_header_width(MVE_VM *vm, uint32_t length) 
+{
+    // An empty section does not require a size.
+    uint8_t width = length > 0 ? mve_request_uint8(vm) : MVE_BASE_TYPE_SIZE;
 
-    uint32_t address = 0;
+    if (length > 1)
+        mve_skip_program_bytes(vm, length - 1);
 
-    // If the stack_address is negative then the end of the stack is used.
-    // This is used when accessing scope memory.
-    if (stack_address < 0)
-        address = STACK_POINTER(vm) - (-stack_address);
-    else
-        address = stack_address;
+    MVEbool result = width == MVE_BASE_TYPE_SIZE;
 
-    // Copy the bytes from the register into the stack.
-    for (uint8_t i = 0; i < length; i++)
-    {
-        #ifdef MVE_BIG_ENDIAN
-            vm->stack[address + i] = vm->registers.all[reg].b[length - i - 1];
-        #else
-            vm->stack[address + i] = vm->registers.all[reg].b[i];
-        #endif
-    }
+    if (!result)
+        MVE_ASSERT(result, vm, MVE_ERROR_INCOMPATIBLE_WIDTH, "Incompatible program. The program requires values of another size than the ones of the VM.");
+
+    return result;
 }
 
 
-static void mve_op_lds(MVE_VM *vm) 
+#ifdef MVE_USE_EXPORTS
+/**
+ * @brief Loads the section with the functions exported by the program. Only the hash of each name is kept.
+ * 
+ * @param vm VM to load the section.
+ * @param length Length of the section.
+ * @return Returns false if the program has more exports than MVE_EXPORTS_LIMIT, or two of them with the same hash.
+ */
+static MVEbool mve_load_header_exports(MVE_VM *vm, uint32_t length) 
 {
-    // The register to receive the value.
-    uint8_t reg = mve_request_uint8(vm);
+    uint32_t read = 0;
 
-    MVE_ASSERT_REGISTER(reg, "LDS failed!", vm);
+    while (read < length)
+    {
+        MVEbool result = vm->exports_count < MVE_EXPORTS_LIMIT;
 
-    // Address of the stack and length of the bytes.
-    int32_t stack_address = mve_request_uint32(vm);
-    uint8_t length = mve_request_uint8(vm);
+        if (!result)
+        {
+            MVE_ASSERT(result, vm, MVE_ERROR_EXPORT_OUT_OF_RANGE, "Incompatible program. The program has more exports than MVE_EXPORTS_LIMIT.");
+            return MVE_FALSE;
+        }
 
-    MVE_Value value;
-    value.i = 0;
+        MVE_Export *export_info = &vm->exports[vm->exports_count++];
+        uint32_t hash = MVE_HASH_START;
+        uint8_t byte = mve_request_uint8(vm);
 
-    uint32_t address = 0;
+        read++;
 
-    // If the stack_address is negative then the end of the stack is used.
-    // This is used when accessing scope memory.
-    if (stack_address < 0)
-        address = STACK_POINTER(vm) - (-stack_address);
-    else
-        address = stack_address;
+        while (byte != '\0')
+        {
+            hash = mve_hash_byte(hash, byte);
+            byte = mve_request_uint8(vm);
+            read++;
+        }
 
-    MVE_ASSERT_STACK_ADDRESS(address, "LDS failed!", vm);
-    MVE_ASSERT_STACK_ADDRESS(address + length, "LDS failed!", vm);
+        // mve_find_export would only ever find the first one.
+        for (uint16_t i = 0; i < vm->exports_count - 1; i++) {
+            if (vm->exports[i].name_hash == hash)
+            {
+                MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_DUPLICATE_EXPORT, "Incompatible program. Two exports have the same name, or the same hash of their names.");
+                return MVE_FALSE;
+            }
+        }
 
-    // Copy the bytes from the stack into the value.
-    for (uint8_t i = 0; i < length; i++)
-    {
-        #ifdef MVE_BIG_ENDIAN
-            value.b[length - i - 1] = vm->stack[address + i];
-        #else
-            value.b[i] = vm->stack[address + i];
-        #endif
+        export_info->name_hash = hash;
+        export_info->program_index = mve_request_uint32(vm);
+
+        read += 4;
     }
 
-    vm->registers.all[reg] = value;
+    return MVE_TRUE;
 }
+#endif
 
 
-static void mve_op_sts(MVE_VM *vm)
+/**
+ * @brief Loads the sections of the header, until the end section.
+ * Unknown sections are skipped, so newer programs can still run.
+ * 
+ * @param vm VM to load the sections.
+ * @return Returns false if a section is not compatible with the VM.
+ */
+static MVEbool mve_load_header_sections(MVE_VM *vm) 
 {
-// The register to load the value from.
-    uint8_t reg = mve_request_uint8(vm);
-
-    MVE_ASSERT_REGISTER(reg, "STS failed!", vm);
+    uint8_t section = mve_request_uint8(vm);
 
-    // Address of the stack and length of the bytes.
-    int32_t stack_address = mve_request_int32(vm);
-    uint8_t length = mve_request_uint8(vm);
-
-    uint32_t address = 0;
-
-    // If the stack_address is negative then the end of the stack is used.
-    // This is used when accessing scope memory.
-    if (stack_address < 0)
-        address = STACK_POINTER(vm) - (-stack_address);
-    else
-        address = stack_address;
+    while (section != MVE_HEADER_END)
+    {
+        uint32_t length = mve_request_uint32(vm);
 
-    MVE_ASSERT_STACK_ADDRESS(address, "STS failed!", vm);
-    MVE_ASSERT_STACK_ADDRESS(address + length, "STS failed!", vm);
+        switch (section)
+        {
+        case MVE_HEADER_SIZES:
+            if (!mve_load_header_sizes(vm, length))
+                return MVE_FALSE;
+            break;
+        case MVE_HEADER_WIDTH:
+            if (!mve_load_header_width(vm, length))
+                return MVE_FALSE;
+            break;
+#ifdef MVE_USE_EXPORTS
+        case MVE_HEADER_EXPORTS:
+            if (!mve_load_header_exports(vm, length))
+                return MVE_FALSE;
+            break;
+#endif
+        default:
+            mve_skip_program_bytes(vm, length);
+            break;
+        }
 
-    // Copy the bytes from the register into the stack.
-    for (uint8_t i = 0; i < length; i++)
-    {
-        #ifdef MVE_BIG_ENDIAN
-            vm->stack[address + i] = vm->registers.all[reg].b[length - i - 1];
-        #else
-            vm->stack[address + i] = vm->registers.all[reg].b[i];
-        #endif
+        section = mve_request_uint8(vm);
     }
+
+    return MVE_TRUE;
 }
 
 
-static void mve_op_ldi(MVE_VM *vm) 
+#ifdef MVE_RUNTIME_SIZES
+/**
+ * @brief Takes a chunk of the arena memory with the given alignment.
+ * 
+ * @param arena Arena to take the memory from.
+ * @param size Amount of bytes.
+ * @param alignment Alignment of the chunk. Must be a power of two.
+ * @return Returns the memory, or NULL if the arena does not have enough space left.
+ */
+static void *mve_arena_take(MVE_Arena *arena, uint32_t size, uint32_t alignment)
 {
-    // The register to receive the value.
-    uint8_t reg = mve_request_uint8(vm);
-
-    MVE_ASSERT_REGISTER(reg, "LDI failed!", vm);
-    
-    // The amount of bytes to write.
-    uint8_t length = mve_request_uint8(vm);
+    uintptr_t address = (uintptr_t) (arena->memory + arena->used);
+    uint32_t start = arena->used + (uint32_t) ((alignment - (address & (alignment - 1))) & (alignment - 1));
 
-    MVE_Value value;
-    value.i = 0;
+    if (start > arena->size || size > arena->size - start)
+        return NULL;
 
-    // Get the bytes to write into the register.
-    for (uint8_t i = 0; i < length; i++)
-    {
-        #ifdef MVE_BIG_ENDIAN
-            value.b[sizeof(MVE_Value) - i - 1] = mve_request_uint8(vm);
-        #else
-            value.b[i] = mve_request_uint8(vm);
-        #endif
-    }
+    arena->used = start + size;
 
-    vm->registers.all[reg].i = value.i;
+    return arena->memory + start;
 }
 
 
-static void mve_op_mov(MVE_VM *vm) 
+/**
+ * @brief Carves the stack, memory and scopes of the VM from its arena.
+ * 
+ * @param vm VM to allocate the storage.
+ * @return Returns false if the arena does not have enough space left.
+ */
+static MVEbool mve_allocate_storage(MVE_VM *vm) 
 {
-    uint8_t reg_to = mve_request_uint8(vm);
-    uint8_t reg_from = mve_request_uint8(vm);
+    #ifndef MVE_GROWABLE_SCOPES
+        vm->scopes = (MVE_Scope_Info *) mve_arena_take(vm->arena, vm->scope_limit * sizeof(MVE_Scope_Info), MVE_CACHE_LINE_SIZE);
+    #endif
 
-    MVE_ASSERT_REGISTER(reg_to, "MOV failed!", vm);
-    MVE_ASSERT_REGISTER(reg_from, "MOV failed!", vm);
+    vm->stack = (uint8_t *) mve_arena_alloc(vm->arena, vm->stack_size);
+    vm->memory = (uint8_t *) mve_arena_alloc(vm->arena, vm->memory_size);
 
-    vm->registers.all[reg_to].i = vm->registers.all[reg_from].i;
-}
+    // Pad the end, so the next VM carved from the arena starts on a new cache line.
+    mve_arena_take(vm->arena, 0, MVE_CACHE_LINE_SIZE);
 
+    MVEbool result = vm->stack != NULL && vm->memory != NULL;
 
-static void mve_op_neg(MVE_VM *vm) 
-{
-    uint8_t reg = mve_request_uint8(vm);
+    #ifndef MVE_GROWABLE_SCOPES
+        result = result && vm->scopes != NULL;
+    #endif
 
-    MVE_ASSERT_REGISTER(reg, "NEG failed!", vm);
+    if (!result)
+        MVE_ASSERT(result, vm, MVE_ERROR_ARENA_EXHAUSTED, "Arena exhausted. There is not enough space for the stack, memory and scopes of the VM.");
 
-    vm->registers.all[reg].i = -vm->registers.all[reg].i;
+    return result;
 }
+#endif
 
 
-static void mve_op_add(MVE_VM *vm) 
+#ifdef MVE_GROWABLE_SCOPES
+/**
+ * @brief Allocates the initial scopes and frames of the VM, with MVE_REALLOC.
+ * 
+ * @param vm VM to allocate the scopes and frames.
+ * @return Returns false if the allocation failed.
+ */
+static MVEbool mve_allocate_scopes(MVE_VM *vm) 
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    vm->scopes = (MVE_Scope_Info *) MVE_REALLOC(NULL, vm->scope_limit * sizeof(MVE_Scope_Info));
+    vm->frames = (MVE_Frame *) MVE_REALLOC(NULL, vm->frame_limit * sizeof(MVE_Frame));
 
-    MVE_ASSERT_REGISTER(reg_result, "ADD failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "ADD failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "ADD failed!", vm);
+    MVEbool result = vm->scopes != NULL && vm->frames != NULL;
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i + vm->registers.all[reg_op2].i;
+    if (!result)
+    {
+        mve_release(vm);
+        MVE_ASSERT(result, vm, MVE_ERROR_ALLOCATION_FAILED, "Allocation failed. MVE_REALLOC cannot allocate the scopes and frames of the VM.");
+    }
+
+    return result;
 }
+#endif
 
 
-static void mve_op_sub(MVE_VM *vm) 
+/**
+ * @brief Loads and processes the header of the program.
+ * It the bytecode version of the program is not compatible, it will abort.
+ * 
+ * @param vm VM to load the header.
+ */
+static MVEbool mve_load_header(MVE_VM *vm) 
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    uint16_t major_version = MVE_BYTES_TO_UINT16(vm->program_buffer, 0);
+    uint16_t minor_version = MVE_BYTES_TO_UINT16(vm->program_buffer, 2);
 
-    MVE_ASSERT_REGISTER(reg_result, "SUB failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "SUB failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "SUB failed!", vm);
+    MVEbool result = major_version == MVE_VERSION_MAJOR && minor_version <= MVE_VERSION_MINOR;
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i - vm->registers.all[reg_op2].i;
-}
+    if (!result)
+    {
+        MVE_ASSERT(result, vm, MVE_ERROR_INCOMPATIBLE_VERSION, "Incompatible program. Please upgrade your MicroVE into a newer version or compile your program to an old one.");
+        return MVE_FALSE;
+    }
 
+    vm->buffer_index = 4;
 
-static void mve_op_mul(MVE_VM *vm) 
-{
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    // Header sections were added in the version 1.1.
+    if (minor_version >= 1 && !mve_load_header_sections(vm))
+        return MVE_FALSE;
 
-    MVE_ASSERT_REGISTER(reg_result, "MUL failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "MUL failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "MUL failed!", vm);
+    #ifdef MVE_RUNTIME_SIZES
+        if (!mve_allocate_storage(vm))
+            return MVE_FALSE;
+    #endif
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i * vm->registers.all[reg_op2].i;
-}
+    #ifdef MVE_GROWABLE_SCOPES
+        if (!mve_allocate_scopes(vm))
+            return MVE_FALSE;
+    #endif
 
+    uint16_t external_functions_length = mve_request_uint32(vm);
 
-static void mve_op_div(MVE_VM *vm) 
-{
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    uint8_t strings_counter = 0;
 
-    MVE_ASSERT_REGISTER(reg_result, "DIV failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "DIV failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "DIV failed!", vm);
+    // Load the function names.
+    for (uint32_t i = 0; i < MVE_VM_MEMORY_SIZE(vm) && strings_counter < external_functions_length; i++) {
+        vm->memory[i] = mve_request_uint8(vm);
+        
+        if (vm->memory[i] == '\0')
+            strings_counter++;
+    }
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i / vm->registers.all[reg_op2].i;
+    vm->external_functions_count = strings_counter;
+
+    #ifdef MVE_TRACK_USAGE
+        // The names are kept in the memory until the VM starts, so the memory must fit them.
+        uint32_t names_length = 0;
+
+        for (uint8_t i = 0; i < strings_counter; names_length++) {
+            if (vm->memory[names_length] == '\0')
+                i++;
+        }
+
+        vm->usage.peak_memory = names_length;
+    #endif
+
+    mve_load_scope_memory(vm);
+
+    return MVE_TRUE;
 }
 
 
-static void mve_op_invoke(MVE_VM *vm) 
+#if defined(MVE_PROFILE) || defined(MVE_SAMPLING) || defined(MVE_LOADER_STATS) || defined(MVE_TRACE)
+/**
+ * @brief Writes an unsigned number as text.
+ */
+static void mve_write_uint(MVE_Text_Writer fun_write, void *context, uint64_t value)
 {
-    // The function index according to the header declaration order.
-    uint16_t function_index = mve_request_uint16(vm);
+    char text[21];
+    uint8_t index = sizeof(text) - 1;
 
-    MVE_ASSERT(vm->external_functions_count > function_index, vm, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Invalid function index.");
+    text[index] = '\0';
 
-    void (*func) (MVE_VM *) = vm->external_functions[function_index];
+    do {
+        text[--index] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
 
-    MVE_ASSERT(func != NULL, vm, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Function was not linked into the VM."); 
-    
-    func(vm);
+    fun_write(context, text + index);
 }
+#endif
 
 
-static void mve_op_scope(MVE_VM *vm) 
+#ifdef MVE_PROFILE
+/**
+ * @brief Records an execution into a profile entry.
+ * 
+ * @param entry Entry of the OP or function executed.
+ * @param ticks Clock ticks the execution took.
+ */
+static inline void mve_profile_record(MVE_Profile_Entry *entry, uint64_t ticks)
 {
-    MVE_ASSERT(vm->scope_index + 1 < MVE_SCOPE_LIMIT, vm, MVE_ERROR_SCOPE_OUT_OF_RANGE, "SCOPE failed! There cannot be no more scopes than MVE_SCOPE_LIMIT.");
+    uint8_t bucket = 0;
 
-    vm->scope_index++;
-    vm->scopes[vm->scope_index].stack_base = STACK_POINTER(vm);
+    while (bucket < MVE_PROFILE_HISTOGRAM_SIZE - 1 && (ticks >> (bucket + 1)) != 0)
+        bucket++;
 
-    mve_load_scope_memory(vm);
+    entry->count++;
+    entry->cycles += ticks;
+    entry->histogram[bucket]++;
 }
 
 
-static void mve_op_end(MVE_VM *vm) 
-{
-    MVE_ASSERT(vm->scope_index - 1 >= 0, vm, MVE_ERROR_SCOPE_OUT_OF_RANGE, "END failed! There is no scope to end.");
 
-    STACK_POINTER(vm) = vm->scopes[vm->scope_index].stack_base;
 
-    uint32_t program_index = vm->scopes[vm->scope_index].program_index;
+/**
+ * @brief Writes a profile entry as a JSON object, with the given key and id, and the name if it is not NULL.
+ */
+static void mve_profile_write_entry(MVE_Text_Writer fun_write, void *context, const char *key, uint16_t id, const char *name, const MVE_Profile_Entry *entry)
+{
+    fun_write(context, "{\"");
+    fun_write(context, key);
+    fun_write(context, "\":");
+    mve_write_uint(fun_write, context, id);
 
-    if (program_index != 0) 
+    if (name != NULL)
     {
-        mve_jump_to_program_index(vm, program_index);
+        fun_write(context, ",\"name\":\"");
+        fun_write(context, name);
+        fun_write(context, "\"");
     }
 
-    // Reset the program index of the scope, otherwise JMPs would also bring back to this location.
-    vm->scopes[vm->scope_index].program_index = 0;
-    vm->scope_index--;
-}
+    fun_write(context, ",\"count\":");
+    mve_write_uint(fun_write, context, entry->count);
+    fun_write(context, ",\"cycles\":");
+    mve_write_uint(fun_write, context, entry->cycles);
+    fun_write(context, ",\"histogram\":[");
 
+    for (uint8_t i = 0; i < MVE_PROFILE_HISTOGRAM_SIZE; i++) {
+        if (i > 0)
+            fun_write(context, ",");
 
-static void mve_op_cmp(MVE_VM *vm) 
-{
-    uint8_t operation = mve_request_uint8(vm);
+        mve_write_uint(fun_write, context, entry->histogram[i]);
+    }
 
-    MVE_ASSERT(operation <= MVE_CMP_LESSEQUAL, vm, MVE_ERROR_UNRECOGNIZED_CMP_OPERATION, "CMP failed! Unrecognized compare operation.");
+    fun_write(context, "]}");
+}
 
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm); 
+#endif
 
-    MVE_ASSERT_REGISTER(reg_result, "CMP failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "CMP failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "CMP failed!", vm);
 
-    switch (operation)
-    {
-    case MVE_CMP_EQUAL:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i == vm->registers.all[reg_op2].i;
-        break;
-    case MVE_CMP_NOTEQUAL:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i != vm->registers.all[reg_op2].i;
-        break;
-    case MVE_CMP_GREATER:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i > vm->registers.all[reg_op2].i;
-        break;
-    case MVE_CMP_LESS:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i < vm->registers.all[reg_op2].i;
-        break;
-     case MVE_CMP_GREATEREQUAL:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i >= vm->registers.all[reg_op2].i;
-        break;
-    case MVE_CMP_LESSEQUAL:
-        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i <= vm->registers.all[reg_op2].i;
-        break;
-    default:
-        break;
+#ifdef MVE_SAMPLING
+/**
+ * @brief Records the call stack of the VM into the sampler. The return addresses are taken from the scopes created by CALLs, and the frames created by FCALLs.
+ * If there are more calls than MVE_SAMPLE_DEPTH, the innermost ones are dropped, but the program index being executed is always kept.
+ * 
+ * @param vm VM being sampled.
+ */
+static void mve_sample(MVE_VM *vm)
+{
+    MVE_Sampler *sampler = vm->sampler;
+    MVE_Sample *sample = &sampler->samples[sampler->count % sampler->capacity];
+    uint8_t depth = 0;
+    uint32_t frame = 0;
+
+    // The frames of FCALL are placed between the scopes, after the scope each one was called from.
+    for (uint32_t i = 0; i <= vm->scope_index && depth < MVE_SAMPLE_DEPTH - 1; i++) {
+        if (i > 0 && vm->scopes[i].program_index != 0)
+            sample->frames[depth++] = vm->scopes[i].program_index;
+
+        for (; frame < vm->frame_index && vm->frames[frame].scope_index == i && depth < MVE_SAMPLE_DEPTH - 1; frame++)
+            sample->frames[depth++] = vm->frames[frame].return_index;
     }
-}
-
 
-static void mve_op_jmp(MVE_VM *vm) 
-{
-    uint32_t index = mve_request_uint32(vm);
+    sample->frames[depth++] = mve_get_program_index(vm);
+    sample->depth = depth;
 
-    mve_jump_to_program_index(vm, index);
+    sampler->count++;
+    sampler->countdown = sampler->interval;
+    sampler->requested = 0;
 }
 
 
-static void mve_op_jnz(MVE_VM *vm) 
+/**
+ * @brief Finds the symbol that contains a program index, with a binary search over the symbols sorted by start.
+ * 
+ * @return Returns the symbol, or NULL if the program index is before all of them.
+ */
+static const MVE_Symbol *mve_find_symbol(const MVE_Symbol *symbols, uint32_t symbols_count, uint32_t program_index)
 {
-    uint8_t reg = mve_request_uint8(vm);
-    uint32_t index = mve_request_uint32(vm);
-
-    // Check if value on the register is different than 0 to jump.
-    if (vm->registers.all[reg].i != 0)
-        mve_jump_to_program_index(vm, index);
-}
-
+    uint32_t low = 0;
+    uint32_t high = symbols_count;
 
-static void mve_op_call(MVE_VM *vm) {
+    // Finds the first symbol that starts after the program index. The one before it contains the index.
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
 
-    uint32_t index = mve_request_uint32(vm);
+        if (symbols[middle].start <= program_index)
+            low = middle + 1;
+        else
+            high = middle;
+    }
 
-    MVE_ASSERT(vm->scope_index + 1 < MVE_SCOPE_LIMIT, vm, MVE_ERROR_SCOPE_LIMIT_REACHED, "CALL failed! Cannot have more scopes than MVE_SCOPE_LIMIT.");
-    
-    // Set the program index of the next scope, so after ending the next scope, the VM will go back to this location.
-    #ifdef MVE_LOCAL_PROGRAM
-        vm->scopes[vm->scope_index + 1].program_index = vm->buffer_index;
-    #else
-        vm->scopes[vm->scope_index + 1].program_index = vm->program_index - MVE_BUFFER_SIZE + vm->buffer_index;
-    #endif
-    
-    mve_jump_to_program_index(vm, index);
+    return low > 0 ? &symbols[low - 1] : NULL;
 }
 
 
-static void mve_op_and(MVE_VM *vm)
+/**
+ * @brief Writes the name of the symbol that contains a program index, or the program index itself if there is none.
+ */
+static void mve_write_symbol(const MVE_Symbol *symbols, uint32_t symbols_count, uint32_t program_index, MVE_Text_Writer fun_write, void *context)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
-
-    MVE_ASSERT_REGISTER(reg_result, "AND failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "AND failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "AND failed!", vm);
+    const MVE_Symbol *found = mve_find_symbol(symbols, symbols_count, program_index);
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i & vm->registers.all[reg_op2].i;
+    if (found != NULL) 
+        fun_write(context, found->name);
+    else
+        mve_write_uint(fun_write, context, program_index);
 }
 
 
-static void mve_op_orr(MVE_VM *vm) 
+/**
+ * @brief Orders 2 samples by their depth and then by their frames.
+ * 
+ * @return Returns a negative number if a is first, a positive one if b is first, or 0 if they have the same call stack.
+ */
+static int mve_sample_compare(const MVE_Sample *a, const MVE_Sample *b)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    if (a->depth != b->depth)
+        return a->depth < b->depth ? -1 : 1;
 
-    MVE_ASSERT_REGISTER(reg_result, "ORR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "ORR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "ORR failed!", vm);
+    for (uint8_t i = 0; i < a->depth; i++) {
+        if (a->frames[i] != b->frames[i])
+            return a->frames[i] < b->frames[i] ? -1 : 1;
+    }
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i | vm->registers.all[reg_op2].i;
+    return 0;
 }
 
 
-static void mve_op_not(MVE_VM *vm) 
+/**
+ * @brief Moves a sample down a heap of samples, until it is not smaller than its children.
+ */
+static void mve_sift_sample(MVE_Sample *samples, uint32_t root, uint32_t count)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
+    while (root * 2 + 1 < count)
+    {
+        uint32_t child = root * 2 + 1;
 
-    MVE_ASSERT_REGISTER(reg_result, "NOT failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "NOT failed!", vm);
+        if (child + 1 < count && mve_sample_compare(&samples[child], &samples[child + 1]) < 0)
+            child++;
 
-    vm->registers.all[reg_result].i = ~vm->registers.all[reg_op1].i;
+        if (mve_sample_compare(&samples[root], &samples[child]) >= 0)
+            return;
+
+        MVE_Sample swap = samples[root];
+        samples[root] = samples[child];
+        samples[child] = swap;
+        root = child;
+    }
 }
 
 
-static void mve_op_lsl(MVE_VM *vm) 
+/**
+ * @brief Sorts samples with a heap sort, which needs no recursion or extra memory.
+ */
+static void mve_sort_samples(MVE_Sample *samples, uint32_t count)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    for (uint32_t i = count / 2; i > 0; i--)
+        mve_sift_sample(samples, i - 1, count);
 
-    MVE_ASSERT_REGISTER(reg_result, "LSL failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "LSL failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "LSL failed!", vm);
+    for (uint32_t end = count; end > 1; end--) {
+        MVE_Sample swap = samples[0];
+        samples[0] = samples[end - 1];
+        samples[end - 1] = swap;
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i << vm->registers.all[reg_op2].i;
+        mve_sift_sample(samples, 0, end - 1);
+    }
 }
+#endif
 
 
-static void mve_op_xor(MVE_VM *vm) 
+static void mve_op_ldr(MVE_VM *vm)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
-
-    MVE_ASSERT_REGISTER(reg_result, "XOR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "XOR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "XOR failed!", vm);
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i ^ vm->registers.all[reg_op2].i;
-}
+    // The register that contains the index to load.
+    uint8_t reg_index = mve_request_uint8(vm);
 
+    // The register that contains the amount o bytes to load.
+    uint8_t reg_length = mve_request_uint8(vm);
 
-static void mve_op_inc(MVE_VM *vm) 
-{
-    uint8_t reg_op = mve_request_uint8(vm);
+    MVE_ASSERT_REGISTER(reg, "LDR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "LDR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "LDR failed!", vm);
 
-    MVE_ASSERT_REGISTER(reg_op, "INC failed!", vm);
+    MVE_Value value;
+    value.i = 0;
 
-    vm->registers.all[reg_op].i++;
-}
+    int32_t stack_address = vm->registers.all[reg_index].i;
+    uint32_t length = vm->registers.all[reg_length].i;
 
+    uint32_t address = 0;
 
-static void mve_op_dec(MVE_VM *vm) 
-{
-    uint8_t reg_op = mve_request_uint8(vm);
+    // If the stack_address is negative then the end of the stack is used.
+    // This is used when accessing scope memory.
+    if (stack_address < 0)
+        address = STACK_POINTER(vm) - (-stack_address);
+    else
+        address = stack_address;
 
-    MVE_ASSERT_REGISTER(reg_op, "DEC failed!", vm);
+    // Copy the bytes from the stack into the value.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[length - i - 1] = vm->stack[address + i];
+        #else
+            value.b[i] = vm->stack[address + i];
+        #endif
+    }
 
-    vm->registers.all[reg_op].i--;
+    vm->registers.all[reg] = value;
 }
 
 
-static void mve_op_lsr(MVE_VM *vm) 
+static void mve_op_str(MVE_VM *vm)
 {
-    uint8_t reg_result = mve_request_uint8(vm);
-    uint8_t reg_op1 = mve_request_uint8(vm);
-    uint8_t reg_op2 = mve_request_uint8(vm);
+    // The register to load the value from.
+    uint8_t reg = mve_request_uint8(vm);
 
-    MVE_ASSERT_REGISTER(reg_result, "LSR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op1, "LSR failed!", vm);
-    MVE_ASSERT_REGISTER(reg_op2, "LSR failed!", vm);
+    // The register that contains the index to load.
+    uint8_t reg_index = mve_request_uint8(vm);
 
-    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i >> vm->registers.all[reg_op2].i;
-}
+    // The register that contains the amount o bytes to load.
+    uint8_t reg_length = mve_request_uint8(vm);
 
+    MVE_ASSERT_REGISTER(reg, "STR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "STR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "STR failed!", vm);
 
-static void mve_op_push(MVE_VM *vm) 
-{
-    // The register containing the value.
-    uint8_t reg = mve_request_uint8(vm);
+    int32_t stack_address = vm->registers.all[reg_index].i;
+    uint32_t length = vm->registers.all[reg_length].i;
 
-    MVE_ASSERT_REGISTER(reg, "PUSH failed!", vm);
-    
-    // The amount of bytes to write.
-    uint8_t length = mve_request_uint8(vm);
+    uint32_t address = 0;
 
-    MVE_ASSERT_MEMORY_ADDRESS(length + MEMORY_POINTER(vm), "PUSH failed!", vm);
+    // If the stack_address is negative then the end of the stack is used.
+    // This is used when accessing scope memory.
+    if (stack_address < 0)
+        address = STACK_POINTER(vm) - (-stack_address);
+    else
+        address = stack_address;
 
-    // Copy the bytes from the register into the memory.
+    // Copy the bytes from the register into the stack.
     for (uint8_t i = 0; i < length; i++)
     {
         #ifdef MVE_BIG_ENDIAN
-            vm->memory[MEMORY_POINTER(vm) + i] = vm->registers.all[reg].b[length - i - 1];
+            vm->stack[address + i] = vm->registers.all[reg].b[length - i - 1];
         #else
-            vm->memory[MEMORY_POINTER(vm) + i] = vm->registers.all[reg].b[i];
+            vm->stack[address + i] = vm->registers.all[reg].b[i];
         #endif
     }
-
-    MEMORY_POINTER(vm) += length;
 }
 
 
-static void mve_op_pop(MVE_VM *vm) 
+static void mve_op_lds(MVE_VM *vm) 
 {
     // The register to receive the value.
     uint8_t reg = mve_request_uint8(vm);
 
-    MVE_ASSERT_REGISTER(reg, "POP failed!", vm);
-    
-    // The amount of bytes to pop.
-    uint8_t length = mve_request_uint8(vm);
+    MVE_ASSERT_REGISTER(reg, "LDS failed!", vm);
 
-    MVE_ASSERT_MEMORY_ADDRESS(MEMORY_POINTER(vm) - length, "POP failed!", vm);
+    // Address of the stack and length of the bytes.
+    int32_t stack_address = mve_request_uint32(vm);
+    uint8_t length = mve_request_uint8(vm);
 
-    uint8_t clamped_length = length < MVE_BASE_TYPE_SIZE ? length : MVE_BASE_TYPE_SIZE; 
     MVE_Value value;
     value.i = 0;
 
+    uint32_t address = 0;
 
-    // Copy the bytes from the memory into the register.
-    for (uint8_t i = 0; i < clamped_length; i++)
+    // If the stack_address is negative then the end of the stack is used.
+    // This is used when accessing scope memory.
+    if (stack_address < 0)
+        address = STACK_POINTER(vm) - (-stack_address);
+    else
+        address = stack_address;
+
+    MVE_ASSERT_STACK_ADDRESS(address, "LDS failed!", vm);
+    MVE_ASSERT_STACK_ADDRESS(address + length, "LDS failed!", vm);
+
+    // Copy the bytes from the stack into the value.
+    for (uint8_t i = 0; i < length; i++)
     {
         #ifdef MVE_BIG_ENDIAN
-            value.b[i] = vm->memory[MEMORY_POINTER(vm) - i - 1];
+            value.b[length - i - 1] = vm->stack[address + i];
         #else
-            value.b[clamped_length - i - 1] = vm->memory[MEMORY_POINTER(vm) - i - 1]; 
+            value.b[i] = vm->stack[address + i];
         #endif
     }
 
-    MEMORY_POINTER(vm) -= length;
     vm->registers.all[reg] = value;
 }
 
 
-static void mve_op_ladr(MVE_VM *vm) 
+static void mve_op_sts(MVE_VM *vm)
 {
-    // The register to receive the value.
+// The register to load the value from.
     uint8_t reg = mve_request_uint8(vm);
 
-    MVE_ASSERT_REGISTER(reg, "LADR failed!", vm);
-    
+    MVE_ASSERT_REGISTER(reg, "STS failed!", vm);
+
     // Address of the stack and length of the bytes.
     int32_t stack_address = mve_request_int32(vm);
+    uint8_t length = mve_request_uint8(vm);
 
     uint32_t address = 0;
 
@@ -809,192 +1235,2604 @@ static void mve_op_ladr(MVE_VM *vm)
     else
         address = stack_address;
 
-    MVE_ASSERT_STACK_ADDRESS(address, "LADR failed!", vm);
+    MVE_ASSERT_STACK_ADDRESS(address, "STS failed!", vm);
+    MVE_ASSERT_STACK_ADDRESS(address + length, "STS failed!", vm);
 
-    vm->registers.all[reg].i = address;
+    // Copy the bytes from the register into the stack.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            vm->stack[address + i] = vm->registers.all[reg].b[length - i - 1];
+        #else
+            vm->stack[address + i] = vm->registers.all[reg].b[i];
+        #endif
+    }
 }
 
 
-#ifdef MVE_LOCAL_PROGRAM
-MVEbool mve_init(MVE_VM *vm, uint8_t *program) 
+static void mve_op_ldi(MVE_VM *vm) 
+{
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "LDI failed!", vm);
+    
+    // The amount of bytes to write.
+    uint8_t length = mve_request_uint8(vm);
+
+    MVE_Value value;
+    value.i = 0;
+
+    // Get the bytes to write into the register.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[sizeof(MVE_Value) - i - 1] = mve_request_uint8(vm);
+        #else
+            value.b[i] = mve_request_uint8(vm);
+        #endif
+    }
+
+    vm->registers.all[reg].i = value.i;
+}
+
+
+static void mve_op_mov(MVE_VM *vm) 
+{
+    uint8_t reg_to = mve_request_uint8(vm);
+    uint8_t reg_from = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_to, "MOV failed!", vm);
+    MVE_ASSERT_REGISTER(reg_from, "MOV failed!", vm);
+
+    vm->registers.all[reg_to].i = vm->registers.all[reg_from].i;
+}
+
+
+static void mve_op_neg(MVE_VM *vm) 
+{
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "NEG failed!", vm);
+
+    vm->registers.all[reg].i = -vm->registers.all[reg].i;
+}
+
+
+static void mve_op_add(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "ADD failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "ADD failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "ADD failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i + vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_sub(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "SUB failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "SUB failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "SUB failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i - vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_mul(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "MUL failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "MUL failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "MUL failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i * vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_div(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "DIV failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "DIV failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "DIV failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i / vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_invoke(MVE_VM *vm) 
+{
+    // The function index according to the header declaration order.
+    uint16_t function_index = mve_request_uint16(vm);
+
+    MVE_ASSERT(vm->external_functions_count > function_index, vm, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Invalid function index.");
+
+    void (*func) (MVE_VM *) = (void (*) (MVE_VM *)) vm->external_functions[function_index];
+
+    vm->invoked_function = function_index;
+
+    MVE_ASSERT(func != NULL, vm, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Function was not linked into the VM."); 
+    
+#ifdef MVE_PROFILE
+    if (vm->profile != NULL)
+    {
+        uint64_t start = MVE_CLOCK();
+        func(vm);
+        mve_profile_record(&vm->profile->external_functions[function_index], MVE_CLOCK() - start);
+        return;
+    }
+#endif
+
+    func(vm);
+}
+
+
+static void mve_op_scope(MVE_VM *vm) 
+{
+    MVE_GROW_SCOPES(vm);
+    MVE_ASSERT(vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm), vm, MVE_ERROR_SCOPE_OUT_OF_RANGE, "SCOPE failed! There cannot be no more scopes than MVE_SCOPE_LIMIT.");
+
+    vm->scope_index++;
+    vm->scopes[vm->scope_index].stack_base = STACK_POINTER(vm);
+
+    mve_load_scope_memory(vm);
+}
+
+
+static void mve_op_end(MVE_VM *vm) 
+{
+    MVE_ASSERT(vm->scope_index - 1 >= 0, vm, MVE_ERROR_SCOPE_OUT_OF_RANGE, "END failed! There is no scope to end.");
+
+    STACK_POINTER(vm) = vm->scopes[vm->scope_index].stack_base;
+
+    uint32_t program_index = vm->scopes[vm->scope_index].program_index;
+
+    if (program_index != 0) 
+    {
+        mve_jump_to_program_index(vm, program_index);
+    }
+
+    // Reset the program index of the scope, otherwise JMPs would also bring back to this location.
+    vm->scopes[vm->scope_index].program_index = 0;
+    vm->scope_index--;
+}
+
+
+static void mve_op_cmp(MVE_VM *vm) 
+{
+    uint8_t operation = mve_request_uint8(vm);
+
+    MVE_ASSERT(operation <= MVE_CMP_LESSEQUAL, vm, MVE_ERROR_UNRECOGNIZED_CMP_OPERATION, "CMP failed! Unrecognized compare operation.");
+
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm); 
+
+    MVE_ASSERT_REGISTER(reg_result, "CMP failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "CMP failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "CMP failed!", vm);
+
+    switch (operation)
+    {
+    case MVE_CMP_EQUAL:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i == vm->registers.all[reg_op2].i;
+        break;
+    case MVE_CMP_NOTEQUAL:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i != vm->registers.all[reg_op2].i;
+        break;
+    case MVE_CMP_GREATER:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i > vm->registers.all[reg_op2].i;
+        break;
+    case MVE_CMP_LESS:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i < vm->registers.all[reg_op2].i;
+        break;
+     case MVE_CMP_GREATEREQUAL:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i >= vm->registers.all[reg_op2].i;
+        break;
+    case MVE_CMP_LESSEQUAL:
+        vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i <= vm->registers.all[reg_op2].i;
+        break;
+    default:
+        break;
+    }
+}
+
+
+static void mve_op_jmp(MVE_VM *vm) 
+{
+    uint32_t index = mve_request_uint32(vm);
+
+    mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_jnz(MVE_VM *vm) 
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint32_t index = mve_request_uint32(vm);
+
+    // Check if value on the register is different than 0 to jump.
+    if (vm->registers.all[reg].i != 0)
+        mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_switch(MVE_VM *vm) 
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint32_t default_index = mve_request_uint32(vm);
+    uint32_t count = mve_request_uint32(vm);
+
+    MVE_ASSERT_REGISTER(reg, "SWITCH failed!", vm);
+
+    if (vm->registers.all[reg].i >= count)
+    {
+        mve_jump_to_program_index(vm, default_index);
+        return;
+    }
+
+    // The table is right after the count. Only the entry of the value is read, so the rest of the table is never loaded.
+    uint32_t entry = mve_get_program_index(vm) + (uint32_t) vm->registers.all[reg].i * 4;
+
+    mve_jump_to_program_index(vm, mve_read_program_uint32(vm, entry));
+}
+
+
+static void mve_op_loop(MVE_VM *vm) 
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint32_t index = mve_request_uint32(vm);
+
+    MVE_ASSERT_REGISTER(reg, "LOOP failed!", vm);
+
+    if (--vm->registers.all[reg].i == 0)
+        return;
+
+    mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_call(MVE_VM *vm) {
+
+    uint32_t index = mve_request_uint32(vm);
+
+    MVE_GROW_SCOPES(vm);
+    MVE_ASSERT(vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm), vm, MVE_ERROR_SCOPE_LIMIT_REACHED, "CALL failed! Cannot have more scopes than MVE_SCOPE_LIMIT.");
+    
+    // Set the program index of the next scope, so after ending the next scope, the VM will go back to this location.
+    vm->scopes[vm->scope_index + 1].program_index = mve_get_program_index(vm);
+    
+    mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_and(MVE_VM *vm)
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "AND failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "AND failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "AND failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i & vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_orr(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "ORR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "ORR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "ORR failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i | vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_not(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "NOT failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "NOT failed!", vm);
+
+    vm->registers.all[reg_result].i = ~vm->registers.all[reg_op1].i;
+}
+
+
+static void mve_op_lsl(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "LSL failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "LSL failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "LSL failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i << vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_xor(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "XOR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "XOR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "XOR failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i ^ vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_inc(MVE_VM *vm) 
+{
+    uint8_t reg_op = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_op, "INC failed!", vm);
+
+    vm->registers.all[reg_op].i++;
+}
+
+
+static void mve_op_dec(MVE_VM *vm) 
+{
+    uint8_t reg_op = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_op, "DEC failed!", vm);
+
+    vm->registers.all[reg_op].i--;
+}
+
+
+static void mve_op_lsr(MVE_VM *vm) 
+{
+    uint8_t reg_result = mve_request_uint8(vm);
+    uint8_t reg_op1 = mve_request_uint8(vm);
+    uint8_t reg_op2 = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_result, "LSR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op1, "LSR failed!", vm);
+    MVE_ASSERT_REGISTER(reg_op2, "LSR failed!", vm);
+
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i >> vm->registers.all[reg_op2].i;
+}
+
+
+static void mve_op_push(MVE_VM *vm) 
+{
+    // The register containing the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "PUSH failed!", vm);
+    
+    // The amount of bytes to write.
+    uint8_t length = mve_request_uint8(vm);
+
+    MVE_ASSERT_MEMORY_ADDRESS(length + MEMORY_POINTER(vm), "PUSH failed!", vm);
+
+    // Copy the bytes from the register into the memory.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            vm->memory[MEMORY_POINTER(vm) + i] = vm->registers.all[reg].b[length - i - 1];
+        #else
+            vm->memory[MEMORY_POINTER(vm) + i] = vm->registers.all[reg].b[i];
+        #endif
+    }
+
+    MEMORY_POINTER(vm) += length;
+}
+
+
+static void mve_op_pop(MVE_VM *vm) 
+{
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "POP failed!", vm);
+    
+    // The amount of bytes to pop.
+    uint8_t length = mve_request_uint8(vm);
+
+    MVE_ASSERT_MEMORY_ADDRESS(MEMORY_POINTER(vm) - length, "POP failed!", vm);
+
+    uint8_t clamped_length = length < MVE_BASE_TYPE_SIZE ? length : MVE_BASE_TYPE_SIZE; 
+    MVE_Value value;
+    value.i = 0;
+
+
+    // Copy the bytes from the memory into the register.
+    for (uint8_t i = 0; i < clamped_length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[i] = vm->memory[MEMORY_POINTER(vm) - i - 1];
+        #else
+            value.b[clamped_length - i - 1] = vm->memory[MEMORY_POINTER(vm) - i - 1]; 
+        #endif
+    }
+
+    MEMORY_POINTER(vm) -= length;
+    vm->registers.all[reg] = value;
+}
+
+
+static void mve_op_pushm(MVE_VM *vm) 
+{
+    // Each bit is a register to push, starting in the lowest bit with the first register.
+    uint16_t mask = mve_request_uint16(vm);
+
+    // The amount of bytes to write for each register.
+    uint8_t length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER_MASK(mask, "PUSHM failed!", vm);
+    MVE_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, MVE_ERROR_INVALID_LENGTH, "PUSHM failed! The length cannot be bigger than the size of a register.");
+
+    // Without MVE_ERROR_LOG the checks are removed, so the bits past the registers are ignored.
+    mask &= MVE_REGISTERS_MASK;
+
+    uint8_t count = 0;
+
+    for (uint16_t bits = mask; bits != 0; bits &= bits - 1)
+        count++;
+
+    MVE_ASSERT_MEMORY_ADDRESS(count * length + MEMORY_POINTER(vm), "PUSHM failed!", vm);
+
+    uint8_t *memory = vm->memory + MEMORY_POINTER(vm);
+
+    // Copy the bytes from the registers into the memory, one after the other.
+    for (uint8_t reg = 0; reg < MVE_REGISTERS_MASK_SIZE; reg++)
+    {
+        if (!(mask & (1u << reg)))
+            continue;
+
+        #ifdef MVE_BIG_ENDIAN
+            for (uint8_t i = 0; i < length; i++)
+                memory[i] = vm->registers.all[reg].b[length - i - 1];
+        #else
+            memcpy(memory, vm->registers.all[reg].b, length);
+        #endif
+
+        memory += length;
+    }
+
+    MEMORY_POINTER(vm) = memory - vm->memory;
+}
+
+
+/**
+ * @brief Ends the scopes created after a frame, leaving the scope of its FCALL as the current one.
+ * 
+ * @param vm VM to end the scopes.
+ * @param frame Frame which scopes are ended.
+ */
+static inline void mve_unwind_frame(MVE_VM *vm, const MVE_Frame *frame)
+{
+    if (vm->scope_index == frame->scope_index)
+        return;
+
+    STACK_POINTER(vm) = vm->scopes[frame->scope_index + 1].stack_base;
+
+    // Reset the program index of each scope, like END does.
+    for (uint32_t i = frame->scope_index + 1; i <= vm->scope_index; i++)
+        vm->scopes[i].program_index = 0;
+
+    vm->scope_index = frame->scope_index;
+}
+
+
+static void mve_op_fcall(MVE_VM *vm)
+{
+    uint32_t index = mve_request_uint32(vm);
+
+    MVE_GROW_FRAMES(vm);
+    MVE_ASSERT(vm->frame_index < MVE_VM_FRAME_LIMIT(vm), vm, MVE_ERROR_FRAME_LIMIT_REACHED, "FCALL failed! Cannot have more frames than MVE_FRAME_LIMIT.");
+
+    MVE_Frame *frame = &vm->frames[vm->frame_index++];
+
+    frame->return_index = mve_get_program_index(vm);
+    frame->scope_index = vm->scope_index;
+
+    mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_ret(MVE_VM *vm)
+{
+    MVE_ASSERT(vm->frame_index > 0, vm, MVE_ERROR_FRAME_OUT_OF_RANGE, "RET failed! There is no frame to return from.");
+
+    MVE_Frame *frame = &vm->frames[--vm->frame_index];
+
+    mve_unwind_frame(vm, frame);
+    mve_jump_to_program_index(vm, frame->return_index);
+}
+
+
+static void mve_op_tcall(MVE_VM *vm)
+{
+    uint32_t index = mve_request_uint32(vm);
+
+    MVE_ASSERT(vm->frame_index > 0, vm, MVE_ERROR_FRAME_OUT_OF_RANGE, "TCALL failed! There is no frame to reuse.");
+
+    // The frame is kept, so the called location returns straight to the caller of the current one.
+    mve_unwind_frame(vm, &vm->frames[vm->frame_index - 1]);
+    mve_jump_to_program_index(vm, index);
+}
+
+
+static void mve_op_popm(MVE_VM *vm) 
+{
+    // Each bit is a register to pop into, starting in the lowest bit with the first register.
+    uint16_t mask = mve_request_uint16(vm);
+
+    // The amount of bytes to pop for each register.
+    uint8_t length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER_MASK(mask, "POPM failed!", vm);
+    MVE_ASSERT(!(mask & (1u << MVE_REGISTER_MP)), vm, MVE_ERROR_REGISTER_OUT_OF_RANGE, "POPM failed! The memory pointer cannot be popped.");
+    MVE_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, MVE_ERROR_INVALID_LENGTH, "POPM failed! The length cannot be bigger than the size of a register.");
+
+    // Without MVE_ERROR_LOG the checks are removed, so the bits past the registers and the memory pointer are ignored.
+    mask &= MVE_REGISTERS_MASK & ~(1u << MVE_REGISTER_MP);
+
+    uint8_t count = 0;
+
+    for (uint16_t bits = mask; bits != 0; bits &= bits - 1)
+        count++;
+
+    MVE_ASSERT_MEMORY_ADDRESS(MEMORY_POINTER(vm) - count * length, "POPM failed!", vm);
+
+    uint8_t *memory = vm->memory + MEMORY_POINTER(vm);
+
+    // Copy the bytes from the memory into the registers, from the last pushed.
+    for (int8_t reg = MVE_REGISTERS_MASK_SIZE - 1; reg >= 0; reg--)
+    {
+        if (!(mask & (1u << reg)))
+            continue;
+
+        memory -= length;
+
+        MVE_Value value;
+        value.i = 0;
+
+        #ifdef MVE_BIG_ENDIAN
+            for (uint8_t i = 0; i < length; i++)
+                value.b[i] = memory[length - i - 1];
+        #else
+            memcpy(value.b, memory, length);
+        #endif
+
+        vm->registers.all[reg] = value;
+    }
+
+    MEMORY_POINTER(vm) = memory - vm->memory;
+}
+
+
+static void mve_op_ladr(MVE_VM *vm) 
+{
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "LADR failed!", vm);
+    
+    // Address of the stack and length of the bytes.
+    int32_t stack_address = mve_request_int32(vm);
+
+    uint32_t address = 0;
+
+    // If the stack_address is negative then the end of the stack is used.
+    // This is used when accessing scope memory.
+    if (stack_address < 0)
+        address = STACK_POINTER(vm) - (-stack_address);
+    else
+        address = stack_address;
+
+    MVE_ASSERT_STACK_ADDRESS(address, "LADR failed!", vm);
+
+    vm->registers.all[reg].i = address;
+}
+
+
+/**
+ * @brief Returns the absolute stack address of an address from a register.
+ * Negative addresses are relative to the end of the stack.
+ */
+static inline uint32_t mve_get_stack_address(MVE_VM *vm, int32_t stack_address)
+{
+    if (stack_address < 0)
+        return STACK_POINTER(vm) - (-stack_address);
+
+    return stack_address;
+}
+
+
+#ifdef MVE_USE_BYTE_OPS
+static void mve_op_strlen(MVE_VM *vm)
+{
+    uint8_t reg = mve_request_uint8(vm);
+
+    // The register that contains the stack address of the bytes.
+    uint8_t reg_index = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "STRLEN failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "STRLEN failed!", vm);
+
+    uint32_t address = mve_get_stack_address(vm, vm->registers.all[reg_index].i);
+
+    MVE_ASSERT_STACK_ADDRESS(address, "STRLEN failed!", vm);
+
+    // Without a 0, the length goes up to the end of the stack.
+    vm->registers.all[reg].i = mve_bytes_find(vm->stack + address, MVE_VM_STACK_SIZE(vm) - address, 0);
+}
+
+
+static void mve_op_findbyte(MVE_VM *vm)
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint8_t reg_index = mve_request_uint8(vm);
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    // The register that contains the byte to find, in its lowest byte.
+    uint8_t reg_value = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "FINDBYTE failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "FINDBYTE failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "FINDBYTE failed!", vm);
+    MVE_ASSERT_REGISTER(reg_value, "FINDBYTE failed!", vm);
+
+    uint32_t address = mve_get_stack_address(vm, vm->registers.all[reg_index].i);
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT_STACK_RANGE(address, length, "FINDBYTE failed!", vm);
+
+    vm->registers.all[reg].i = mve_bytes_find(vm->stack + address, length, (uint8_t) vm->registers.all[reg_value].i);
+}
+
+
+static void mve_op_memcmp(MVE_VM *vm)
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint8_t reg_index1 = mve_request_uint8(vm);
+    uint8_t reg_index2 = mve_request_uint8(vm);
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "MEMCMP failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index1, "MEMCMP failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index2, "MEMCMP failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "MEMCMP failed!", vm);
+
+    uint32_t address1 = mve_get_stack_address(vm, vm->registers.all[reg_index1].i);
+    uint32_t address2 = mve_get_stack_address(vm, vm->registers.all[reg_index2].i);
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT_STACK_RANGE(address1, length, "MEMCMP failed!", vm);
+    MVE_ASSERT_STACK_RANGE(address2, length, "MEMCMP failed!", vm);
+
+    uint32_t mismatch = mve_bytes_mismatch(vm->stack + address1, vm->stack + address2, length);
+
+    // 0 if they are equal, so JNZ can be used after it. Otherwise, the index of the first different byte plus 1.
+    vm->registers.all[reg].i = mismatch < length ? mismatch + 1 : 0;
+}
+
+
+static void mve_op_crc32c(MVE_VM *vm)
+{
+    // The register with the CRC to continue, which receives the result. Starts at 0.
+    uint8_t reg = mve_request_uint8(vm);
+    uint8_t reg_index = mve_request_uint8(vm);
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "CRC32C failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "CRC32C failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "CRC32C failed!", vm);
+
+    uint32_t address = mve_get_stack_address(vm, vm->registers.all[reg_index].i);
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT_STACK_RANGE(address, length, "CRC32C failed!", vm);
+
+    vm->registers.all[reg].i = mve_bytes_crc32c((uint32_t) vm->registers.all[reg].i, vm->stack + address, length);
+}
+#endif
+
+
+#ifdef MVE_USE_REGIONS
+/**
+ * @brief Returns the region linked into the VM at the given index.
+ * 
+ * @param vm VM that owns the region.
+ * @param index Index of the region.
+ * @return Returns the region.
+ */
+static inline MVE_Region *mve_get_region(MVE_VM *vm, uint8_t index)
+{
+    MVE_ASSERT(index < MVE_REGIONS_LIMIT && vm->regions[index].data != NULL, vm, MVE_ERROR_REGION_OUT_OF_RANGE, "Region failed! The region was not linked into the VM.");
+
+    return &vm->regions[index];
+}
+
+
+static void mve_op_ldx(MVE_VM *vm)
+{
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    // The index of the region to load from.
+    uint8_t region_index = mve_request_uint8(vm);
+
+    // The register that contains the index in the region.
+    uint8_t reg_index = mve_request_uint8(vm);
+
+    // The register that contains the amount of bytes to load.
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "LDX failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "LDX failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "LDX failed!", vm);
+
+    MVE_Region *region = mve_get_region(vm, region_index);
+
+    uint32_t address = vm->registers.all[reg_index].i;
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, MVE_ERROR_INVALID_LENGTH, "LDX failed! The length cannot be bigger than the size of a register.");
+    MVE_ASSERT(address <= region->length && length <= region->length - address, vm, MVE_ERROR_REGION_ADDRESS_OUT_OF_RANGE, "LDX failed! The bytes cannot go past the end of the region.");
+
+    MVE_Value value;
+    value.i = 0;
+
+    // Copy the bytes from the region into the value.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[length - i - 1] = region->data[address + i];
+        #else
+            value.b[i] = region->data[address + i];
+        #endif
+    }
+
+    vm->registers.all[reg] = value;
+}
+
+
+static void mve_op_stx(MVE_VM *vm)
+{
+    // The register to load the value from.
+    uint8_t reg = mve_request_uint8(vm);
+
+    // The index of the region to store into.
+    uint8_t region_index = mve_request_uint8(vm);
+
+    // The register that contains the index in the region.
+    uint8_t reg_index = mve_request_uint8(vm);
+
+    // The register that contains the amount of bytes to store.
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "STX failed!", vm);
+    MVE_ASSERT_REGISTER(reg_index, "STX failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "STX failed!", vm);
+
+    MVE_Region *region = mve_get_region(vm, region_index);
+
+    uint32_t address = vm->registers.all[reg_index].i;
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT(region->writable, vm, MVE_ERROR_REGION_READ_ONLY, "STX failed! The region was linked as read only.");
+    MVE_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, MVE_ERROR_INVALID_LENGTH, "STX failed! The length cannot be bigger than the size of a register.");
+    MVE_ASSERT(address <= region->length && length <= region->length - address, vm, MVE_ERROR_REGION_ADDRESS_OUT_OF_RANGE, "STX failed! The bytes cannot go past the end of the region.");
+
+    // Copy the bytes from the register into the region.
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            region->data[address + i] = vm->registers.all[reg].b[length - i - 1];
+        #else
+            region->data[address + i] = vm->registers.all[reg].b[i];
+        #endif
+    }
+}
+
+
+static void mve_op_xlen(MVE_VM *vm)
+{
+    uint8_t reg = mve_request_uint8(vm);
+    uint8_t region_index = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "XLEN failed!", vm);
+
+    // Lets the program check if a region is linked before using it.
+    if (region_index < MVE_REGIONS_LIMIT && vm->regions[region_index].data != NULL)
+        vm->registers.all[reg].i = vm->regions[region_index].length;
+    else
+        vm->registers.all[reg].i = 0;
+}
+#endif
+
+
+#ifdef MVE_USE_CHANNELS
+/**
+ * @brief Reserves the next free slot of a channel to write a message.
+ * 
+ * @param channel Channel to write the message.
+ * @param position Receives the position of the slot, used to commit it.
+ * @return Returns the slot, or NULL if the channel is full.
+ */
+static MVE_Channel_Slot *mve_channel_reserve(MVE_Channel *channel, uint32_t *position)
+{
+    uint32_t head = MVE_ATOMIC_LOAD(&channel->head);
+
+    while (1)
+    {
+        MVE_Channel_Slot *slot = &channel->slots[head & channel->mask];
+        int32_t difference = (int32_t) (MVE_ATOMIC_LOAD(&slot->sequence) - head);
+
+        // The slot was not released by the consumer yet, so the ring is full.
+        if (difference < 0)
+            return NULL;
+
+        if (difference == 0)
+        {
+            *position = head;
+
+            if (!channel->multi_producer)
+            {
+                MVE_ATOMIC_STORE(&channel->head, head + 1);
+                return slot;
+            }
+
+            // On failure, the head is updated with the position taken by another producer.
+            if (MVE_ATOMIC_COMPARE_EXCHANGE(&channel->head, &head, head + 1))
+                return slot;
+        }
+        else
+        {
+            head = MVE_ATOMIC_LOAD(&channel->head);
+        }
+    }
+}
+
+
+/**
+ * @brief Publishes a slot reserved with mve_channel_reserve and wakes the receiver if it is parked.
+ * 
+ * @param channel Channel that owns the slot.
+ * @param slot Slot with the message written.
+ * @param position Position of the slot.
+ */
+static void mve_channel_commit(MVE_Channel *channel, MVE_Channel_Slot *slot, uint32_t position)
+{
+    MVE_ATOMIC_STORE(&slot->sequence, position + 1);
+
+    // Pairs with the fence of a receiver parking, so either it sees the message or we see it parked.
+    MVE_ATOMIC_FENCE();
+
+    if (MVE_ATOMIC_LOAD(&channel->parked_receiver) == NULL)
+        return;
+
+    MVE_VM *receiver = MVE_ATOMIC_EXCHANGE(&channel->parked_receiver, (MVE_VM *) NULL);
+
+    if (receiver != NULL && channel->fun_wake != NULL)
+        channel->fun_wake(receiver, channel);
+}
+
+
+/**
+ * @brief Returns the next message of a channel, without removing it.
+ * 
+ * @param channel Channel to read the message.
+ * @return Returns the slot with the message, or NULL if the channel is empty.
+ */
+static MVE_Channel_Slot *mve_channel_peek(MVE_Channel *channel)
+{
+    uint32_t tail = channel->tail;
+    MVE_Channel_Slot *slot = &channel->slots[tail & channel->mask];
+
+    if ((int32_t) (MVE_ATOMIC_LOAD(&slot->sequence) - (tail + 1)) < 0)
+        return NULL;
+
+    return slot;
+}
+
+
+/**
+ * @brief Removes the message returned by mve_channel_peek and wakes the sender if it is parked.
+ * 
+ * @param channel Channel to remove the message from.
+ * @param slot Slot of the message.
+ */
+static void mve_channel_release(MVE_Channel *channel, MVE_Channel_Slot *slot)
+{
+    uint32_t tail = channel->tail;
+
+    channel->tail = tail + 1;
+    MVE_ATOMIC_STORE(&slot->sequence, tail + channel->mask + 1);
+
+    MVE_ATOMIC_FENCE();
+
+    if (MVE_ATOMIC_LOAD(&channel->parked_sender) == NULL)
+        return;
+
+    MVE_VM *sender = MVE_ATOMIC_EXCHANGE(&channel->parked_sender, (MVE_VM *) NULL);
+
+    if (sender != NULL && channel->fun_wake != NULL)
+        channel->fun_wake(sender, channel);
+}
+
+
+/**
+ * @brief Returns the channel linked into the VM at the given index.
+ * 
+ * @param vm VM that owns the channel.
+ * @param index Index of the channel.
+ * @return Returns the channel.
+ */
+static inline MVE_Channel *mve_get_channel(MVE_VM *vm, uint8_t index)
+{
+    MVE_ASSERT(index < MVE_CHANNELS_LIMIT && vm->channels[index] != NULL, vm, MVE_ERROR_CHANNEL_OUT_OF_RANGE, "Channel failed! The channel was not linked into the VM.");
+
+    return vm->channels[index];
+}
+
+
+/**
+ * @brief Blocks the VM on a channel.
+ * The VM goes back to the start of the instruction, so it is executed again when the VM runs.
+ * 
+ * @param vm VM to be parked.
+ * @param channel Channel that blocked the VM.
+ * @param instruction_length Length of the instruction that blocked, including the OP.
+ */
+static void mve_park(MVE_VM *vm, MVE_Channel *channel, uint8_t instruction_length)
+{
+    vm->parked_channel = channel;
+
+    mve_seek_program_index(vm, mve_get_program_index(vm) - instruction_length);
+
+    if (channel->fun_park != NULL)
+        channel->fun_park(vm, channel);
+}
+
+
+/**
+ * @brief Reserves a slot to send a message from the VM. If the channel is full, the VM is parked.
+ * 
+ * @param vm VM sending the message.
+ * @param channel Channel to send the message.
+ * @param position Receives the position of the slot, used to commit it.
+ * @param instruction_length Length of the instruction sending, including the OP.
+ * @return Returns the slot, or NULL if the VM was parked.
+ */
+static MVE_Channel_Slot *mve_channel_acquire_send(MVE_VM *vm, MVE_Channel *channel, uint32_t *position, uint8_t instruction_length)
+{
+    MVE_Channel_Slot *slot = mve_channel_reserve(channel, position);
+
+    // Blocked senders are only tracked on single producer channels. Otherwise the scheduler must retry them.
+    if (slot == NULL && !channel->multi_producer)
+    {
+        // Register the VM to be woken, then look again, to not lose a slot released in between.
+        MVE_ATOMIC_STORE(&channel->parked_sender, vm);
+        MVE_ATOMIC_FENCE();
+
+        slot = mve_channel_reserve(channel, position);
+
+        if (slot != NULL)
+            MVE_ATOMIC_STORE(&channel->parked_sender, (MVE_VM *) NULL);
+    }
+
+    if (slot == NULL)
+    {
+        mve_park(vm, channel, instruction_length);
+        return NULL;
+    }
+
+    vm->parked_channel = NULL;
+
+    return slot;
+}
+
+
+/**
+ * @brief Returns the next message to be received by the VM. If the channel is empty, the VM is parked.
+ * 
+ * @param vm VM receiving the message.
+ * @param channel Channel to receive the message from.
+ * @param instruction_length Length of the instruction receiving, including the OP.
+ * @return Returns the slot with the message, or NULL if the VM was parked.
+ */
+static MVE_Channel_Slot *mve_channel_acquire_receive(MVE_VM *vm, MVE_Channel *channel, uint8_t instruction_length)
+{
+    MVE_Channel_Slot *slot = mve_channel_peek(channel);
+
+    if (slot == NULL)
+    {
+        // Register the VM to be woken, then look again, to not lose a message sent in between.
+        MVE_ATOMIC_STORE(&channel->parked_receiver, vm);
+        MVE_ATOMIC_FENCE();
+
+        slot = mve_channel_peek(channel);
+
+        if (slot == NULL)
+        {
+            mve_park(vm, channel, instruction_length);
+            return NULL;
+        }
+
+        MVE_ATOMIC_STORE(&channel->parked_receiver, (MVE_VM *) NULL);
+    }
+
+    vm->parked_channel = NULL;
+
+    return slot;
+}
+
+
+static void mve_op_send(MVE_VM *vm)
+{
+    uint8_t channel_index = mve_request_uint8(vm);
+
+    // The register containing the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "SEND failed!", vm);
+
+    MVE_Channel *channel = mve_get_channel(vm, channel_index);
+    uint32_t position;
+    MVE_Channel_Slot *slot = mve_channel_acquire_send(vm, channel, &position, 3);
+
+    if (slot == NULL)
+        return;
+
+    memcpy(slot->data, vm->registers.all[reg].b, MVE_BASE_TYPE_SIZE);
+    slot->length = MVE_BASE_TYPE_SIZE;
+
+    mve_channel_commit(channel, slot, position);
+}
+
+
+static void mve_op_recv(MVE_VM *vm)
+{
+    uint8_t channel_index = mve_request_uint8(vm);
+
+    // The register to receive the value.
+    uint8_t reg = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg, "RECV failed!", vm);
+
+    MVE_Channel *channel = mve_get_channel(vm, channel_index);
+    MVE_Channel_Slot *slot = mve_channel_acquire_receive(vm, channel, 3);
+
+    if (slot == NULL)
+        return;
+
+    MVE_Value value;
+    value.i = 0;
+
+    // Bigger messages are clamped to the size of the register, like POP.
+    memcpy(value.b, slot->data, slot->length < MVE_BASE_TYPE_SIZE ? slot->length : MVE_BASE_TYPE_SIZE);
+
+    mve_channel_release(channel, slot);
+
+    vm->registers.all[reg] = value;
+}
+
+
+static void mve_op_sends(MVE_VM *vm)
+{
+    uint8_t channel_index = mve_request_uint8(vm);
+
+    // The register that contains the stack address of the bytes.
+    uint8_t reg_index = mve_request_uint8(vm);
+
+    // The register that contains the amount of bytes to send.
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_index, "SENDS failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "SENDS failed!", vm);
+
+    uint32_t address = mve_get_stack_address(vm, vm->registers.all[reg_index].i);
+    uint32_t length = vm->registers.all[reg_length].i;
+
+    MVE_ASSERT(length <= MVE_CHANNEL_MESSAGE_SIZE, vm, MVE_ERROR_CHANNEL_MESSAGE_TOO_BIG, "SENDS failed! The message cannot be bigger than MVE_CHANNEL_MESSAGE_SIZE.");
+    MVE_ASSERT_STACK_ADDRESS(address + length, "SENDS failed!", vm);
+
+    MVE_Channel *channel = mve_get_channel(vm, channel_index);
+    uint32_t position;
+    MVE_Channel_Slot *slot = mve_channel_acquire_send(vm, channel, &position, 4);
+
+    if (slot == NULL)
+        return;
+
+    memcpy(slot->data, vm->stack + address, length);
+    slot->length = length;
+
+    mve_channel_commit(channel, slot, position);
+}
+
+
+static void mve_op_recvs(MVE_VM *vm)
+{
+    uint8_t channel_index = mve_request_uint8(vm);
+
+    // The register that contains the stack address to receive the bytes.
+    uint8_t reg_index = mve_request_uint8(vm);
+
+    // The register to receive the amount of bytes received.
+    uint8_t reg_length = mve_request_uint8(vm);
+
+    MVE_ASSERT_REGISTER(reg_index, "RECVS failed!", vm);
+    MVE_ASSERT_REGISTER(reg_length, "RECVS failed!", vm);
+
+    MVE_Channel *channel = mve_get_channel(vm, channel_index);
+    MVE_Channel_Slot *slot = mve_channel_acquire_receive(vm, channel, 4);
+
+    if (slot == NULL)
+        return;
+
+    uint32_t address = mve_get_stack_address(vm, vm->registers.all[reg_index].i);
+    uint32_t length = slot->length;
+
+    MVE_ASSERT_STACK_ADDRESS(address + length, "RECVS failed!", vm);
+
+    memcpy(vm->stack + address, slot->data, length);
+
+    mve_channel_release(channel, slot);
+
+    vm->registers.all[reg_length].i = length;
+}
+#endif
+
+
+MVE_API void mve_pool_init(MVE_Pool *pool, void *memory, uint32_t size, uint32_t block_size)
+{
+    uintptr_t address = (uintptr_t) memory;
+    uint32_t padding = (uint32_t) ((MVE_CACHE_LINE_SIZE - (address & (MVE_CACHE_LINE_SIZE - 1))) & (MVE_CACHE_LINE_SIZE - 1));
+
+    pool->blocks = (uint8_t *) memory + padding;
+    pool->block_size = (block_size + MVE_CACHE_LINE_SIZE - 1) & ~(uint32_t) (MVE_CACHE_LINE_SIZE - 1);
+    pool->count = size > padding && pool->block_size != 0 ? (size - padding) / pool->block_size : 0;
+    pool->free_list = NULL;
+
+    // Chain the blocks backwards, so the first block is the first to be given.
+    for (uint32_t i = pool->count; i > 0; i--) {
+        void **block = (void **) (pool->blocks + (i - 1) * pool->block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+}
+
+
+MVE_API void *mve_pool_alloc(MVE_Pool *pool)
+{
+    void **block = (void **) pool->free_list;
+
+    if (block == NULL)
+        return NULL;
+
+    pool->free_list = *block;
+
+    return block;
+}
+
+
+MVE_API void mve_pool_free(MVE_Pool *pool, void *block)
+{
+    *(void **) block = pool->free_list;
+    pool->free_list = block;
+}
+
+
+#ifdef MVE_RUNTIME_SIZES
+MVE_API void mve_arena_init(MVE_Arena *arena, void *memory, uint32_t size)
+{
+    arena->memory = (uint8_t *) memory;
+    arena->size = size;
+    arena->used = 0;
+}
+
+
+MVE_API void *mve_arena_alloc(MVE_Arena *arena, uint32_t size)
+{
+    return mve_arena_take(arena, size, sizeof(void *));
+}
+
+
+MVE_API void mve_arena_reset(MVE_Arena *arena)
+{
+    arena->used = 0;
+}
+
+
+MVE_API void mve_configure(MVE_VM *vm, const MVE_Config *config, MVE_Arena *arena)
+{
+    vm->arena = arena;
+    vm->stack_size = MVE_STACK_SIZE;
+    vm->memory_size = MVE_MEMORY_SIZE;
+    vm->scope_limit = MVE_SCOPE_LIMIT;
+    vm->buffer_size = MVE_BUFFER_SIZE;
+
+    if (config == NULL)
+        return;
+
+    if (config->stack_size != 0)
+        vm->stack_size = config->stack_size;
+
+    if (config->memory_size != 0)
+        vm->memory_size = config->memory_size;
+
+    if (config->scope_limit != 0)
+        vm->scope_limit = config->scope_limit;
+
+    if (config->buffer_size != 0)
+        vm->buffer_size = config->buffer_size;
+}
+#endif
+
+
+/**
+ * @brief Sets where the program comes from. In streaming mode with runtime sizes, the program buffer is also carved from the arena.
+ * 
+ * @return Returns false if the arena does not have enough space left.
+ */
+#ifdef MVE_LOCAL_PROGRAM
+static MVEbool mve_set_program(MVE_VM *vm, uint8_t *program) 
+{
+    vm->program_buffer = program;
+#else
+static MVEbool mve_set_program(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t)) 
 {
-    vm->program_buffer = program;
-#else
-MVEbool mve_init(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t)) {
     vm->fun_load_next_block = fun_load_next_block;
+
+    #ifdef MVE_RUNTIME_SIZES
+        vm->program_buffer = (uint8_t *) mve_arena_take(vm->arena, vm->buffer_size, MVE_CACHE_LINE_SIZE);
+
+        MVEbool allocated = vm->program_buffer != NULL && vm->buffer_size >= 32;
+
+        if (!allocated)
+        {
+            MVE_ASSERT(allocated, vm, MVE_ERROR_ARENA_EXHAUSTED, "Arena exhausted. There is not enough space for a program buffer of at least 32 bytes.");
+            return MVE_FALSE;
+        }
+    #endif
+#endif
+
+    return MVE_TRUE;
+}
+
+
+/**
+ * @brief Resets the state of the VM and everything linked into it, before loading a program.
+ */
+static void mve_reset(MVE_VM *vm) 
+{
+    vm->program_index = 0;
+    vm->is_running = MVE_FALSE;
+    vm->buffer_index = 0;
+    STACK_POINTER(vm) = 0;
+    MEMORY_POINTER(vm) = 0;
+    vm->scope_index = 0;
+    vm->frame_index = 0;
+
+#ifdef MVE_GROWABLE_SCOPES
+    #ifndef MVE_RUNTIME_SIZES
+        vm->scope_limit = MVE_SCOPE_LIMIT;
+    #endif
+
+    vm->frame_limit = MVE_FRAME_LIMIT;
+#endif
+
+    for (uint16_t i = 0; i < MVE_EXTERNAL_FUNCTIONS_LIMIT; i++) {
+        vm->external_functions[i] = NULL;
+    }
+
+#ifdef MVE_PROFILE
+    vm->profile = NULL;
+#endif
+
+#ifdef MVE_SAMPLING
+    vm->sampler = NULL;
+#endif
+
+#ifdef MVE_LOADER_STATS
+    mve_loader_stats_reset(vm);
+#endif
+
+#ifdef MVE_TRACE
+    mve_trace_attach(vm, NULL);
+#endif
+
+#ifdef MVE_TRACK_USAGE
+    mve_usage_reset(vm);
+#endif
+
+#ifdef MVE_USE_CHANNELS
+    for (uint8_t i = 0; i < MVE_CHANNELS_LIMIT; i++) {
+        vm->channels[i] = NULL;
+    }
+
+    vm->parked_channel = NULL;
+#endif
+
+#ifdef MVE_USE_REGIONS
+    for (uint8_t i = 0; i < MVE_REGIONS_LIMIT; i++) {
+        mve_link_region(vm, i, NULL, 0, MVE_FALSE);
+    }
+#endif
+
+#ifdef MVE_USE_EXPORTS
+    vm->exports_count = 0;
+    vm->export_pending = MVE_FALSE;
+#endif
+
+#ifdef MVE_USE_IMAGES
+    vm->image_sizes[0] = 0;
+    vm->image_sizes[1] = 0;
+    vm->image_sizes[2] = 0;
+#endif
+}
+
+
+#ifdef MVE_LOCAL_PROGRAM
+MVE_API MVEbool mve_init(MVE_VM *vm, uint8_t *program) 
+{
+    if (!mve_set_program(vm, program))
+        return MVE_FALSE;
+#else
+MVE_API MVEbool mve_init(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t)) 
+{
+    if (!mve_set_program(vm, fun_load_next_block))
+        return MVE_FALSE;
+#endif
+
+    mve_reset(vm);
+
+    mve_load_next_block(vm);
+
+    return mve_load_header(vm);
+}
+
+
+/**
+ * @brief Finds the index of an external function by its name, from the names loaded into the memory by the header.
+ * 
+ * @param vm VM with the names of the functions.
+ * @param name Name of the function.
+ * @return Returns the index of the function, or external_functions_count if the program does not declare it.
+ */
+static uint16_t mve_find_function(MVE_VM *vm, const char *name) 
+{
+    uint32_t memory_index = 0;
+    uint16_t function_index = 0;
+
+    for (uint16_t i = 0; i < vm->external_functions_count; i++) {
+
+        uint32_t start = memory_index;
+
+        while (vm->memory[memory_index] != '\0') {
+            memory_index++;
+        } 
+
+        memory_index++;
+
+        if (string_equals((const char *) vm->memory + start, name))
+            return function_index;
+
+        function_index++;
+    }
+
+    return vm->external_functions_count;
+}
+
+
+MVE_API void mve_link_function(MVE_VM *vm, const char *name, void (*function) (MVE_VM *)) 
+{
+    uint16_t function_index = mve_find_function(vm, name);
+
+    if (function_index < vm->external_functions_count)
+        vm->external_functions[function_index] = (void *) function;
+}
+
+
+#ifdef MVE_GROWABLE_SCOPES
+MVE_API MVEbool mve_reserve_scopes(MVE_VM *vm, uint32_t scope_limit, uint32_t frame_limit)
+{
+    if (scope_limit > MVE_SCOPE_MAX || frame_limit > MVE_FRAME_MAX)
+        return MVE_FALSE;
+
+    if (scope_limit > vm->scope_limit)
+    {
+        // Doubling keeps the growth amortized O(1) per scope.
+        uint32_t limit = vm->scope_limit * 2 < MVE_SCOPE_MAX ? vm->scope_limit * 2 : MVE_SCOPE_MAX;
+
+        if (limit < scope_limit)
+            limit = scope_limit;
+
+        MVE_Scope_Info *scopes = (MVE_Scope_Info *) MVE_REALLOC(vm->scopes, limit * sizeof(MVE_Scope_Info));
+
+        if (scopes == NULL)
+            return MVE_FALSE;
+
+        // The new scopes must not go back anywhere, as mve_start leaves them.
+        memset(scopes + vm->scope_limit, 0, (limit - vm->scope_limit) * sizeof(MVE_Scope_Info));
+
+        vm->scopes = scopes;
+        vm->scope_limit = limit;
+    }
+
+    if (frame_limit > vm->frame_limit)
+    {
+        uint32_t limit = vm->frame_limit * 2 < MVE_FRAME_MAX ? vm->frame_limit * 2 : MVE_FRAME_MAX;
+
+        if (limit < frame_limit)
+            limit = frame_limit;
+
+        MVE_Frame *frames = (MVE_Frame *) MVE_REALLOC(vm->frames, limit * sizeof(MVE_Frame));
+
+        if (frames == NULL)
+            return MVE_FALSE;
+
+        vm->frames = frames;
+        vm->frame_limit = limit;
+    }
+
+    return MVE_TRUE;
+}
+
+
+MVE_API void mve_release(MVE_VM *vm)
+{
+    MVE_FREE(vm->scopes);
+    MVE_FREE(vm->frames);
+
+    vm->scopes = NULL;
+    vm->frames = NULL;
+    vm->scope_limit = 0;
+    vm->frame_limit = 0;
+}
+#endif
+
+
+MVE_API void mve_start(MVE_VM *vm) 
+{
+    vm->is_running = MVE_TRUE;
+
+    // Reset the scopes because they are not set at runtime, unless on CALL instructions.
+    // Without this, JMP instructions will misbehave.
+    for (uint32_t i = 0; i < MVE_VM_SCOPE_LIMIT(vm); i++) {
+        vm->scopes[i].program_index = 0;
+        vm->scopes[i].stack_base = 0;
+    }
+
+    vm->frame_index = 0;
+}
+
+
+/**
+ * @brief Executes an instruction, which OP was already read.
+ * 
+ * @param vm VM to execute the instruction.
+ * @param next_operation The OP of the instruction.
+ */
+static inline void mve_execute(MVE_VM *vm, uint8_t next_operation) 
+{
+    switch (next_operation)
+    {
+    case MVE_OP_LDR:
+        mve_op_ldr(vm);
+        break;
+    case MVE_OP_STR:
+        mve_op_str(vm);
+        break;
+    case MVE_OP_LDS:
+        mve_op_lds(vm);
+        break;
+    case MVE_OP_STS:
+        mve_op_sts(vm);
+        break;
+    case MVE_OP_LDI:
+        mve_op_ldi(vm);
+        break;
+    case MVE_OP_MOV:
+        mve_op_mov(vm);
+        break;
+    case MVE_OP_NEG:
+        mve_op_neg(vm);
+        break;
+    case MVE_OP_INVOKE:
+        mve_op_invoke(vm);
+        break;
+    case MVE_OP_ADD:
+        mve_op_add(vm);
+        break;
+    case MVE_OP_SUB:
+        mve_op_sub(vm);
+        break;
+    case MVE_OP_MUL:
+        mve_op_mul(vm);
+        break;
+    case MVE_OP_DIV:
+        mve_op_div(vm);
+        break;
+    case MVE_OP_SCOPE:
+        mve_op_scope(vm);
+        break;
+    case MVE_OP_END:
+        mve_op_end(vm);
+        break;
+    case MVE_OP_CMP:
+        mve_op_cmp(vm);
+        break;
+    case MVE_OP_JMP:
+        mve_op_jmp(vm);
+        break;
+    case MVE_OP_JNZ:
+        mve_op_jnz(vm);
+        break;
+    case MVE_OP_CALL:
+        mve_op_call(vm);
+        break;
+    case MVE_OP_AND:
+        mve_op_and(vm);
+        break;
+    case MVE_OP_ORR:
+        mve_op_orr(vm);
+        break;
+    case MVE_OP_NOT:
+        mve_op_not(vm);
+        break;
+    case MVE_OP_LSL:
+        mve_op_lsl(vm);
+        break;
+    case MVE_OP_LSR:
+        mve_op_lsr(vm);
+        break;
+    case MVE_OP_XOR:
+        mve_op_xor(vm);
+        break;
+    case MVE_OP_INC:
+        mve_op_inc(vm);
+        break;
+    case MVE_OP_DEC:
+        mve_op_dec(vm);
+        break;
+    case MVE_OP_PUSH:
+        mve_op_push(vm);
+        break;
+    case MVE_OP_POP:
+        mve_op_pop(vm);
+        break;
+    case MVE_OP_LADR:
+        mve_op_ladr(vm);
+        break;
+    case MVE_OP_PUSHM:
+        mve_op_pushm(vm);
+        break;
+    case MVE_OP_POPM:
+        mve_op_popm(vm);
+        break;
+    case MVE_OP_FCALL:
+        mve_op_fcall(vm);
+        break;
+    case MVE_OP_RET:
+        mve_op_ret(vm);
+        break;
+    case MVE_OP_TCALL:
+        mve_op_tcall(vm);
+        break;
+    case MVE_OP_SWITCH:
+        mve_op_switch(vm);
+        break;
+    case MVE_OP_LOOP:
+        mve_op_loop(vm);
+        break;
+#ifdef MVE_USE_BYTE_OPS
+    case MVE_OP_STRLEN:
+        mve_op_strlen(vm);
+        break;
+    case MVE_OP_FINDBYTE:
+        mve_op_findbyte(vm);
+        break;
+    case MVE_OP_MEMCMP:
+        mve_op_memcmp(vm);
+        break;
+    case MVE_OP_CRC32C:
+        mve_op_crc32c(vm);
+        break;
+#endif
+#ifdef MVE_USE_REGIONS
+    case MVE_OP_LDX:
+        mve_op_ldx(vm);
+        break;
+    case MVE_OP_STX:
+        mve_op_stx(vm);
+        break;
+    case MVE_OP_XLEN:
+        mve_op_xlen(vm);
+        break;
+#endif
+#ifdef MVE_USE_CHANNELS
+    case MVE_OP_SEND:
+        mve_op_send(vm);
+        break;
+    case MVE_OP_RECV:
+        mve_op_recv(vm);
+        break;
+    case MVE_OP_SENDS:
+        mve_op_sends(vm);
+        break;
+    case MVE_OP_RECVS:
+        mve_op_recvs(vm);
+        break;
+#endif
+    case MVE_OP_EOP:
+        mve_stop(vm);
+        break;
+    default:
+        MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_UNDEFINED_OP, "Undefined instruction! Code does not exist.");
+        mve_stop(vm);
+        break;
+    }
+}
+
+
+MVE_API void mve_run(MVE_VM *vm) 
+{
+#ifdef MVE_SAMPLING
+    if (vm->sampler != NULL && (vm->sampler->requested || (vm->sampler->interval != 0 && --vm->sampler->countdown == 0)))
+        mve_sample(vm);
+#endif
+
+#ifdef MVE_TRACE
+    MVE_Trace_Entry *entry = &vm->trace->entries[vm->trace->count & vm->trace->mask];
+
+    vm->trace->count++;
+    vm->trace_entry = entry;
+    entry->program_index = mve_get_program_index(vm);
+#endif
+
+    uint8_t next_operation = mve_request_uint8(vm);
+
+#ifdef MVE_TRACE
+    // The OP was also recorded as an operand.
+    entry->operation = next_operation;
+    entry->operands_length = 0;
+#endif
+
+#ifdef MVE_PROFILE
+    if (vm->profile != NULL)
+    {
+        uint64_t start = MVE_CLOCK();
+        mve_execute(vm, next_operation);
+        mve_profile_record(&vm->profile->operations[next_operation], MVE_CLOCK() - start);
+    }
+    else
+#endif
+    {
+        mve_execute(vm, next_operation);
+    }
+
+#ifdef MVE_TRACE
+    entry->registers = vm->registers;
+#endif
+
+#ifdef MVE_TRACK_USAGE
+    MVE_Usage *usage = &vm->usage;
+
+    usage->peak_stack = STACK_POINTER(vm) > usage->peak_stack ? STACK_POINTER(vm) : usage->peak_stack;
+    usage->peak_memory = MEMORY_POINTER(vm) > usage->peak_memory ? MEMORY_POINTER(vm) : usage->peak_memory;
+    usage->peak_scope = vm->scope_index > usage->peak_scope ? vm->scope_index : usage->peak_scope;
+    usage->peak_frame = vm->frame_index > usage->peak_frame ? vm->frame_index : usage->peak_frame;
+#endif
+}
+
+
+MVE_API MVEbool mve_is_running(MVE_VM *vm) 
+{
+    return vm->is_running;
+}
+
+
+MVE_API void mve_stop(MVE_VM *vm) 
+{
+    vm->is_running = MVE_FALSE;
+}
+
+
+#ifdef MVE_USE_CHANNELS
+MVE_API MVEbool mve_channel_init(MVE_Channel *channel, MVE_Channel_Slot *slots, uint32_t capacity, MVEbool multi_producer)
+{
+    // With a single slot, a full slot looks ready for the next position, so at least 2 are needed.
+    if (capacity < 2)
+        return MVE_FALSE;
+
+    uint32_t size = 2;
+
+    while (size * 2 <= capacity && size * 2 != 0)
+        size *= 2;
+
+    channel->slots = slots;
+    channel->mask = size - 1;
+    channel->multi_producer = multi_producer;
+    channel->fun_park = NULL;
+    channel->fun_wake = NULL;
+    channel->context = NULL;
+    channel->head = 0;
+    channel->tail = 0;
+    channel->parked_sender = NULL;
+    channel->parked_receiver = NULL;
+
+    // Each slot starts ready for the first position it will hold.
+    for (uint32_t i = 0; i < size; i++) {
+        slots[i].sequence = i;
+        slots[i].length = 0;
+    }
+
+    return MVE_TRUE;
+}
+
+
+MVE_API MVEbool mve_channel_send(MVE_Channel *channel, const uint8_t *data, uint32_t length)
+{
+    if (length > MVE_CHANNEL_MESSAGE_SIZE)
+        return MVE_FALSE;
+
+    uint32_t position;
+    MVE_Channel_Slot *slot = mve_channel_reserve(channel, &position);
+
+    if (slot == NULL)
+        return MVE_FALSE;
+
+    memcpy(slot->data, data, length);
+    slot->length = length;
+
+    mve_channel_commit(channel, slot, position);
+
+    return MVE_TRUE;
+}
+
+
+MVE_API MVEbool mve_channel_receive(MVE_Channel *channel, uint8_t *data, uint32_t *length)
+{
+    MVE_Channel_Slot *slot = mve_channel_peek(channel);
+
+    if (slot == NULL)
+        return MVE_FALSE;
+
+    *length = slot->length;
+    memcpy(data, slot->data, slot->length);
+
+    mve_channel_release(channel, slot);
+
+    return MVE_TRUE;
+}
+
+
+MVE_API void mve_link_channel(MVE_VM *vm, uint8_t index, MVE_Channel *channel)
+{
+    if (index < MVE_CHANNELS_LIMIT)
+        vm->channels[index] = channel;
+}
+
+
+MVE_API MVEbool mve_is_parked(MVE_VM *vm)
+{
+    return vm->parked_channel != NULL;
+}
+#endif
+
+
+#ifdef MVE_USE_REGIONS
+MVE_API void mve_link_region(MVE_VM *vm, uint8_t index, void *data, uint32_t length, MVEbool writable)
+{
+    if (index >= MVE_REGIONS_LIMIT)
+        return;
+
+    vm->regions[index].data = (uint8_t *) data;
+    vm->regions[index].length = data != NULL ? length : 0;
+    vm->regions[index].writable = writable;
+}
+#endif
+
+
+#ifdef MVE_USE_EXPORTS
+MVE_API uint16_t mve_find_export(MVE_VM *vm, const char *name)
+{
+    uint32_t hash = MVE_HASH_START;
+
+    for (const char *c = name; *c != '\0'; c++)
+        hash = mve_hash_byte(hash, (uint8_t) *c);
+
+    for (uint16_t i = 0; i < vm->exports_count; i++) {
+        if (vm->exports[i].name_hash == hash)
+            return i;
+    }
+
+    return vm->exports_count;
+}
+
+
+/**
+ * @brief Ends the export being run, going back to where the VM was when it was called, with its registers.
+ * 
+ * @param vm VM running the export.
+ * @param result Receives r0. Can be NULL.
+ * @return Returns true if the export returned with RET.
+ */
+static MVEbool mve_end_export(MVE_VM *vm, MVE_Value *result)
+{
+    MVEbool returned = vm->frame_index == vm->export_frame;
+
+    if (result != NULL)
+        *result = vm->registers.r0;
+
+    // The export stopped without returning, so its frame is ended like a RET.
+    if (!returned)
+    {
+        MVE_Frame *frame = &vm->frames[vm->export_frame];
+
+        vm->frame_index = vm->export_frame;
+        mve_unwind_frame(vm, frame);
+        mve_jump_to_program_index(vm, frame->return_index);
+    }
+
+    if (vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm))
+        vm->scopes[vm->scope_index + 1].program_index = vm->export_scope_return;
+
+    vm->registers = vm->export_registers;
+    vm->is_running = vm->export_running;
+    vm->export_pending = MVE_FALSE;
+
+    #ifdef MVE_USE_CHANNELS
+        vm->parked_channel = vm->export_parked_channel;
+    #endif
+
+    return returned;
+}
+
+
+MVE_API MVEbool mve_resume_export(MVE_VM *vm, uint32_t budget, MVE_Value *result)
+{
+    if (!vm->export_pending)
+        return MVE_FALSE;
+
+    uint32_t executed = 0;
+
+    while (vm->frame_index > vm->export_frame && vm->is_running)
+    {
+        if (budget != 0 && executed == budget)
+            return MVE_FALSE;
+
+        executed++;
+        mve_run(vm);
+
+        #ifdef MVE_USE_CHANNELS
+            // Blocked, so it is resumed once the channel is ready, like the VM.
+            if (vm->parked_channel != NULL)
+                return MVE_FALSE;
+        #endif
+    }
+
+    return mve_end_export(vm, result);
+}
+
+
+MVE_API MVEbool mve_call_export(MVE_VM *vm, uint16_t index, const MVE_Value *args, uint8_t args_count, uint32_t budget, MVE_Value *result)
+{
+    if (vm->export_pending)
+    {
+        MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_EXPORT_PENDING, "Export failed! The previous export did not end yet.");
+        return MVE_FALSE;
+    }
+
+    if (index >= vm->exports_count || args_count > 5)
+    {
+        MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_EXPORT_OUT_OF_RANGE, "Export failed! Invalid export index or too many arguments.");
+        return MVE_FALSE;
+    }
+
+    MVE_GROW_FRAMES(vm);
+
+    if (vm->frame_index >= MVE_VM_FRAME_LIMIT(vm))
+    {
+        MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_FRAME_LIMIT_REACHED, "Export failed! Cannot have more frames than MVE_FRAME_LIMIT.");
+        return MVE_FALSE;
+    }
+
+    vm->export_registers = vm->registers;
+    vm->export_running = vm->is_running;
+    vm->export_frame = vm->frame_index;
+    vm->export_scope_return = 0;
+
+    // A CALL waiting for its SCOPE already set where the next scope goes back to, which must not be used by the export.
+    if (vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm))
+    {
+        vm->export_scope_return = vm->scopes[vm->scope_index + 1].program_index;
+        vm->scopes[vm->scope_index + 1].program_index = 0;
+    }
+
+    #ifdef MVE_USE_CHANNELS
+        vm->export_parked_channel = vm->parked_channel;
+        vm->parked_channel = NULL;
+    #endif
+
+    MVE_Frame *frame = &vm->frames[vm->frame_index++];
+
+    frame->return_index = mve_get_program_index(vm);
+    frame->scope_index = vm->scope_index;
+
+    for (uint8_t i = 0; i < args_count; i++)
+        vm->registers.all[i] = args[i];
+
+    vm->is_running = MVE_TRUE;
+    vm->export_pending = MVE_TRUE;
+
+    mve_jump_to_program_index(vm, vm->exports[index].program_index);
+
+    return mve_resume_export(vm, budget, result);
+}
+
+
+MVE_API MVEbool mve_is_export_pending(MVE_VM *vm)
+{
+    return vm->export_pending;
+}
+#endif
+
+
+#ifdef MVE_USE_IMAGES
+MVE_API uint64_t mve_image_hash(const uint8_t *bytes, uint32_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for (uint32_t i = 0; i < length; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+
+MVE_API uint64_t mve_image_config(void)
+{
+    uint32_t flags = 0;
+
+    #ifdef MVE_LOCAL_PROGRAM
+        flags |= 1u << 0;
+    #endif
+
+    #ifdef MVE_RUNTIME_SIZES
+        flags |= 1u << 1;
+    #endif
+
+    #ifdef MVE_GROWABLE_SCOPES
+        flags |= 1u << 2;
+    #endif
+
+    #ifdef MVE_BIG_ENDIAN
+        flags |= 1u << 3;
+    #endif
+
+    #ifdef MVE_USE_EXPORTS
+        flags |= 1u << 4;
+    #endif
+
+    #ifdef MVE_TRACK_USAGE
+        flags |= 1u << 5;
+    #endif
+
+    // The size of the VM changes with most of the other macros and limits.
+    uint32_t values[] = { MVE_IMAGE_VERSION, MVE_VERSION_MAJOR, MVE_VERSION_MINOR, MVE_BASE_TYPE_SIZE, 
+                          (uint32_t) sizeof(MVE_VM), (uint32_t) sizeof(MVE_Image), (uint32_t) sizeof(MVE_Value),
+                          MVE_EXTERNAL_FUNCTIONS_LIMIT, MVE_REGISTERS_SIZE, MVE_STACK_SIZE, MVE_MEMORY_SIZE, MVE_SCOPE_LIMIT, flags };
+
+    return mve_image_hash((const uint8_t *) values, sizeof(values));
+}
+
+
+/**
+ * @brief Returns the amount of bytes of the function names, loaded into the memory by the header.
+ */
+static uint32_t mve_image_memory_length(MVE_VM *vm)
+{
+    uint32_t length = 0;
+
+    for (uint16_t i = 0; i < vm->external_functions_count; length++) {
+        if (vm->memory[length] == '\0')
+            i++;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Returns the amount of exports of the loaded program. Always 0 without MVE_USE_EXPORTS.
+ */
+static uint16_t mve_image_exports_count(MVE_VM *vm)
+{
+    #ifdef MVE_USE_EXPORTS
+        return vm->exports_count;
+    #else
+        (void) vm;
+        return 0;
+    #endif
+}
+
+
+MVE_API uint32_t mve_image_size(MVE_VM *vm)
+{
+    return (uint32_t) (sizeof(MVE_Image) + STACK_POINTER(vm) + mve_image_memory_length(vm) + mve_image_exports_count(vm) * sizeof(MVE_Export));
+}
+
+
+MVE_API uint32_t mve_image_write(MVE_VM *vm, uint64_t program_hash, void *image, uint32_t capacity)
+{
+    uint32_t size = mve_image_size(vm);
+
+    if (capacity < size)
+        return 0;
+
+    MVE_Image header;
+
+    header.magic = MVE_IMAGE_MAGIC;
+    header.code_index = mve_get_program_index(vm);
+    header.config = mve_image_config();
+    header.program_hash = program_hash;
+    header.sizes[0] = vm->image_sizes[0];
+    header.sizes[1] = vm->image_sizes[1];
+    header.sizes[2] = vm->image_sizes[2];
+    header.stack_length = (uint32_t) STACK_POINTER(vm);
+    header.memory_length = mve_image_memory_length(vm);
+    header.external_functions_count = vm->external_functions_count;
+    header.exports_count = mve_image_exports_count(vm);
+
+    // The image may not be aligned, so everything is copied byte by byte.
+    uint8_t *bytes = (uint8_t *) image;
+
+    memcpy(bytes, &header, sizeof(MVE_Image));
+    bytes += sizeof(MVE_Image);
+
+    memcpy(bytes, vm->stack, header.stack_length);
+    bytes += header.stack_length;
+
+    memcpy(bytes, vm->memory, header.memory_length);
+
+    #ifdef MVE_USE_EXPORTS
+        bytes += header.memory_length;
+        memcpy(bytes, vm->exports, header.exports_count * sizeof(MVE_Export));
+    #endif
+
+    return size;
+}
+
+
+#ifdef MVE_LOCAL_PROGRAM
+MVE_API MVEbool mve_image_load(MVE_VM *vm, uint8_t *program, uint64_t program_hash, const void *image, uint32_t size)
+#else
+MVE_API MVEbool mve_image_load(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t), uint64_t program_hash, const void *image, uint32_t size)
+#endif
+{
+    const uint8_t *bytes = (const uint8_t *) image;
+    MVE_Image header;
+
+    if (image == NULL || size < sizeof(MVE_Image))
+        return MVE_FALSE;
+
+    memcpy(&header, bytes, sizeof(MVE_Image));
+
+    #ifdef MVE_RUNTIME_SIZES
+        uint32_t stack_size = header.sizes[0] != 0 ? header.sizes[0] : vm->stack_size;
+        uint32_t memory_size = header.sizes[1] != 0 ? header.sizes[1] : vm->memory_size;
+    #else
+        uint32_t stack_size = MVE_STACK_SIZE;
+        uint32_t memory_size = MVE_MEMORY_SIZE;
+    #endif
+
+    #ifdef MVE_USE_EXPORTS
+        uint16_t exports_limit = MVE_EXPORTS_LIMIT;
+    #else
+        uint16_t exports_limit = 0;
+    #endif
+
+    uint64_t expected_size = (uint64_t) sizeof(MVE_Image) + header.stack_length + header.memory_length + (uint64_t) header.exports_count * sizeof(MVE_Export);
+
+    // A stale or foreign image is expected, such as after updating the program, so it is rejected without an error.
+    if (header.magic != MVE_IMAGE_MAGIC || header.config != mve_image_config() || header.program_hash != program_hash || expected_size != size)
+        return MVE_FALSE;
+
+    if (header.stack_length > stack_size || header.memory_length > memory_size 
+        || header.external_functions_count > MVE_EXTERNAL_FUNCTIONS_LIMIT || header.exports_count > exports_limit)
+        return MVE_FALSE;
+
+    #ifdef MVE_LOCAL_PROGRAM
+        if (!mve_set_program(vm, program))
+            return MVE_FALSE;
+    #else
+        if (!mve_set_program(vm, fun_load_next_block))
+            return MVE_FALSE;
+    #endif
+
+    mve_reset(vm);
+
+    if (!mve_apply_sizes(vm, header.sizes[0], header.sizes[1], header.sizes[2]))
+        return MVE_FALSE;
+
+    #ifdef MVE_RUNTIME_SIZES
+        if (!mve_allocate_storage(vm))
+            return MVE_FALSE;
+    #endif
+
+    #ifdef MVE_GROWABLE_SCOPES
+        if (!mve_allocate_scopes(vm))
+            return MVE_FALSE;
+    #endif
+
+    bytes += sizeof(MVE_Image);
+
+    memcpy(vm->stack, bytes, header.stack_length);
+    STACK_POINTER(vm) = header.stack_length;
+    bytes += header.stack_length;
+
+    memcpy(vm->memory, bytes, header.memory_length);
+    vm->external_functions_count = header.external_functions_count;
+
+    #ifdef MVE_USE_EXPORTS
+        bytes += header.memory_length;
+        memcpy(vm->exports, bytes, header.exports_count * sizeof(MVE_Export));
+        vm->exports_count = header.exports_count;
+    #endif
+
+    #ifdef MVE_TRACK_USAGE
+        vm->usage.peak_memory = header.memory_length;
+    #endif
+
+    #ifdef MVE_LOCAL_PROGRAM
+        vm->buffer_index = header.code_index;
+    #else
+        // Fills the whole buffer from the first instruction, as mve_init does from the start of the program.
+        vm->program_index = header.code_index;
+        mve_load_next_block(vm);
+    #endif
+
+    return MVE_TRUE;
+}
 #endif
-    vm->program_index = 0;
-    vm->is_running = MVE_FALSE;
-    vm->buffer_index = 0;
-    STACK_POINTER(vm) = 0;
-    MEMORY_POINTER(vm) = 0;
-    vm->scope_index = 0;
 
-    for (uint16_t i = 0; i < MVE_EXTERNAL_FUNCTIONS_LIMIT; i++) {
-        vm->external_functions[i] = NULL;
+
+#if defined(MVE_PROFILE) || defined(MVE_TRACE)
+MVE_API const char *mve_op_name(uint8_t operation)
+{
+    switch (operation)
+    {
+        case MVE_OP_EOP: return "EOP";
+        case MVE_OP_LDR: return "LDR";
+        case MVE_OP_STR: return "STR";
+        case MVE_OP_LDS: return "LDS";
+        case MVE_OP_STS: return "STS";
+        case MVE_OP_LDI: return "LDI";
+        case MVE_OP_MOV: return "MOV";
+        case MVE_OP_NEG: return "NEG";
+        case MVE_OP_INVOKE: return "INVOKE";
+        case MVE_OP_ADD: return "ADD";
+        case MVE_OP_SUB: return "SUB";
+        case MVE_OP_MUL: return "MUL";
+        case MVE_OP_DIV: return "DIV";
+        case MVE_OP_SCOPE: return "SCOPE";
+        case MVE_OP_END: return "END";
+        case MVE_OP_CMP: return "CMP";
+        case MVE_OP_JMP: return "JMP";
+        case MVE_OP_JNZ: return "JNZ";
+        case MVE_OP_CALL: return "CALL";
+        case MVE_OP_AND: return "AND";
+        case MVE_OP_ORR: return "ORR";
+        case MVE_OP_NOT: return "NOT";
+        case MVE_OP_LSL: return "LSL";
+        case MVE_OP_LSR: return "LSR";
+        case MVE_OP_XOR: return "XOR";
+        case MVE_OP_INC: return "INC";
+        case MVE_OP_DEC: return "DEC";
+        case MVE_OP_ITOF: return "ITOF";
+        case MVE_OP_FTOI: return "FTOI";
+        case MVE_OP_FADD: return "FADD";
+        case MVE_OP_FSUB: return "FSUB";
+        case MVE_OP_FMUL: return "FMUL";
+        case MVE_OP_FDIV: return "FDIV";
+        case MVE_OP_FCMP: return "FCMP";
+        case MVE_OP_FNEG: return "FNEG";
+        case MVE_OP_PUSH: return "PUSH";
+        case MVE_OP_POP: return "POP";
+        case MVE_OP_LADR: return "LADR";
+        case MVE_OP_SEND: return "SEND";
+        case MVE_OP_RECV: return "RECV";
+        case MVE_OP_SENDS: return "SENDS";
+        case MVE_OP_RECVS: return "RECVS";
+        case MVE_OP_PUSHM: return "PUSHM";
+        case MVE_OP_POPM: return "POPM";
+        case MVE_OP_FCALL: return "FCALL";
+        case MVE_OP_RET: return "RET";
+        case MVE_OP_TCALL: return "TCALL";
+        case MVE_OP_SWITCH: return "SWITCH";
+        case MVE_OP_LOOP: return "LOOP";
+        case MVE_OP_STRLEN: return "STRLEN";
+        case MVE_OP_FINDBYTE: return "FINDBYTE";
+        case MVE_OP_MEMCMP: return "MEMCMP";
+        case MVE_OP_CRC32C: return "CRC32C";
+        case MVE_OP_LDX: return "LDX";
+        case MVE_OP_STX: return "STX";
+        case MVE_OP_XLEN: return "XLEN";
+        default: return NULL;
     }
+}
+#endif
 
-    mve_load_next_block(vm);
 
-    MVEbool result = mve_load_header(vm);
+#ifdef MVE_PROFILE
+MVE_API void mve_profile_attach(MVE_VM *vm, MVE_Profile *profile)
+{
+    vm->profile = profile;
+    mve_profile_reset(vm);
+}
 
-    if (!result)
-        MVE_ASSERT(result, vm, MVE_ERROR_INCOMPATIBLE_VERSION, "Incompatible program. Please upgrade your MicroVE into a newer version or compile your program to an old one.");
 
-    return result;
+MVE_API const MVE_Profile *mve_profile_get(MVE_VM *vm)
+{
+    return vm->profile;
 }
 
 
-void mve_link_function(MVE_VM *vm, const char *name, void (*function) (MVE_VM *)) 
+MVE_API void mve_profile_reset(MVE_VM *vm)
 {
-    uint32_t memory_index = 0;
-    uint16_t function_index = 0;
+    if (vm->profile != NULL)
+        memset(vm->profile, 0, sizeof(MVE_Profile));
+}
 
-    for (uint16_t i = 0; i < vm->external_functions_count; i++) {
 
-        uint32_t start = memory_index;
+MVE_API void mve_profile_write_json(MVE_VM *vm, MVE_Text_Writer fun_write, void *context)
+{
+    if (vm->profile == NULL) 
+    {
+        fun_write(context, "null");
+        return;
+    }
 
-        while (vm->memory[memory_index] != '\0') {
-            memory_index++;
-        } 
+    MVEbool first = MVE_TRUE;
 
-        memory_index++;
+    fun_write(context, "{\"clock\":\"" MVE_CLOCK_NAME "\",\"operations\":[");
 
-        if (string_equals((const char *) vm->memory + start, name))
-        {
-            vm->external_functions[function_index] = function;
-            return;
-        }
+    for (uint16_t i = 0; i < 256; i++) {
+        const MVE_Profile_Entry *entry = &vm->profile->operations[i];
 
-        function_index++;
+        if (entry->count == 0)
+            continue;
+
+        if (!first)
+            fun_write(context, ",");
+
+        mve_profile_write_entry(fun_write, context, "op", i, mve_op_name((uint8_t) i), entry);
+
+        first = MVE_FALSE;
+    }
+
+    first = MVE_TRUE;
+
+    fun_write(context, "],\"external_functions\":[");
+
+    for (uint16_t i = 0; i < MVE_EXTERNAL_FUNCTIONS_LIMIT; i++) {
+        const MVE_Profile_Entry *entry = &vm->profile->external_functions[i];
+
+        if (entry->count == 0)
+            continue;
+
+        if (!first)
+            fun_write(context, ",");
+
+        mve_profile_write_entry(fun_write, context, "index", i, NULL, entry);
+
+        first = MVE_FALSE;
     }
+
+    fun_write(context, "]}");
 }
+#endif
 
 
-void mve_start(MVE_VM *vm) 
+#ifdef MVE_LOADER_STATS
+MVE_API const MVE_Loader_Stats *mve_loader_stats_get(MVE_VM *vm)
 {
-    vm->is_running = MVE_TRUE;
+    return &vm->loader_stats;
+}
 
-    // Reset the scopes because they are not set at runtime, unless on CALL instructions.
-    // Without this, JMP instructions will misbehave.
-    for (uint32_t i = 0; i < MVE_SCOPE_LIMIT; i++) {
-        vm->scopes[i].program_index = 0;
-        vm->scopes[i].stack_base = 0;
+
+MVE_API void mve_loader_stats_reset(MVE_VM *vm)
+{
+    memset(&vm->loader_stats, 0, sizeof(MVE_Loader_Stats));
+}
+
+
+MVE_API void mve_loader_stats_write_json(MVE_VM *vm, MVE_Text_Writer fun_write, void *context)
+{
+    const MVE_Loader_Stats *stats = &vm->loader_stats;
+    MVE_Loader_Site sites[MVE_LOADER_STATS_SITES];
+
+    memcpy(sites, stats->sites, sizeof(sites));
+
+    // Sort the sites by the amount of reloads.
+    for (uint8_t i = 1; i < MVE_LOADER_STATS_SITES; i++) {
+        MVE_Loader_Site site = sites[i];
+        uint8_t j = i;
+
+        for (; j > 0 && sites[j - 1].reloads < site.reloads; j--)
+            sites[j] = sites[j - 1];
+
+        sites[j] = site;
+    }
+
+    fun_write(context, "{\"clock\":\"" MVE_CLOCK_NAME "\",\"sequential_loads\":");
+    mve_write_uint(fun_write, context, stats->sequential_loads);
+    fun_write(context, ",\"jump_loads\":");
+    mve_write_uint(fun_write, context, stats->jump_loads);
+    fun_write(context, ",\"direct_loads\":");
+    mve_write_uint(fun_write, context, stats->direct_loads);
+    fun_write(context, ",\"bytes\":");
+    mve_write_uint(fun_write, context, stats->bytes);
+    fun_write(context, ",\"ticks\":");
+    mve_write_uint(fun_write, context, stats->ticks);
+    fun_write(context, ",\"jump_sites\":[");
+
+    for (uint8_t i = 0; i < MVE_LOADER_STATS_SITES && sites[i].reloads != 0; i++) {
+        if (i > 0)
+            fun_write(context, ",");
+
+        fun_write(context, "{\"program_index\":");
+        mve_write_uint(fun_write, context, sites[i].program_index);
+        fun_write(context, ",\"reloads\":");
+        mve_write_uint(fun_write, context, sites[i].reloads);
+        fun_write(context, "}");
     }
+
+    fun_write(context, "]}");
 }
+#endif
 
 
-void mve_run(MVE_VM *vm) 
+#ifdef MVE_TRACK_USAGE
+MVE_API const MVE_Usage *mve_usage_get(MVE_VM *vm)
 {
-    uint8_t next_operation = mve_request_uint8(vm);
+    return &vm->usage;
+}
 
-    switch (next_operation)
+
+MVE_API void mve_usage_reset(MVE_VM *vm)
+{
+    memset(&vm->usage, 0, sizeof(MVE_Usage));
+}
+#endif
+
+
+#ifdef MVE_SAMPLING
+MVE_API void mve_sampler_init(MVE_Sampler *sampler, MVE_Sample *samples, uint32_t capacity, uint32_t interval)
+{
+    sampler->samples = samples;
+    sampler->capacity = capacity;
+    sampler->count = 0;
+    sampler->interval = interval;
+    sampler->countdown = interval;
+    sampler->requested = 0;
+}
+
+
+MVE_API void mve_sampler_attach(MVE_VM *vm, MVE_Sampler *sampler)
+{
+    vm->sampler = sampler;
+}
+
+
+MVE_API void mve_sampler_request(MVE_Sampler *sampler)
+{
+    sampler->requested = 1;
+}
+
+
+MVE_API void mve_sampler_write_folded(const MVE_Sampler *sampler, const MVE_Symbol *symbols, uint32_t symbols_count, MVE_Sample *scratch, MVE_Text_Writer fun_write, void *context)
+{
+    uint32_t count = sampler->count < sampler->capacity ? sampler->count : sampler->capacity;
+
+    // With symbols, the program indices inside the same symbol are the same frame, so they are replaced by the start of the symbol.
+    // Indices before all the symbols are kept, and cannot be the start of a symbol.
+    for (uint32_t i = 0; i < count; i++) {
+        scratch[i] = sampler->samples[i];
+
+        for (uint8_t j = 0; j < scratch[i].depth && symbols != NULL; j++) {
+            const MVE_Symbol *symbol = mve_find_symbol(symbols, symbols_count, scratch[i].frames[j]);
+
+            if (symbol != NULL)
+                scratch[i].frames[j] = symbol->start;
+        }
+    }
+
+    // Equal call stacks end up next to each other, so each run writes a line with its length.
+    mve_sort_samples(scratch, count);
+
+    for (uint32_t i = 0; i < count; ) {
+        const MVE_Sample *sample = &scratch[i];
+        uint32_t equals = 1;
+
+        while (i + equals < count && mve_sample_compare(&scratch[i + equals], sample) == 0)
+            equals++;
+
+        for (uint8_t j = 0; j < sample->depth; j++) {
+            if (j > 0)
+                fun_write(context, ";");
+
+            mve_write_symbol(symbols, symbols_count, sample->frames[j], fun_write, context);
+        }
+
+        fun_write(context, " ");
+        mve_write_uint(fun_write, context, equals);
+        fun_write(context, "\n");
+
+        i += equals;
+    }
+}
+#endif
+
+
+#ifdef MVE_TRACE
+MVE_API void mve_trace_init(MVE_Trace *trace, MVE_Trace_Entry *entries, uint32_t capacity)
+{
+    uint32_t size = 1;
+
+    while (size * 2 <= capacity && size * 2 != 0)
+        size *= 2;
+
+    trace->entries = entries;
+    trace->mask = size - 1;
+    trace->count = 0;
+}
+
+
+MVE_API void mve_trace_attach(MVE_VM *vm, MVE_Trace *trace)
+{
+    if (trace == NULL)
     {
-    case MVE_OP_LDR:
-        mve_op_ldr(vm);
-        break;
-    case MVE_OP_STR:
-        mve_op_str(vm);
-        break;
-    case MVE_OP_LDS:
-        mve_op_lds(vm);
-        break;
-    case MVE_OP_STS:
-        mve_op_sts(vm);
-        break;
-    case MVE_OP_LDI:
-        mve_op_ldi(vm);
-        break;
-    case MVE_OP_MOV:
-        mve_op_mov(vm);
-        break;
-    case MVE_OP_NEG:
-        mve_op_neg(vm);
-        break;
-    case MVE_OP_INVOKE:
-        mve_op_invoke(vm);
-        break;
-    case MVE_OP_ADD:
-        mve_op_add(vm);
-        break;
-    case MVE_OP_SUB:
-        mve_op_sub(vm);
-        break;
-    case MVE_OP_MUL:
-        mve_op_mul(vm);
-        break;
-    case MVE_OP_DIV:
-        mve_op_div(vm);
-        break;
-    case MVE_OP_SCOPE:
-        mve_op_scope(vm);
-        break;
-    case MVE_OP_END:
-        mve_op_end(vm);
-        break;
-    case MVE_OP_CMP:
-        mve_op_cmp(vm);
-        break;
-    case MVE_OP_JMP:
-        mve_op_jmp(vm);
-        break;
-    case MVE_OP_JNZ:
-        mve_op_jnz(vm);
-        break;
-    case MVE_OP_CALL:
-        mve_op_call(vm);
-        break;
-    case MVE_OP_AND:
-        mve_op_and(vm);
-        break;
-    case MVE_OP_ORR:
-        mve_op_orr(vm);
-        break;
-    case MVE_OP_NOT:
-        mve_op_not(vm);
-        break;
-    case MVE_OP_LSL:
-        mve_op_lsl(vm);
-        break;
-    case MVE_OP_LSR:
-        mve_op_lsr(vm);
-        break;
-    case MVE_OP_XOR:
-        mve_op_xor(vm);
-        break;
-    case MVE_OP_INC:
-        mve_op_inc(vm);
-        break;
-    case MVE_OP_DEC:
-        mve_op_dec(vm);
-        break;
-    case MVE_OP_PUSH:
-        mve_op_push(vm);
-        break;
-    case MVE_OP_POP:
-        mve_op_pop(vm);
-        break;
-    case MVE_OP_LADR:
-        mve_op_ladr(vm);
-        break;
-    case MVE_OP_EOP:
-        mve_stop(vm);
-        break;
-    default:
-        MVE_ASSERT(MVE_FALSE, vm, MVE_ERROR_UNDEFINED_OP, "Undefined instruction! Code does not exist.");
-        mve_stop(vm);
-        break;
+        vm->trace_scratch.entries = &vm->trace_scratch_entry;
+        vm->trace_scratch.mask = 0;
+        vm->trace_scratch.count = 0;
+
+        trace = &vm->trace_scratch;
     }
+
+    vm->trace = trace;
+    vm->trace_entry = &trace->entries[trace->count & trace->mask];
 }
 
 
-MVEbool mve_is_running(MVE_VM *vm) 
+/**
+ * @brief Returns the index in the ring of the oldest of the last entries of a trace, and limits the amount of entries to the ones recorded.
+ */
+static uint32_t mve_trace_first(const MVE_Trace *trace, uint32_t *last)
 {
-    return vm->is_running;
+    uint32_t recorded = trace->count < trace->mask + 1 ? trace->count : trace->mask + 1;
+
+    if (*last > recorded)
+        *last = recorded;
+
+    return trace->count - *last;
 }
 
 
-void mve_stop(MVE_VM *vm) 
+MVE_API void mve_trace_dump(const MVE_Trace *trace, uint32_t last, MVE_Text_Writer fun_write, void *context)
 {
-    vm->is_running = MVE_FALSE;
+    static const char digits[] = "0123456789abcdef";
+    static const char *names[] = { "r0", "r1", "r2", "r3", "r4", "sp", "mp" };
+    uint32_t first = mve_trace_first(trace, &last);
+
+    for (uint32_t i = first; i != trace->count; i++) {
+        const MVE_Trace_Entry *entry = &trace->entries[i & trace->mask];
+        const MVE_Trace_Entry *previous = i != first ? &trace->entries[(i - 1) & trace->mask] : NULL;
+        const char *name = mve_op_name(entry->operation);
+
+        mve_write_uint(fun_write, context, entry->program_index);
+        fun_write(context, ": ");
+
+        if (name != NULL)
+            fun_write(context, name);
+        else
+            mve_write_uint(fun_write, context, entry->operation);
+
+        uint8_t operands = entry->operands_length < MVE_TRACE_OPERANDS ? entry->operands_length : MVE_TRACE_OPERANDS;
+
+        for (uint8_t j = 0; j < operands; j++) {
+            char text[4] = { ' ', digits[entry->operands[j] >> 4], digits[entry->operands[j] & 0xF], '\0' };
+            fun_write(context, text);
+        }
+
+        if (entry->operands_length > MVE_TRACE_OPERANDS)
+            fun_write(context, " ...");
+
+        fun_write(context, " |");
+
+        // Only the registers changed by the instruction. The first entry has no previous one, so it writes all of them.
+        for (uint8_t j = 0; j < MVE_REGISTERS_SIZE; j++) {
+            if (previous != NULL && previous->registers.all[j].i == entry->registers.all[j].i)
+                continue;
+
+            fun_write(context, " ");
+
+            if (j < 7)
+            {
+                fun_write(context, names[j]);
+            }
+            else
+            {
+                fun_write(context, "r");
+                mve_write_uint(fun_write, context, j);
+            }
+
+            fun_write(context, "=");
+            mve_write_uint(fun_write, context, entry->registers.all[j].i);
+        }
+
+        fun_write(context, "\n");
+    }
+}
+
+
+MVE_API void mve_trace_write_binary(const MVE_Trace *trace, uint32_t last, void (*fun_write)(void *context, const uint8_t *data, uint32_t length), void *context)
+{
+    uint8_t data[6 + MVE_TRACE_OPERANDS + MVE_REGISTERS_SIZE * MVE_BASE_TYPE_SIZE];
+    uint32_t first = mve_trace_first(trace, &last);
+
+    uint8_t header[13] = { 'M', 'V', 'E', 'T', 
+                           MVE_TRACE_FORMAT_VERSION & 0xFF, MVE_TRACE_FORMAT_VERSION >> 8, 
+                           MVE_REGISTERS_SIZE, MVE_TRACE_OPERANDS, MVE_BASE_TYPE_SIZE,
+                           (uint8_t) (last & 0xFF), (uint8_t) ((last >> 8) & 0xFF), (uint8_t) ((last >> 16) & 0xFF), (uint8_t) (last >> 24) };
+
+    fun_write(context, header, sizeof(header));
+
+    for (uint32_t i = first; i != trace->count; i++) {
+        const MVE_Trace_Entry *entry = &trace->entries[i & trace->mask];
+        uint32_t length = 0;
+
+        for (uint8_t j = 0; j < 4; j++)
+            data[length++] = (entry->program_index >> (j * 8)) & 0xFF;
+
+        data[length++] = entry->operation;
+        data[length++] = entry->operands_length;
+
+        for (uint8_t j = 0; j < MVE_TRACE_OPERANDS; j++)
+            data[length++] = entry->operands[j];
+
+        for (uint8_t j = 0; j < MVE_REGISTERS_SIZE; j++) {
+            for (uint8_t k = 0; k < MVE_BASE_TYPE_SIZE; k++)
+                data[length++] = (entry->registers.all[j].i >> (k * 8)) & 0xFF;
+        }
+
+        fun_write(context, data, length);
+    }
 }
+#endif
\ No newline at end of file
@@ -9,7 +9,7 @@
 
 
 #define MVE_VERSION_MAJOR ((uint16_t)1) // Bytecode major version. The program must have the same version.
-#define MVE_VERSION_MINOR ((uint16_t)0) // Bytecode minor version. The program must have a lower or same version.
+#define MVE_VERSION_MINOR ((uint16_t)2) // Bytecode minor version. The program must have a lower or same version.
 
 
 #ifndef MVE_EXTERNAL_FUNCTIONS_LIMIT
@@ -17,6 +17,13 @@
 #endif
 
 
+// Prefix of the functions of the API. Defined as static when mve.c is included in more than one translation unit
+// with a different configuration each, so every copy of the VM stays private to its own unit.
+#ifndef MVE_API
+#define MVE_API
+#endif
+
+
 #ifdef MVE_LOCAL_PROGRAM
 #define MVE_BUFFER_SIZE UINT32_MAX
 #endif
@@ -45,6 +52,37 @@
 #endif
 
 
+#ifndef MVE_FRAME_LIMIT
+#define MVE_FRAME_LIMIT 8
+#endif
+
+#if MVE_FRAME_LIMIT < 1
+#error MVE_FRAME_LIMIT must be at least 1.
+#endif
+
+
+// With growable scopes, MVE_SCOPE_LIMIT and MVE_FRAME_LIMIT are only the initial capacity, which doubles when full, up to these.
+#ifdef MVE_GROWABLE_SCOPES
+
+#ifndef MVE_SCOPE_MAX
+#define MVE_SCOPE_MAX 65536
+#endif
+
+#ifndef MVE_FRAME_MAX
+#define MVE_FRAME_MAX 65536
+#endif
+
+#ifndef MVE_REALLOC
+#define MVE_REALLOC(pointer, size) realloc(pointer, size)
+#endif
+
+#ifndef MVE_FREE
+#define MVE_FREE(pointer) free(pointer)
+#endif
+
+#endif
+
+
 #ifndef MVE_REGISTERS_SIZE
 #define MVE_REGISTERS_SIZE 7
 #endif
@@ -53,12 +91,135 @@
 #error "MVE_REGISTERS_SIZE must be 7 or higher."
 #endif
 
+#define MVE_REGISTER_SP 5                           // Index of the stack pointer in the registers.
+#define MVE_REGISTER_MP 6                           // Index of the memory pointer in the registers.
+
+// Amount of registers a PUSHM or POPM mask can name, with a bit for each register from the lowest one.
+#define MVE_REGISTERS_MASK_SIZE (MVE_REGISTERS_SIZE < 16 ? MVE_REGISTERS_SIZE : 16)
+#define MVE_REGISTERS_MASK ((uint16_t) ((1u << MVE_REGISTERS_MASK_SIZE) - 1))
+
 
 #if MVE_SCOPE_LIMIT < 4
 #error MVE_SCOPE_LIMIT must be greater than 4.
 #endif
 
 
+#ifdef MVE_RUNTIME_SIZES
+#define MVE_VM_STACK_SIZE(vm) (vm->stack_size)
+#define MVE_VM_MEMORY_SIZE(vm) (vm->memory_size)
+#else
+#define MVE_VM_STACK_SIZE(vm) MVE_STACK_SIZE
+#define MVE_VM_MEMORY_SIZE(vm) MVE_MEMORY_SIZE
+#endif
+
+#if defined(MVE_RUNTIME_SIZES) || defined(MVE_GROWABLE_SCOPES)
+#define MVE_VM_SCOPE_LIMIT(vm) (vm->scope_limit)
+#else
+#define MVE_VM_SCOPE_LIMIT(vm) MVE_SCOPE_LIMIT
+#endif
+
+#ifdef MVE_GROWABLE_SCOPES
+#define MVE_VM_FRAME_LIMIT(vm) (vm->frame_limit)
+#else
+#define MVE_VM_FRAME_LIMIT(vm) MVE_FRAME_LIMIT
+#endif
+
+#if defined(MVE_RUNTIME_SIZES) && !defined(MVE_LOCAL_PROGRAM)
+#define MVE_VM_BUFFER_SIZE(vm) (vm->buffer_size)
+#else
+#define MVE_VM_BUFFER_SIZE(vm) MVE_BUFFER_SIZE
+#endif
+
+
+#ifndef MVE_CACHE_LINE_SIZE
+#define MVE_CACHE_LINE_SIZE 64
+#endif
+
+
+#ifdef MVE_PROFILE
+#ifndef MVE_PROFILE_HISTOGRAM_SIZE
+#define MVE_PROFILE_HISTOGRAM_SIZE 16
+#endif
+#endif
+
+
+#ifdef MVE_SAMPLING
+#ifndef MVE_SAMPLE_DEPTH
+#define MVE_SAMPLE_DEPTH 8
+#endif
+#endif
+
+
+#ifdef MVE_LOADER_STATS
+#ifndef MVE_LOADER_STATS_SITES
+#define MVE_LOADER_STATS_SITES 8
+#endif
+#endif
+
+
+#ifdef MVE_TRACE
+#ifndef MVE_TRACE_OPERANDS
+#define MVE_TRACE_OPERANDS 10
+#endif
+#endif
+
+
+#ifdef MVE_TRACK_USAGE
+#ifndef MVE_USAGE_BLOCKS
+#define MVE_USAGE_BLOCKS 256
+#endif
+#endif
+
+
+#ifdef MVE_USE_REGIONS
+#ifndef MVE_REGIONS_LIMIT
+#define MVE_REGIONS_LIMIT 4
+#endif
+#endif
+
+
+#ifdef MVE_USE_EXPORTS
+#ifndef MVE_EXPORTS_LIMIT
+#define MVE_EXPORTS_LIMIT 8
+#endif
+#endif
+
+
+#ifdef MVE_USE_IMAGES
+#define MVE_IMAGE_MAGIC 0x4945564Du                 // "MVEI" in little endian.
+#define MVE_IMAGE_VERSION 1                         // Layout of the images. Images of other versions are rejected.
+#endif
+
+
+#ifdef MVE_USE_CHANNELS
+
+#ifndef MVE_CHANNELS_LIMIT
+#define MVE_CHANNELS_LIMIT 4
+#endif
+
+#ifndef MVE_CHANNEL_MESSAGE_SIZE
+#define MVE_CHANNEL_MESSAGE_SIZE 16
+#endif
+
+#if MVE_CHANNEL_MESSAGE_SIZE < 8
+#error MVE_CHANNEL_MESSAGE_SIZE must be 8 or higher.
+#endif
+
+#ifndef MVE_ATOMIC_LOAD
+#if defined(__GNUC__) || defined(__clang__)
+#define MVE_ATOMIC_LOAD(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define MVE_ATOMIC_STORE(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELEASE)
+#define MVE_ATOMIC_EXCHANGE(pointer, value) __atomic_exchange_n(pointer, value, __ATOMIC_ACQ_REL)
+#define MVE_ATOMIC_COMPARE_EXCHANGE(pointer, expected, desired) __atomic_compare_exchange_n(pointer, expected, desired, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define MVE_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#error MVE_USE_CHANNELS requires the MVE_ATOMIC_* macros to be defined for this compiler.
+#endif
+#endif
+
+#endif
+
+
 #ifdef MVE_ERROR_LOG
 #define STR(x) #x
 #define MVE_ASSERT(x, vm, error_id, msg) if (!(x)) { MVE_ERROR_LOG(vm, vm->program_index + vm->buffer_index, error_id, "Error " STR(error_id) ": "  msg); while(1) {} }
@@ -67,6 +228,16 @@
 #endif
 
 
+// Grows the scopes or the frames before using the next one, when they are full. On failure, the limit check after it fails.
+#ifdef MVE_GROWABLE_SCOPES
+#define MVE_GROW_SCOPES(vm) if ((vm)->scope_index + 1 >= (vm)->scope_limit) mve_reserve_scopes(vm, (vm)->scope_index + 2, 0)
+#define MVE_GROW_FRAMES(vm) if ((vm)->frame_index >= (vm)->frame_limit) mve_reserve_scopes(vm, 0, (vm)->frame_index + 1)
+#else
+#define MVE_GROW_SCOPES(vm) (void)0
+#define MVE_GROW_FRAMES(vm) (void)0
+#endif
+
+
 #define MVE_ERROR_INCOMPATIBLE_VERSION                  0       // Happens when the program is not not compatible.
 #define MVE_ERROR_STACK_OUT_OF_RANGE                    1       // Happens when trying to access an index bigger than the size of the stack.
 #define MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE        2       // Happens when calling an external functions, which index is invalid.
@@ -75,9 +246,33 @@
 #define MVE_ERROR_UNRECOGNIZED_CMP_OPERATION            5       // Happens when a compare instruction has an unrecognized operation that is not between 0 and 5.
 #define MVE_ERROR_SCOPE_LIMIT_REACHED                   6       // Happens when the scope stack index surpasses MVE_SCOPE_LIMIT. 
 #define MVE_ERROR_MEMORY_OUT_OF_RANGE                   7       // Happens when trying to access an index bigger than the size of the memory.
+#define MVE_ERROR_CHANNEL_OUT_OF_RANGE                  8       // Happens when using a channel index that is invalid or was not linked into the VM.
+#define MVE_ERROR_CHANNEL_MESSAGE_TOO_BIG               9       // Happens when sending a message bigger than MVE_CHANNEL_MESSAGE_SIZE.
+#define MVE_ERROR_INCOMPATIBLE_SIZES                    10      // Happens when the program requires more stack, memory or scopes than the VM has.
+#define MVE_ERROR_ARENA_EXHAUSTED                       11      // Happens when the arena does not have enough space left for the storage of the VM.
+#define MVE_ERROR_INVALID_LENGTH                        12      // Happens when the length of a value is bigger than the size of a register.
+#define MVE_ERROR_FRAME_LIMIT_REACHED                   13      // Happens when FCALL is used with MVE_FRAME_LIMIT frames already in use.
+#define MVE_ERROR_FRAME_OUT_OF_RANGE                    14      // Happens when RET is used without a frame to return from.
+#define MVE_ERROR_ALLOCATION_FAILED                     15      // Happens when MVE_REALLOC cannot allocate the initial scopes and frames.
+#define MVE_ERROR_REGION_OUT_OF_RANGE                   16      // Happens when using a region index that is invalid or was not linked into the VM.
+#define MVE_ERROR_REGION_ADDRESS_OUT_OF_RANGE           17      // Happens when accessing bytes past the end of a region.
+#define MVE_ERROR_REGION_READ_ONLY                      18      // Happens when writing into a region that was not linked as writable.
+#define MVE_ERROR_INCOMPATIBLE_WIDTH                    19      // Happens when the program requires values of another size than MVE_BASE_TYPE_SIZE.
+#define MVE_ERROR_EXPORT_OUT_OF_RANGE                   20      // Happens when the program has more exports than MVE_EXPORTS_LIMIT, or when calling an export index that is invalid.
+#define MVE_ERROR_EXPORT_PENDING                        21      // Happens when calling an export while the previous one did not return yet.
+#define MVE_ERROR_DUPLICATE_EXPORT                      22      // Happens when two exports of the program have the same name hash.
 #define MVE_ERROR_UNDEFINED_OP                          57      // Happens when the OP of the next instruction is not recognized.
 
 
+#define MVE_SCOPE_ZERO_FILL             ((uint32_t) 0x80000000) // Flag of the length of a scope memory. When set, the length is followed by an uint32 with an amount of bytes set to 0, after the initial bytes.
+
+
+#define MVE_HEADER_END                  ((uint8_t) 0)           // Ends the sections of the header.
+#define MVE_HEADER_SIZES                ((uint8_t) 1)           // The stack size, memory size and scope limit required by the program, as uint32. A 0 keeps the VM value.
+#define MVE_HEADER_WIDTH                ((uint8_t) 2)           // The size of the values of the program, as an uint8 of 4 or 8 bytes. Without it, the program runs with any size.
+#define MVE_HEADER_EXPORTS              ((uint8_t) 3)           // The functions the host can call. Each one is its name, ending with a 0, followed by its program index as uint32.
+
+
 #define MVE_OP_EOP                      ((uint8_t) 0)           // Indicates the end of the program. Stops the virtual machine.
 
 #define MVE_OP_LDR                      ((uint8_t) 1)           // Load bytes from the stack into a register, using an address and length from registers.
@@ -120,6 +315,24 @@
 #define MVE_OP_PUSH                     ((uint8_t) 64)          // Push a value from a register into the stack.
 #define MVE_OP_POP                      ((uint8_t) 65)          // Pop a value from the stack into a register.
 #define MVE_OP_LADR                     ((uint8_t) 66)          // Puts the absolute memory address of a local memory chunk in a register.
+#define MVE_OP_SEND                     ((uint8_t) 67)          // Sends the value of a register through a channel. Blocks while the channel is full.
+#define MVE_OP_RECV                     ((uint8_t) 68)          // Receives a value from a channel into a register. Blocks while the channel is empty.
+#define MVE_OP_SENDS                    ((uint8_t) 69)          // Sends bytes of the stack through a channel, using an address and length from registers.
+#define MVE_OP_RECVS                    ((uint8_t) 70)          // Receives a message from a channel into the stack, using an address from a register. The length is stored into a register.
+#define MVE_OP_PUSHM                    ((uint8_t) 71)          // Push the values of many registers, from a mask, into the stack. The lowest register is pushed first.
+#define MVE_OP_POPM                     ((uint8_t) 72)          // Pop values from the stack into many registers, from a mask. The highest register is popped first, so the same mask restores a PUSHM.
+#define MVE_OP_FCALL                    ((uint8_t) 73)          // Jumps to a location, pushing a frame to return to. Does not need a scope.
+#define MVE_OP_RET                      ((uint8_t) 74)          // Returns from the last frame, ending the scopes created since its FCALL.
+#define MVE_OP_TCALL                    ((uint8_t) 75)          // Jumps to a location, reusing the last frame. Ends the scopes created since its FCALL, like RET.
+#define MVE_OP_SWITCH                   ((uint8_t) 76)          // Jumps to the location at the index of the value of a register, in a table after the instruction. Jumps to a default location if the value is not below the size of the table.
+#define MVE_OP_LOOP                     ((uint8_t) 77)          // Decrements the value of the given register, and jumps to a location if it is not 0.
+#define MVE_OP_STRLEN                   ((uint8_t) 78)          // Puts the amount of bytes before the first 0, from a stack address in a register, into a register.
+#define MVE_OP_FINDBYTE                 ((uint8_t) 79)          // Puts the index of the first byte with a value, in a range of the stack from registers, into a register. The length if there is none.
+#define MVE_OP_MEMCMP                   ((uint8_t) 80)          // Compares two ranges of the stack from registers. Puts 0 into a register if they are equal, or the index of the first different byte plus 1.
+#define MVE_OP_CRC32C                   ((uint8_t) 81)          // Continues the CRC-32C in a register with a range of the stack from registers.
+#define MVE_OP_LDX                      ((uint8_t) 82)          // Loads a value from a region of host memory into a register, using an index and length from registers.
+#define MVE_OP_STX                      ((uint8_t) 83)          // Stores the value of a register into a writable region of host memory, using an index and length from registers.
+#define MVE_OP_XLEN                     ((uint8_t) 84)          // Puts the length of a region of host memory into a register. 0 if the region is not linked.
 
 
 #define MVE_R0                          ((uint8_t) 0)
@@ -139,9 +352,11 @@
 
 
 
+#define MVE_ASSERT_REGISTER_MASK(mask, msg, vm) MVE_ASSERT((mask & ~MVE_REGISTERS_MASK) == 0, vm, MVE_ERROR_REGISTER_OUT_OF_RANGE, msg " Invalid register mask. The mask cannot have registers bigger than MVE_REGISTERS_SIZE.");
 #define MVE_ASSERT_REGISTER(reg, msg, vm) MVE_ASSERT(reg >= 0 && reg < MVE_REGISTERS_SIZE, vm, MVE_ERROR_REGISTER_OUT_OF_RANGE, msg " Invalid register. The register cannot be negative or bigger than MVE_REGISTERS_SIZE.");
-#define MVE_ASSERT_STACK_ADDRESS(address, msg, vm) MVE_ASSERT(address >= 0 && address < MVE_STACK_SIZE, vm, MVE_ERROR_STACK_OUT_OF_RANGE, msg " Stack address out of range. The address cannot be negative or bigger than MVE_STACK_SIZE.");
-#define MVE_ASSERT_MEMORY_ADDRESS(address, msg, vm) MVE_ASSERT(address >= 0 && address < MVE_MEMORY_SIZE, vm, MVE_ERROR_MEMORY_OUT_OF_RANGE, msg " Memory address out of range. The address cannot be negative or bigger than MVE_MEMORY_SIZE.");
+#define MVE_ASSERT_STACK_ADDRESS(address, msg, vm) MVE_ASSERT(address >= 0 && address < MVE_VM_STACK_SIZE(vm), vm, MVE_ERROR_STACK_OUT_OF_RANGE, msg " Stack address out of range. The address cannot be negative or bigger than MVE_STACK_SIZE.");
+#define MVE_ASSERT_STACK_RANGE(address, length, msg, vm) MVE_ASSERT(address <= MVE_VM_STACK_SIZE(vm) && length <= MVE_VM_STACK_SIZE(vm) - address, vm, MVE_ERROR_STACK_OUT_OF_RANGE, msg " Stack range out of range. The bytes cannot go past the end of the stack.");
+#define MVE_ASSERT_MEMORY_ADDRESS(address, msg, vm) MVE_ASSERT(address >= 0 && address < MVE_VM_MEMORY_SIZE(vm), vm, MVE_ERROR_MEMORY_OUT_OF_RANGE, msg " Memory address out of range. The address cannot be negative or bigger than MVE_MEMORY_SIZE.");
 
 #ifdef MVE_BIG_ENDIAN
 
@@ -240,10 +455,123 @@ typedef struct {
 } MVE_Scope_Info;
 
 
+typedef struct {
+    uint32_t return_index;                      // Program index after the FCALL.
+    uint32_t scope_index;                       // Scope index at the FCALL. The scopes after it are ended on RET.
+} MVE_Frame;
+
+
 struct MVE_VM;
 typedef struct MVE_VM MVE_VM;
 
 
+typedef void (*MVE_Text_Writer)(void *context, const char *text);   // Receives text produced by the VM, such as reports. 
+
+
+#ifdef MVE_PROFILE
+
+typedef struct {
+    uint64_t count;                                     // Amount of executions.
+    uint64_t cycles;                                    // Total clock ticks spent. 0 if there is no clock.
+    uint32_t histogram[MVE_PROFILE_HISTOGRAM_SIZE];     // Executions by clock ticks. The bucket i counts the ones that took less than 2^(i+1) ticks. The last one counts the rest.
+} MVE_Profile_Entry;
+
+
+typedef struct {
+    MVE_Profile_Entry operations[256];                                      // Indexed by the OP.
+    MVE_Profile_Entry external_functions[MVE_EXTERNAL_FUNCTIONS_LIMIT];     // Indexed by the function index used by INVOKE. Only the time inside the function.
+} MVE_Profile;
+
+#endif
+
+
+#ifdef MVE_LOADER_STATS
+
+typedef struct {
+    uint32_t program_index;                     // Program index right after the instruction that jumped out of the buffer.
+    uint32_t reloads;                           // Amount of times the buffer was reloaded from this site.
+} MVE_Loader_Site;
+
+
+typedef struct {
+    uint32_t sequential_loads;                  // Calls to fun_load_next_block because the buffer was read to the end, or reading went on past it.
+    uint32_t jump_loads;                        // Calls to fun_load_next_block because a jump went out of the buffer.
+    uint32_t direct_loads;                      // Calls to fun_load_next_block for data bigger than the buffer, or SWITCH table entries outside it, loaded straight into their destination.
+    uint64_t bytes;                             // Total amount of bytes requested to fun_load_next_block.
+    uint64_t ticks;                             // Total clock ticks spent inside fun_load_next_block.
+    MVE_Loader_Site sites[MVE_LOADER_STATS_SITES];  // Jump sites causing the most reloads. When full, a new site replaces the one with the least reloads and inherits its count, so counts may be overestimated.
+} MVE_Loader_Stats;
+
+#endif
+
+
+#ifdef MVE_TRACK_USAGE
+
+typedef struct {
+    uint32_t peak_stack;                        // Highest stack pointer reached.
+    uint32_t peak_memory;                       // Highest memory pointer reached, or the bytes of the function names kept in the memory until start, if bigger.
+    uint32_t peak_scope;                        // Highest scope index reached. The scope limit must be bigger than it.
+    uint32_t peak_frame;                        // Highest amount of frames in use. MVE_FRAME_LIMIT must not be smaller than it.
+    uint32_t blocks_loaded;                     // Distinct blocks of the program loaded, each with the size of the program buffer. Only when the program is loaded at runtime.
+    uint8_t blocks[(MVE_USAGE_BLOCKS + 7) / 8]; // Bitmap of the blocks loaded. Blocks after MVE_USAGE_BLOCKS are not counted.
+} MVE_Usage;
+
+#endif
+
+
+#ifdef MVE_SAMPLING
+
+typedef struct {
+    uint8_t depth;                              // Amount of program indices in frames.
+    uint32_t frames[MVE_SAMPLE_DEPTH];          // The return addresses of the CALLs, from the outermost, and the program index being executed as the last one.
+} MVE_Sample;
+
+
+typedef struct {
+    MVE_Sample *samples;                        // Ring of samples, provided by the host.
+    uint32_t capacity;                          // Amount of samples in the ring. Once it is full, the oldest samples are replaced.
+    uint32_t count;                             // Amount of samples taken since the sampler was initialized.
+    uint32_t interval;                          // Take a sample every this amount of instructions. 0 to only sample when requested.
+    uint32_t countdown;                         // Instructions left to take the next sample.
+    volatile uint8_t requested;                 // Set by mve_sampler_request, which may be called from a timer interrupt, to take a sample on the next instruction.
+} MVE_Sampler;
+
+
+typedef struct {
+    uint32_t start;                             // Program index where the symbol starts. The symbol ends where the next one starts.
+    const char *name;
+} MVE_Symbol;
+
+#endif
+
+
+#ifdef MVE_RUNTIME_SIZES
+
+typedef struct {
+    uint32_t stack_size;                        // Size of the stack. 0 uses MVE_STACK_SIZE.
+    uint32_t memory_size;                       // Size of the memory. 0 uses MVE_MEMORY_SIZE.
+    uint32_t scope_limit;                       // Maximum amount of scopes. 0 uses MVE_SCOPE_LIMIT. With MVE_GROWABLE_SCOPES, the initial amount.
+    uint32_t buffer_size;                       // Size of the program buffer. 0 uses MVE_BUFFER_SIZE. Ignored with MVE_LOCAL_PROGRAM.
+} MVE_Config;
+
+
+typedef struct {
+    uint8_t *memory;                            // Memory provided by the host.
+    uint32_t size;                              // Size of the memory.
+    uint32_t used;                              // Amount of bytes already given.
+} MVE_Arena;
+
+#endif
+
+
+typedef struct {
+    uint8_t *blocks;                            // First block, aligned to MVE_CACHE_LINE_SIZE.
+    uint32_t block_size;                        // Size of each block, rounded up to MVE_CACHE_LINE_SIZE.
+    uint32_t count;                             // Amount of blocks.
+    void *free_list;                            // Next free block. Each free block stores the next one.
+} MVE_Pool;
+
+
 typedef union
 {
     struct
@@ -259,40 +587,293 @@ typedef union
     
     MVE_Value all[MVE_REGISTERS_SIZE];
 } MVE_Registers;
+
+
+#ifdef MVE_TRACE
+
+#define MVE_TRACE_FORMAT_VERSION ((uint16_t) 1)  // Version of the binary trace written by mve_trace_write_binary.
+
+typedef struct {
+    uint32_t program_index;                     // Program index of the OP.
+    uint8_t operation;
+    uint8_t operands_length;                    // Amount of operand bytes read. If bigger than MVE_TRACE_OPERANDS, the last byte kept is the last one read.
+    uint8_t operands[MVE_TRACE_OPERANDS];       // Operand bytes, in the order they were read.
+    MVE_Registers registers;                    // Registers after the instruction. The changes are found comparing with the previous entry.
+} MVE_Trace_Entry;
+
+
+typedef struct {
+    MVE_Trace_Entry *entries;                   // Ring of entries, provided by the host.
+    uint32_t mask;                              // Amount of entries minus 1. The amount is a power of two.
+    uint32_t count;                             // Amount of instructions traced. The last one is at (count - 1) & mask.
+} MVE_Trace;
+
+#endif
     
 
+#ifdef MVE_USE_REGIONS
+
+typedef struct {
+    uint8_t *data;                              // Bytes of the host, used in place. NULL if the region is not linked.
+    uint32_t length;
+    MVEbool writable;                           // If STX can write into the region.
+} MVE_Region;
+
+#endif
+
+
+// Images keep the exports of the program, so the type is also needed by MVE_USE_IMAGES.
+#if defined(MVE_USE_EXPORTS) || defined(MVE_USE_IMAGES)
+
+typedef struct {
+    uint32_t name_hash;                         // FNV-1a hash of the name. The name itself is not kept.
+    uint32_t program_index;                     // Where the function starts. It returns to the host with RET.
+} MVE_Export;
+
+#endif
+
+
+#ifdef MVE_USE_IMAGES
+
+/**
+ * Start of an image, a snapshot of the VM right after mve_init loaded the header of a program.
+ * It is followed by the bytes of the stack, the bytes of the memory and the MVE_Export entries.
+ * Images are only valid for the program and the build that wrote them, and are not meant to be moved between machines.
+ */
+typedef struct {
+    uint32_t magic;                             // MVE_IMAGE_MAGIC.
+    uint32_t code_index;                        // Program index of the first instruction, after the header.
+    uint64_t config;                            // Fingerprint of the build of the VM. Images of other builds are rejected.
+    uint64_t program_hash;                      // Hash of the program, given by the host, usually from mve_image_hash.
+    uint32_t sizes[3];                          // Stack size, memory size and scope limit required by the program. 0 if not set.
+    uint32_t stack_length;                      // Bytes of the main scope in the stack.
+    uint32_t memory_length;                     // Bytes of the function names in the memory.
+    uint16_t external_functions_count;
+    uint16_t exports_count;
+} MVE_Image;
+
+#endif
+
+
+#ifdef MVE_USE_CHANNELS
+
+typedef struct {
+    uint32_t sequence;                          // Position of the ring the slot is ready for. Used to synchronize producers and the consumer.
+    uint32_t length;                            // Amount of bytes of the message.
+    uint8_t data[MVE_CHANNEL_MESSAGE_SIZE];     // The bytes of the message.
+} MVE_Channel_Slot;
+
+
+typedef struct MVE_Channel MVE_Channel;
+
+struct MVE_Channel {
+    MVE_Channel_Slot *slots;                    // Storage of the ring, provided by the host.
+    uint32_t mask;                              // The capacity of the ring minus one. The capacity must be a power of two.
+    MVEbool multi_producer;                     // Indicates if more than one producer can send at the same time.
+
+    void (*fun_park)(MVE_VM *, MVE_Channel *);  // Called when a VM blocks on the channel. Can be NULL.
+    void (*fun_wake)(MVE_VM *, MVE_Channel *);  // Called when a VM parked on the channel can continue. Can be NULL.
+    void *context;                              // Host data, such as the scheduler owning the VMs.
+
+    uint8_t padding_head[MVE_CACHE_LINE_SIZE];
+    uint32_t head;                              // Next position to be written by producers.
+    MVE_VM *parked_sender;                      // Sender waiting for a free slot. Only tracked on single producer channels.
+
+    uint8_t padding_tail[MVE_CACHE_LINE_SIZE];
+    uint32_t tail;                              // Next position to be read by the consumer.
+    MVE_VM *parked_receiver;                    // Receiver waiting for a message.
+};
+
+#endif
+
+
 struct MVE_VM {
 
+    // Hot state, used by every instruction. It is kept at the start, so it fits in a single cache line
+    // when the VM is aligned (see mve_pool_init). With MVE_USE_64BIT_TYPES the registers alone take 56 bytes, so it takes two.
+
     MVE_Registers registers;                    // Contains the registers of the virtual machine.
                                                 // The first one is used to store the result from operations and also the returned value from functions.
                                                 // The others can be used to general purpose.
 
-    void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t);
-
-    void *external_functions[MVE_EXTERNAL_FUNCTIONS_LIMIT];
-
     uint32_t buffer_index;                      // The current position in the program buffer.
-
+    uint32_t program_index;                     // The position in the program that is executing. This is only updated when loading the next bytes of the program.
     uint32_t scope_index;                       // The current scope index.
-    MVE_Scope_Info scopes[MVE_SCOPE_LIMIT];     // Used to know where it was when calling contexts.
+    uint32_t frame_index;                       // The amount of frames in use.
+    MVEbool is_running;
 
-#ifdef MVE_LOCAL_PROGRAM
+#if defined(MVE_LOCAL_PROGRAM) || defined(MVE_RUNTIME_SIZES)
     uint8_t *program_buffer;                    // Buffer to store the next instructions of the program to be processed.
 #else
     uint8_t program_buffer[MVE_BUFFER_SIZE];    // Buffer to store the next instructions of the program to be processed.
 #endif
 
-    uint32_t program_index;                     // The position in the program that is executing. This is only updated when loading the next bytes of the program.
+    // Storage of the program data.
 
+#ifdef MVE_RUNTIME_SIZES
+    uint8_t *stack;                             // Stores fixed size data, managed by the scope. Carved from the arena.
+    uint8_t *memory;                            // A stack memory used to manually store and remove values, with PUSH and POP. Carved from the arena.
+    MVE_Scope_Info *scopes;                     // Used to know where it was when calling contexts. Carved from the arena.
+
+    uint32_t stack_size;
+    uint32_t memory_size;
+    uint32_t scope_limit;
+    uint32_t buffer_size;
+#else
+#ifdef MVE_GROWABLE_SCOPES
+    MVE_Scope_Info *scopes;                     // Used to know where it was when calling contexts. Allocated with MVE_REALLOC.
+    uint32_t scope_limit;                       // Amount of scopes allocated.
+#else
+    MVE_Scope_Info scopes[MVE_SCOPE_LIMIT];     // Used to know where it was when calling contexts.
+#endif
     uint8_t stack[MVE_STACK_SIZE];              // Stores fixed size data, managed by the scope.
     uint8_t memory[MVE_MEMORY_SIZE];            // A stack memory used to manually store and remove values, with PUSH and POP.
+#endif
+
+#ifdef MVE_GROWABLE_SCOPES
+    MVE_Frame *frames;                          // Return points of FCALL. Allocated with MVE_REALLOC.
+    uint32_t frame_limit;                       // Amount of frames allocated.
+#else
+    MVE_Frame frames[MVE_FRAME_LIMIT];          // Return points of FCALL. Smaller than a scope, and does not touch the stack.
+#endif
+
+    // Cold state, only used when linking, loading the program or calling the host.
+
+    void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t);
 
+    void *external_functions[MVE_EXTERNAL_FUNCTIONS_LIMIT];
     uint16_t external_functions_count;
-    MVEbool is_running;
+    uint16_t invoked_function;                  // Index of the external function called by the last INVOKE, so a function linked to many names knows which one was called.
+
+#ifdef MVE_RUNTIME_SIZES
+    MVE_Arena *arena;                           // Where the storage of the VM is carved from on init.
+#endif
+
+#ifdef MVE_PROFILE
+    MVE_Profile *profile;                       // Where the execution counters are recorded. NULL to not record.
+#endif
+
+#ifdef MVE_TRACE
+    MVE_Trace *trace;                           // Where the executed instructions are recorded. Points to trace_scratch when there is no trace attached.
+    MVE_Trace_Entry *trace_entry;               // Entry of the instruction being executed, which receives the operands read.
+    MVE_Trace trace_scratch;                    // A trace of a single entry, always overwritten, so tracing needs no checks.
+    MVE_Trace_Entry trace_scratch_entry;
+#endif
+
+#ifdef MVE_LOADER_STATS
+    MVE_Loader_Stats loader_stats;              // Counters of the calls to fun_load_next_block.
+#endif
+
+#ifdef MVE_TRACK_USAGE
+    MVE_Usage usage;                            // Highest usage of the stack, memory, scopes and program.
+#endif
+
+#ifdef MVE_SAMPLING
+    MVE_Sampler *sampler;                       // Where the call stacks are sampled into. NULL to not sample.
+#endif
+
+#ifdef MVE_USE_CHANNELS
+    MVE_Channel *channels[MVE_CHANNELS_LIMIT]; // Channels linked into the VM, used by SEND and RECV.
+    MVE_Channel *parked_channel;                // The channel the VM is blocked on. NULL if it is not blocked.
+#endif
+
+#ifdef MVE_USE_REGIONS
+    MVE_Region regions[MVE_REGIONS_LIMIT];      // Host memory linked into the VM, used by LDX, STX and XLEN.
+#endif
+
+#ifdef MVE_USE_EXPORTS
+    MVE_Export exports[MVE_EXPORTS_LIMIT];      // Functions of the program called by the host, from the MVE_HEADER_EXPORTS section.
+    uint16_t exports_count;
+    MVEbool export_pending;                     // If an export was called and did not return yet.
+    MVEbool export_running;                     // If the VM was running when the export was called.
+    uint32_t export_frame;                      // Index of the frame of the export. It returned once the frames are back to it.
+    uint32_t export_scope_return;               // Program index set by a CALL in the scope after the current one, kept while the export runs.
+    MVE_Registers export_registers;             // Registers when the export was called, given back when it ends.
+#ifdef MVE_USE_CHANNELS
+    MVE_Channel *export_parked_channel;         // The channel the VM was blocked on when the export was called.
+#endif
+#endif
+
+#ifdef MVE_USE_IMAGES
+    uint32_t image_sizes[3];                    // Sizes from the MVE_HEADER_SIZES section, kept to write them into an image.
+#endif
 };
 
 
 
+/**
+ * @brief Prepares a pool of fixed size blocks, aligned to MVE_CACHE_LINE_SIZE.
+ * Use it to place VMs, so each one starts on its own cache line, and VMs running in different threads do not share lines.
+ * The pool is not thread safe.
+ * 
+ * @param pool Pool to be prepared.
+ * @param memory Memory provided by the host.
+ * @param size Size of the memory.
+ * @param block_size Size of each block, such as sizeof(MVE_VM).
+ */
+MVE_API void mve_pool_init(MVE_Pool *pool, void *memory, uint32_t size, uint32_t block_size);
+
+
+/**
+ * @brief Takes a block from the pool.
+ * 
+ * @param pool Pool to take the block from.
+ * @return Returns the block, or NULL if there are no free blocks.
+ */
+MVE_API void *mve_pool_alloc(MVE_Pool *pool);
+
+
+/**
+ * @brief Gives a block back to the pool.
+ * 
+ * @param pool Pool that owns the block.
+ * @param block Block to give back.
+ */
+MVE_API void mve_pool_free(MVE_Pool *pool, void *block);
+
+
+#ifdef MVE_RUNTIME_SIZES
+/**
+ * @brief Prepares an arena to give memory to VMs. The arena never frees, use reset to reuse all of its memory.
+ * 
+ * @param arena Arena to be prepared.
+ * @param memory Memory provided by the host.
+ * @param size Size of the memory.
+ */
+MVE_API void mve_arena_init(MVE_Arena *arena, void *memory, uint32_t size);
+
+
+/**
+ * @brief Gives a chunk of the arena memory, aligned to the pointer size.
+ * 
+ * @param arena Arena to take the memory from.
+ * @param size Amount of bytes.
+ * @return Returns the memory, or NULL if the arena does not have enough space left.
+ */
+MVE_API void *mve_arena_alloc(MVE_Arena *arena, uint32_t size);
+
+
+/**
+ * @brief Makes all the memory of the arena available again. VMs using it must be initiated again.
+ * 
+ * @param arena Arena to reset.
+ */
+MVE_API void mve_arena_reset(MVE_Arena *arena);
+
+
+/**
+ * @brief Sets the sizes of the VM and where its storage is taken from. Must be called before init.
+ * The sizes declared in the header of the program have priority over the ones in the config.
+ * Each init carves new storage from the arena, starting and ending on a cache line, so VMs do not share lines.
+ * 
+ * @param vm VM to configure.
+ * @param config Sizes of the VM. Can be NULL to use the defaults.
+ * @param arena Arena to carve the storage from.
+ */
+MVE_API void mve_configure(MVE_VM *vm, const MVE_Config *config, MVE_Arena *arena);
+#endif
+
+
 #ifdef MVE_LOCAL_PROGRAM
 /**
  * @brief Prepares the VM to run. Loads the header of the program and sets up all the required data.
@@ -301,7 +882,7 @@ struct MVE_VM {
  * @param program Program byte array to execute.
  * @return Returns true if the VM was initiated successfully. False if an error ocurred, such as incompatible byte code.
  */
-MVEbool mve_init(MVE_VM *vm, uint8_t *program);
+MVE_API MVEbool mve_init(MVE_VM *vm, uint8_t *program);
 #else
 /**
  * @brief Prepares the VM to run. Loads the header of the program and sets up all the required data.
@@ -310,7 +891,7 @@ MVEbool mve_init(MVE_VM *vm, uint8_t *program);
  * @param fun_load_next Function that is going to be called whenever the VM needs to load the next bytes (VM, buffer to load into, index in the program, amount to read).
  * @return Returns true if the VM was initiated successfully. False if an error ocurred, such as incompatible byte code.
  */
-MVEbool mve_init(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t));
+MVE_API MVEbool mve_init(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t));
 #endif
 
 /**
@@ -320,7 +901,29 @@ MVEbool mve_init(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, ui
  * @param name Name of the function that is declared in the program.
  * @param function Function to be linked into the VM.
  */
-void mve_link_function(MVE_VM *vm, const char *name, void (* function)(MVE_VM *));
+MVE_API void mve_link_function(MVE_VM *vm, const char *name, void (* function)(MVE_VM *));
+
+
+#ifdef MVE_GROWABLE_SCOPES
+/**
+ * @brief Makes room for at least the given amount of scopes and frames, so a deep recursion does not grow them while running.
+ * They also grow by themselves, doubling when full, up to MVE_SCOPE_MAX and MVE_FRAME_MAX.
+ * 
+ * @param vm VM to grow, after init.
+ * @param scope_limit Amount of scopes needed.
+ * @param frame_limit Amount of frames needed.
+ * @return Returns false if the maximum is exceeded or MVE_REALLOC fails. The scopes and frames are kept as they were.
+ */
+MVE_API MVEbool mve_reserve_scopes(MVE_VM *vm, uint32_t scope_limit, uint32_t frame_limit);
+
+
+/**
+ * @brief Frees the scopes and frames of the VM. Must be called before initiating it again, or once it is no longer used.
+ * 
+ * @param vm VM to release.
+ */
+MVE_API void mve_release(MVE_VM *vm);
+#endif
 
 
 /**
@@ -328,7 +931,7 @@ void mve_link_function(MVE_VM *vm, const char *name, void (* function)(MVE_VM *)
  * 
  * @param vm VM to start.
  */
-void mve_start(MVE_VM *vm);
+MVE_API void mve_start(MVE_VM *vm);
 
 
 /**
@@ -336,7 +939,7 @@ void mve_start(MVE_VM *vm);
  * 
  * @param vm VM to execute the next instruction.
  */
-void mve_run(MVE_VM *vm);
+MVE_API void mve_run(MVE_VM *vm);
 
 
 /**
@@ -344,7 +947,7 @@ void mve_run(MVE_VM *vm);
  * 
  * @param vm The VM to check if is running.
  */
-MVEbool mve_is_running(MVE_VM *vm);
+MVE_API MVEbool mve_is_running(MVE_VM *vm);
 
 
 /**
@@ -352,6 +955,362 @@ MVEbool mve_is_running(MVE_VM *vm);
  * 
  * @param vm VM to start.
  */
-void mve_stop(MVE_VM *vm);
+MVE_API void mve_stop(MVE_VM *vm);
+
+
+#if defined(MVE_PROFILE) || defined(MVE_TRACE)
+/**
+ * @brief Returns the name of an OP, such as "LDI".
+ * 
+ * @param operation The OP.
+ * @return Returns the name, or NULL if the OP does not exist.
+ */
+MVE_API const char *mve_op_name(uint8_t operation);
+#endif
+
+
+#ifdef MVE_PROFILE
+/**
+ * @brief Sets where the VM records the executions and clock ticks of each OP and external function, and resets it.
+ * 
+ * @param vm VM to be profiled.
+ * @param profile Where to record. NULL to stop recording.
+ */
+MVE_API void mve_profile_attach(MVE_VM *vm, MVE_Profile *profile);
+
+
+/**
+ * @brief Returns the profile being recorded by the VM.
+ * 
+ * @param vm VM being profiled.
+ * @return Returns the profile, or NULL if there is none attached.
+ */
+MVE_API const MVE_Profile *mve_profile_get(MVE_VM *vm);
+
+
+/**
+ * @brief Clears all the counters of the profile of the VM.
+ * 
+ * @param vm VM being profiled.
+ */
+MVE_API void mve_profile_reset(MVE_VM *vm);
+
+
+/**
+ * @brief Writes the profile of the VM as JSON. Only the OPs and functions executed at least once are written.
+ * 
+ * @param vm VM being profiled.
+ * @param fun_write Function called with each piece of the JSON text.
+ * @param context Passed to the function.
+ */
+MVE_API void mve_profile_write_json(MVE_VM *vm, MVE_Text_Writer fun_write, void *context);
+#endif
+
+
+#ifdef MVE_TRACE
+/**
+ * @brief Prepares a trace to be attached into a VM.
+ * 
+ * @param trace Trace to be initialized.
+ * @param entries Ring where the executed instructions are recorded.
+ * @param capacity Amount of entries. Rounded down to a power of two.
+ */
+MVE_API void mve_trace_init(MVE_Trace *trace, MVE_Trace_Entry *entries, uint32_t capacity);
+
+
+/**
+ * @brief Sets the trace where the VM records each instruction executed.
+ * 
+ * @param vm VM to be traced.
+ * @param trace Where to record. NULL to stop tracing.
+ */
+MVE_API void mve_trace_attach(MVE_VM *vm, MVE_Trace *trace);
+
+
+/**
+ * @brief Writes the last entries of a trace as text, one instruction per line, with the registers changed by it.
+ * Can be called from MVE_ERROR_LOG, to see what led to an error.
+ * 
+ * @param trace Trace with the entries.
+ * @param last Amount of entries to write, from the newest ones.
+ * @param fun_write Function called with each piece of the text.
+ * @param context Passed to the function.
+ */
+MVE_API void mve_trace_dump(const MVE_Trace *trace, uint32_t last, MVE_Text_Writer fun_write, void *context);
+
+
+/**
+ * @brief Writes the last entries of a trace in the binary format read by tools/trace_decode.
+ * The format is a header with the magic "MVET", the format version as uint16, the amount of registers, operands and bytes of each register as uint8 and the amount of entries as uint32. 
+ * Each entry follows, from the oldest, with the program index as uint32, the OP, the amount of operands read, the operand bytes and the registers. All numbers are little endian.
+ * 
+ * @param trace Trace with the entries.
+ * @param last Amount of entries to write, from the newest ones.
+ * @param fun_write Function called with each piece of the data.
+ * @param context Passed to the function.
+ */
+MVE_API void mve_trace_write_binary(const MVE_Trace *trace, uint32_t last, void (*fun_write)(void *context, const uint8_t *data, uint32_t length), void *context);
+#endif
+
+
+#ifdef MVE_LOADER_STATS
+/**
+ * @brief Returns the counters of the calls to fun_load_next_block made by the VM since init or the last reset.
+ * 
+ * @param vm VM loading the program.
+ * @return Returns the counters.
+ */
+MVE_API const MVE_Loader_Stats *mve_loader_stats_get(MVE_VM *vm);
+
+
+/**
+ * @brief Clears the counters of the calls to fun_load_next_block.
+ * 
+ * @param vm VM loading the program.
+ */
+MVE_API void mve_loader_stats_reset(MVE_VM *vm);
+
+
+/**
+ * @brief Writes the counters of the calls to fun_load_next_block as JSON. The jump sites are sorted by the amount of reloads.
+ * 
+ * @param vm VM loading the program.
+ * @param fun_write Function called with each piece of the JSON text.
+ * @param context Passed to the function.
+ */
+MVE_API void mve_loader_stats_write_json(MVE_VM *vm, MVE_Text_Writer fun_write, void *context);
+#endif
+
+
+#ifdef MVE_TRACK_USAGE
+/**
+ * @brief Returns the highest usage of the stack, memory and scopes, and the blocks of the program loaded, since init or the last reset.
+ * 
+ * @param vm VM being tracked.
+ * @return Returns the usage.
+ */
+MVE_API const MVE_Usage *mve_usage_get(MVE_VM *vm);
+
+
+/**
+ * @brief Clears the usage tracked.
+ * 
+ * @param vm VM being tracked.
+ */
+MVE_API void mve_usage_reset(MVE_VM *vm);
+#endif
+
+
+#ifdef MVE_SAMPLING
+/**
+ * @brief Prepares a sampler to be attached into VMs.
+ * 
+ * @param sampler Sampler to be initialized.
+ * @param samples Ring where the samples are stored.
+ * @param capacity Amount of samples in the ring.
+ * @param interval Take a sample every this amount of instructions. 0 to only sample when requested, such as from a timer.
+ */
+MVE_API void mve_sampler_init(MVE_Sampler *sampler, MVE_Sample *samples, uint32_t capacity, uint32_t interval);
+
+
+/**
+ * @brief Sets the sampler where the VM records its call stacks.
+ * 
+ * @param vm VM to be sampled.
+ * @param sampler Where to record. NULL to stop sampling.
+ */
+MVE_API void mve_sampler_attach(MVE_VM *vm, MVE_Sampler *sampler);
+
+
+/**
+ * @brief Requests a sample to be taken before the next instruction. Can be called from a timer interrupt.
+ * 
+ * @param sampler Sampler attached into the VM.
+ */
+MVE_API void mve_sampler_request(MVE_Sampler *sampler);
+
+
+/**
+ * @brief Writes the samples in the folded stacks format, one line per distinct call stack with the amount of samples, as used by flame graph tools.
+ * The lines are sorted by call stack.
+ * 
+ * @param sampler Sampler with the samples.
+ * @param symbols Symbols sorted by start, used to name the frames. NULL to name them by program index.
+ * @param symbols_count Amount of symbols.
+ * @param scratch Room for the capacity of the sampler, where the samples are copied and sorted, so equal call stacks are counted together.
+ * @param fun_write Function called with each piece of the text.
+ * @param context Passed to the function.
+ */
+MVE_API void mve_sampler_write_folded(const MVE_Sampler *sampler, const MVE_Symbol *symbols, uint32_t symbols_count, MVE_Sample *scratch, MVE_Text_Writer fun_write, void *context);
+#endif
+
+
+#ifdef MVE_USE_CHANNELS
+/**
+ * @brief Prepares a channel to be used. A channel is a bounded lock-free ring used to exchange messages between VMs.
+ * Many VMs can send through the same channel if it is multi producer, but only one can receive from it.
+ * 
+ * @param channel Channel to be prepared.
+ * @param slots Storage for the messages of the channel.
+ * @param capacity Amount of slots. Rounded down to a power of two, so only that many slots are used. At least 2.
+ * @param multi_producer True if more than one VM or thread can send through the channel at the same time.
+ * @return Returns false if the capacity is lower than 2, and the channel cannot be used.
+ */
+MVE_API MVEbool mve_channel_init(MVE_Channel *channel, MVE_Channel_Slot *slots, uint32_t capacity, MVEbool multi_producer);
+
+
+/**
+ * @brief Sends a message through a channel from the host. It does not block.
+ * 
+ * @param channel Channel to send the message.
+ * @param data Bytes of the message.
+ * @param length Amount of bytes. Cannot be bigger than MVE_CHANNEL_MESSAGE_SIZE.
+ * @return Returns true if the message was sent. False if the channel is full.
+ */
+MVE_API MVEbool mve_channel_send(MVE_Channel *channel, const uint8_t *data, uint32_t length);
+
+
+/**
+ * @brief Receives a message from a channel into the host. It does not block.
+ * 
+ * @param channel Channel to receive the message from.
+ * @param data Buffer to copy the message into, with at least MVE_CHANNEL_MESSAGE_SIZE bytes.
+ * @param length Receives the amount of bytes of the message.
+ * @return Returns true if a message was received. False if the channel is empty.
+ */
+MVE_API MVEbool mve_channel_receive(MVE_Channel *channel, uint8_t *data, uint32_t *length);
+
+
+/**
+ * @brief Links a channel into the VM, so it can be used by the program with SEND and RECV.
+ * 
+ * @param vm VM to link the channel.
+ * @param index Index used by the program to refer the channel.
+ * @param channel Channel to be linked.
+ */
+MVE_API void mve_link_channel(MVE_VM *vm, uint8_t index, MVE_Channel *channel);
+
+
+/**
+ * @brief Indicates whether the VM is blocked on a channel.
+ * A blocked VM retries the instruction on the next run, so a scheduler can park it until the channel wakes it.
+ * 
+ * @param vm The VM to check if is parked.
+ */
+MVE_API MVEbool mve_is_parked(MVE_VM *vm);
+#endif
+
+
+#ifdef MVE_USE_REGIONS
+/**
+ * @brief Links host memory into the VM as a region, so the program reads it with LDX, and writes it with STX if it is writable, without copying it.
+ * The bytes must stay valid while they are linked.
+ * 
+ * @param vm VM to link the region.
+ * @param index Index used by the program to refer the region.
+ * @param data The bytes of the region. NULL to unlink the region.
+ * @param length Amount of bytes of the region.
+ * @param writable If the program can write into the region.
+ */
+MVE_API void mve_link_region(MVE_VM *vm, uint8_t index, void *data, uint32_t length, MVEbool writable);
+#endif
+
+
+#ifdef MVE_USE_EXPORTS
+/**
+ * @brief Finds a function exported by the program, by its name.
+ * 
+ * @param vm VM with the program.
+ * @param name Name of the function, as declared in the MVE_HEADER_EXPORTS section.
+ * @return Returns the index of the export, or exports_count if the program does not export it.
+ * Only a 32 bit FNV-1a hash of each name is kept, so a name that is not in the program can still match an export with the same hash.
+ * The exports of a program never share a hash, since mve_init rejects them.
+ */
+MVE_API uint16_t mve_find_export(MVE_VM *vm, const char *name);
+
+/**
+ * @brief Calls a function exported by the program, as a FCALL from where the VM is, and runs it until it returns with RET.
+ * The registers are given back when it ends, so a program paused between mve_run calls continues as before. Must be called after mve_start.
+ * 
+ * @param vm VM to call the function.
+ * @param index Index of the export, from mve_find_export.
+ * @param args Values of the first registers, from r0. Can be NULL without arguments.
+ * @param args_count Amount of arguments, up to 5.
+ * @param budget Maximum amount of instructions to run. 0 to run until the function returns.
+ * @param result Receives r0 when the function returns. Can be NULL.
+ * @return Returns true if the function returned. False if the budget was reached or the VM blocked on a channel, and mve_resume_export continues it,
+ * or if it stopped without returning, as with EOP.
+ */
+MVE_API MVEbool mve_call_export(MVE_VM *vm, uint16_t index, const MVE_Value *args, uint8_t args_count, uint32_t budget, MVE_Value *result);
+
+/**
+ * @brief Continues an export that reached its budget or blocked on a channel.
+ * 
+ * @param vm VM running the export.
+ * @param budget Maximum amount of instructions to run. 0 to run until the function returns.
+ * @param result Receives r0 when the function returns. Can be NULL.
+ * @return Returns the same as mve_call_export.
+ */
+MVE_API MVEbool mve_resume_export(MVE_VM *vm, uint32_t budget, MVE_Value *result);
+
+/**
+ * @brief Returns true if an export was called and did not end yet.
+ */
+MVE_API MVEbool mve_is_export_pending(MVE_VM *vm);
+#endif
+
+
+#ifdef MVE_USE_IMAGES
+/**
+ * @brief Hashes the bytes of a program with FNV-1a 64, to identify it in an image.
+ * 
+ * @param bytes Bytes of the program.
+ * @param length Amount of bytes.
+ * @return Returns the hash.
+ */
+MVE_API uint64_t mve_image_hash(const uint8_t *bytes, uint32_t length);
+
+/**
+ * @brief Returns the fingerprint of the build of the VM: the bytecode and image versions, the size of the values, the limits and the macros
+ * that change how a program is loaded. Images written by a build with another fingerprint are rejected.
+ */
+MVE_API uint64_t mve_image_config(void);
+
+/**
+ * @brief Returns the amount of bytes the image of the loaded program needs.
+ * 
+ * @param vm VM right after mve_init.
+ */
+MVE_API uint32_t mve_image_size(MVE_VM *vm);
+
+/**
+ * @brief Writes the image of the loaded program. Must be called right after a successful mve_init, before linking functions or starting the VM.
+ * 
+ * @param vm VM right after mve_init.
+ * @param program_hash Hash of the program, checked when the image is loaded.
+ * @param image Where to write the image.
+ * @param capacity Amount of bytes available in image.
+ * @return Returns the amount of bytes written, or 0 if the capacity is not enough.
+ */
+MVE_API uint32_t mve_image_write(MVE_VM *vm, uint64_t program_hash, void *image, uint32_t capacity);
+
+/**
+ * @brief Initiates the VM from an image, instead of loading the header of the program. The result is the same as mve_init,
+ * but the sections, the function names and the main scope are copied from the image, and the program is only read from its first instruction.
+ * The image is checked before the VM is changed, so a rejected image can be followed by mve_init. Its contents are trusted like the program.
+ * 
+ * @param vm VM to initiate. Must be configured as for mve_init.
+ * @param program The program, as for mve_init. In streaming mode, the function that loads the blocks of the program.
+ * @param program_hash Hash of the program, that must be the same as the one of the image.
+ * @param image The image, from mve_image_write. It is not used after the call.
+ * @param size Amount of bytes of the image.
+ * @return Returns false if the image is not valid for the program and the build of the VM, or if it does not fit in the VM.
+ */
+#ifdef MVE_LOCAL_PROGRAM
+MVE_API MVEbool mve_image_load(MVE_VM *vm, uint8_t *program, uint64_t program_hash, const void *image, uint32_t size);
+#else
+MVE_API MVEbool mve_image_load(MVE_VM *vm, void (*fun_load_next_block)(MVE_VM *, uint8_t *, uint32_t, uint32_t), uint64_t program_hash, const void *image, uint32_t size);
+#endif
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,630 @@
+#ifndef MVE_AOT_H
+#define MVE_AOT_H
+
+/**
+ * Runtime of the programs compiled ahead of time into C, by tools/aot.
+ * Each instruction of the program becomes a call to one of these functions, with its operands as constants,
+ * so the compiler of the host can inline and optimize them. They do the same as the instructions of mve.c,
+ * on the same MVE_VM state, and fail with the same errors, reported with the program index of the instruction.
+ *
+ * The compiled program runs on a VM initialized by mve_init and started by mve_start, so the header, the external functions and the
+ * main scope are loaded as usual. MVE_AOT_STEP can be defined to run code before each instruction, like comparing with the interpreter.
+ */
+
+#include <string.h>
+
+#include "mve.h"
+#include "mve_bytes.h"
+
+
+#ifndef MVE_AOT_STEP
+#define MVE_AOT_STEP(vm, program_index)
+#endif
+
+
+#ifdef MVE_ERROR_LOG
+#define MVE_AOT_ASSERT(x, vm, program_index, error_id, msg) if (!(x)) { MVE_ERROR_LOG(vm, program_index, error_id, "Error " STR(error_id) ": "  msg); while(1) {} }
+#else
+#define MVE_AOT_ASSERT(x, vm, program_index, error_id, msg) (void)(program_index)
+#endif
+
+#define MVE_AOT_ASSERT_REGISTER(reg, msg, vm, program_index) MVE_AOT_ASSERT(reg < MVE_REGISTERS_SIZE, vm, program_index, MVE_ERROR_REGISTER_OUT_OF_RANGE, msg " Invalid register. The register cannot be negative or bigger than MVE_REGISTERS_SIZE.")
+#define MVE_AOT_ASSERT_STACK_ADDRESS(address, msg, vm, program_index) MVE_AOT_ASSERT(address < MVE_VM_STACK_SIZE(vm), vm, program_index, MVE_ERROR_STACK_OUT_OF_RANGE, msg " Stack address out of range. The address cannot be negative or bigger than MVE_STACK_SIZE.")
+#define MVE_AOT_ASSERT_STACK_RANGE(address, length, msg, vm, program_index) MVE_AOT_ASSERT(address <= MVE_VM_STACK_SIZE(vm) && length <= MVE_VM_STACK_SIZE(vm) - address, vm, program_index, MVE_ERROR_STACK_OUT_OF_RANGE, msg " Stack range out of range. The bytes cannot go past the end of the stack.")
+#define MVE_AOT_ASSERT_MEMORY_ADDRESS(address, msg, vm, program_index) MVE_AOT_ASSERT(address < MVE_VM_MEMORY_SIZE(vm), vm, program_index, MVE_ERROR_MEMORY_OUT_OF_RANGE, msg " Memory address out of range. The address cannot be negative or bigger than MVE_MEMORY_SIZE.")
+
+
+/**
+ * @brief Returns the stack address of an operand. Negative addresses are relative to the end of the stack.
+ */
+static inline uint32_t mve_aot_stack_address(MVE_VM *vm, int32_t stack_address)
+{
+    return stack_address < 0 ? STACK_POINTER(vm) - (-stack_address) : (uint32_t) stack_address;
+}
+
+
+static inline MVE_Value mve_aot_read(const uint8_t *source, uint32_t length)
+{
+    MVE_Value value;
+    value.i = 0;
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[length - i - 1] = source[i];
+        #else
+            value.b[i] = source[i];
+        #endif
+    }
+
+    return value;
+}
+
+
+static inline void mve_aot_write(uint8_t *destination, const MVE_Value *value, uint32_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            destination[i] = value->b[length - i - 1];
+        #else
+            destination[i] = value->b[i];
+        #endif
+    }
+}
+
+
+static inline void mve_aot_ldr(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LDR failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "LDR failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "LDR failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index].i);
+
+    vm->registers.all[reg] = mve_aot_read(vm->stack + address, vm->registers.all[reg_length].i);
+}
+
+
+static inline void mve_aot_str(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "STR failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "STR failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "STR failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index].i);
+
+    mve_aot_write(vm->stack + address, &vm->registers.all[reg], vm->registers.all[reg_length].i);
+}
+
+
+static inline void mve_aot_lds(MVE_VM *vm, uint32_t program_index, uint8_t reg, int32_t stack_address, uint8_t length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LDS failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, stack_address);
+
+    MVE_AOT_ASSERT_STACK_ADDRESS(address, "LDS failed!", vm, program_index);
+    MVE_AOT_ASSERT_STACK_ADDRESS(address + length, "LDS failed!", vm, program_index);
+
+    vm->registers.all[reg] = mve_aot_read(vm->stack + address, length);
+}
+
+
+static inline void mve_aot_sts(MVE_VM *vm, uint32_t program_index, uint8_t reg, int32_t stack_address, uint8_t length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "STS failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, stack_address);
+
+    MVE_AOT_ASSERT_STACK_ADDRESS(address, "STS failed!", vm, program_index);
+    MVE_AOT_ASSERT_STACK_ADDRESS(address + length, "STS failed!", vm, program_index);
+
+    mve_aot_write(vm->stack + address, &vm->registers.all[reg], length);
+}
+
+
+/**
+ * @brief Loads an immediate. The value was already read from its bytes, so it does not depend on the endianness.
+ */
+static inline void mve_aot_ldi(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint64_t value)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LDI failed!", vm, program_index);
+
+    vm->registers.all[reg].i = value;
+}
+
+
+#define MVE_AOT_BINARY(name, text, operator) \
+static inline void mve_aot_##name(MVE_VM *vm, uint32_t program_index, uint8_t reg_result, uint8_t reg_op1, uint8_t reg_op2) \
+{ \
+    MVE_AOT_ASSERT_REGISTER(reg_result, text " failed!", vm, program_index); \
+    MVE_AOT_ASSERT_REGISTER(reg_op1, text " failed!", vm, program_index); \
+    MVE_AOT_ASSERT_REGISTER(reg_op2, text " failed!", vm, program_index); \
+    vm->registers.all[reg_result].i = vm->registers.all[reg_op1].i operator vm->registers.all[reg_op2].i; \
+}
+
+MVE_AOT_BINARY(add, "ADD", +)
+MVE_AOT_BINARY(sub, "SUB", -)
+MVE_AOT_BINARY(mul, "MUL", *)
+MVE_AOT_BINARY(div, "DIV", /)
+MVE_AOT_BINARY(and, "AND", &)
+MVE_AOT_BINARY(orr, "ORR", |)
+MVE_AOT_BINARY(xor, "XOR", ^)
+MVE_AOT_BINARY(lsl, "LSL", <<)
+MVE_AOT_BINARY(lsr, "LSR", >>)
+
+
+static inline void mve_aot_mov(MVE_VM *vm, uint32_t program_index, uint8_t reg_to, uint8_t reg_from)
+{
+    MVE_AOT_ASSERT_REGISTER(reg_to, "MOV failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_from, "MOV failed!", vm, program_index);
+
+    vm->registers.all[reg_to].i = vm->registers.all[reg_from].i;
+}
+
+
+static inline void mve_aot_not(MVE_VM *vm, uint32_t program_index, uint8_t reg_result, uint8_t reg_op1)
+{
+    MVE_AOT_ASSERT_REGISTER(reg_result, "NOT failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_op1, "NOT failed!", vm, program_index);
+
+    vm->registers.all[reg_result].i = ~vm->registers.all[reg_op1].i;
+}
+
+
+static inline void mve_aot_neg(MVE_VM *vm, uint32_t program_index, uint8_t reg)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "NEG failed!", vm, program_index);
+
+    vm->registers.all[reg].i = -vm->registers.all[reg].i;
+}
+
+
+static inline void mve_aot_inc(MVE_VM *vm, uint32_t program_index, uint8_t reg)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "INC failed!", vm, program_index);
+
+    vm->registers.all[reg].i++;
+}
+
+
+static inline void mve_aot_dec(MVE_VM *vm, uint32_t program_index, uint8_t reg)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "DEC failed!", vm, program_index);
+
+    vm->registers.all[reg].i--;
+}
+
+
+static inline void mve_aot_cmp(MVE_VM *vm, uint32_t program_index, uint8_t operation, uint8_t reg_result, uint8_t reg_op1, uint8_t reg_op2)
+{
+    MVE_AOT_ASSERT(operation <= MVE_CMP_LESSEQUAL, vm, program_index, MVE_ERROR_UNRECOGNIZED_CMP_OPERATION, "CMP failed! Unrecognized compare operation.");
+    MVE_AOT_ASSERT_REGISTER(reg_result, "CMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_op1, "CMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_op2, "CMP failed!", vm, program_index);
+
+    MVE_Value *all = vm->registers.all;
+
+    switch (operation)
+    {
+    case MVE_CMP_EQUAL:
+        all[reg_result].i = all[reg_op1].i == all[reg_op2].i;
+        break;
+    case MVE_CMP_NOTEQUAL:
+        all[reg_result].i = all[reg_op1].i != all[reg_op2].i;
+        break;
+    case MVE_CMP_GREATER:
+        all[reg_result].i = all[reg_op1].i > all[reg_op2].i;
+        break;
+    case MVE_CMP_LESS:
+        all[reg_result].i = all[reg_op1].i < all[reg_op2].i;
+        break;
+    case MVE_CMP_GREATEREQUAL:
+        all[reg_result].i = all[reg_op1].i >= all[reg_op2].i;
+        break;
+    case MVE_CMP_LESSEQUAL:
+        all[reg_result].i = all[reg_op1].i <= all[reg_op2].i;
+        break;
+    default:
+        break;
+    }
+}
+
+
+/**
+ * @brief Calls an external function.
+ *
+ * @return Returns false if the function stopped the VM.
+ */
+static inline MVEbool mve_aot_invoke(MVE_VM *vm, uint32_t program_index, uint16_t function_index)
+{
+    MVE_AOT_ASSERT(vm->external_functions_count > function_index, vm, program_index, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Invalid function index.");
+
+    void (*func) (MVE_VM *) = (void (*)(MVE_VM *)) vm->external_functions[function_index];
+
+    MVE_AOT_ASSERT(func != NULL, vm, program_index, MVE_ERROR_EXTERNAL_FUNCTION_OUT_OF_RANGE, "INVOKE failed! Function was not linked into the VM.");
+
+    func(vm);
+
+    return vm->is_running;
+}
+
+
+/**
+ * @brief Starts a scope, with its initial bytes and the zero filled ones.
+ */
+static inline void mve_aot_scope(MVE_VM *vm, uint32_t program_index, const uint8_t *data, uint32_t length, uint32_t zero_length)
+{
+    MVE_GROW_SCOPES(vm);
+    MVE_AOT_ASSERT(vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm), vm, program_index, MVE_ERROR_SCOPE_OUT_OF_RANGE, "SCOPE failed! There cannot be no more scopes than MVE_SCOPE_LIMIT.");
+
+    vm->scope_index++;
+    vm->scopes[vm->scope_index].stack_base = STACK_POINTER(vm);
+
+    MVE_AOT_ASSERT_STACK_ADDRESS(length + zero_length + STACK_POINTER(vm), "Error loading scope memory.", vm, program_index);
+
+    memcpy(vm->stack + STACK_POINTER(vm), data, length);
+    STACK_POINTER(vm) += length;
+
+    memset(vm->stack + STACK_POINTER(vm), 0, zero_length);
+    STACK_POINTER(vm) += zero_length;
+}
+
+
+/**
+ * @brief Ends a scope.
+ *
+ * @return Returns the program index to go back to, if the scope was called, or 0 to continue.
+ */
+static inline uint32_t mve_aot_end(MVE_VM *vm, uint32_t program_index)
+{
+    // Like END in mve.c, which cannot fail since the scope index is unsigned.
+    (void) program_index;
+
+    STACK_POINTER(vm) = vm->scopes[vm->scope_index].stack_base;
+
+    uint32_t return_index = vm->scopes[vm->scope_index].program_index;
+
+    vm->scopes[vm->scope_index].program_index = 0;
+    vm->scope_index--;
+
+    return return_index;
+}
+
+
+/**
+ * @brief Sets where the next scope goes back to, like CALL. The jump is done by the compiled code.
+ *
+ * @param return_index Program index after the CALL.
+ */
+static inline void mve_aot_call(MVE_VM *vm, uint32_t program_index, uint32_t return_index)
+{
+    MVE_GROW_SCOPES(vm);
+    MVE_AOT_ASSERT(vm->scope_index + 1 < MVE_VM_SCOPE_LIMIT(vm), vm, program_index, MVE_ERROR_SCOPE_LIMIT_REACHED, "CALL failed! Cannot have more scopes than MVE_SCOPE_LIMIT.");
+
+    vm->scopes[vm->scope_index + 1].program_index = return_index;
+}
+
+
+/**
+ * @brief Pushes a frame to go back to, like FCALL. The jump is done by the compiled code.
+ *
+ * @param return_index Program index after the FCALL.
+ */
+static inline void mve_aot_fcall(MVE_VM *vm, uint32_t program_index, uint32_t return_index)
+{
+    MVE_GROW_FRAMES(vm);
+    MVE_AOT_ASSERT(vm->frame_index < MVE_VM_FRAME_LIMIT(vm), vm, program_index, MVE_ERROR_FRAME_LIMIT_REACHED, "FCALL failed! Cannot have more frames than MVE_FRAME_LIMIT.");
+
+    MVE_Frame *frame = &vm->frames[vm->frame_index++];
+
+    frame->return_index = return_index;
+    frame->scope_index = vm->scope_index;
+}
+
+
+/**
+ * @brief Ends the scopes created after a frame, like mve_unwind_frame in mve.c.
+ */
+static inline void mve_aot_unwind_frame(MVE_VM *vm, const MVE_Frame *frame)
+{
+    if (vm->scope_index == frame->scope_index)
+        return;
+
+    STACK_POINTER(vm) = vm->scopes[frame->scope_index + 1].stack_base;
+
+    for (uint32_t i = frame->scope_index + 1; i <= vm->scope_index; i++)
+        vm->scopes[i].program_index = 0;
+
+    vm->scope_index = frame->scope_index;
+}
+
+
+/**
+ * @brief Pops the last frame, like RET.
+ *
+ * @return Returns the program index to go back to.
+ */
+static inline uint32_t mve_aot_ret(MVE_VM *vm, uint32_t program_index)
+{
+    MVE_AOT_ASSERT(vm->frame_index > 0, vm, program_index, MVE_ERROR_FRAME_OUT_OF_RANGE, "RET failed! There is no frame to return from.");
+
+    MVE_Frame *frame = &vm->frames[--vm->frame_index];
+
+    mve_aot_unwind_frame(vm, frame);
+
+    return frame->return_index;
+}
+
+
+/**
+ * @brief Ends the scopes of the last frame, keeping it, like TCALL. The jump is done by the compiled code.
+ */
+static inline void mve_aot_tcall(MVE_VM *vm, uint32_t program_index)
+{
+    MVE_AOT_ASSERT(vm->frame_index > 0, vm, program_index, MVE_ERROR_FRAME_OUT_OF_RANGE, "TCALL failed! There is no frame to reuse.");
+
+    mve_aot_unwind_frame(vm, &vm->frames[vm->frame_index - 1]);
+}
+
+
+/**
+ * @brief Decrements a register, like LOOP.
+ *
+ * @return Returns if the loop jumps, when the register is not 0.
+ */
+static inline MVEbool mve_aot_loop(MVE_VM *vm, uint32_t program_index, uint8_t reg)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LOOP failed!", vm, program_index);
+
+    return --vm->registers.all[reg].i != 0;
+}
+
+
+/**
+ * @brief Returns the value of the register of SWITCH. The table is a switch in the compiled code.
+ */
+static inline MVE_Value mve_aot_switch(MVE_VM *vm, uint32_t program_index, uint8_t reg)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "SWITCH failed!", vm, program_index);
+
+    return vm->registers.all[reg];
+}
+
+
+static inline void mve_aot_push(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "PUSH failed!", vm, program_index);
+    MVE_AOT_ASSERT_MEMORY_ADDRESS(length + MEMORY_POINTER(vm), "PUSH failed!", vm, program_index);
+
+    mve_aot_write(vm->memory + MEMORY_POINTER(vm), &vm->registers.all[reg], length);
+
+    MEMORY_POINTER(vm) += length;
+}
+
+
+static inline void mve_aot_pop(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "POP failed!", vm, program_index);
+    MVE_AOT_ASSERT_MEMORY_ADDRESS(MEMORY_POINTER(vm) - length, "POP failed!", vm, program_index);
+
+    uint8_t clamped_length = length < MVE_BASE_TYPE_SIZE ? length : MVE_BASE_TYPE_SIZE;
+    MVE_Value value;
+    value.i = 0;
+
+    for (uint8_t i = 0; i < clamped_length; i++)
+    {
+        #ifdef MVE_BIG_ENDIAN
+            value.b[i] = vm->memory[MEMORY_POINTER(vm) - i - 1];
+        #else
+            value.b[clamped_length - i - 1] = vm->memory[MEMORY_POINTER(vm) - i - 1];
+        #endif
+    }
+
+    MEMORY_POINTER(vm) -= length;
+    vm->registers.all[reg] = value;
+}
+
+
+static inline void mve_aot_pushm(MVE_VM *vm, uint32_t program_index, uint16_t mask, uint8_t length)
+{
+    MVE_AOT_ASSERT((mask & ~MVE_REGISTERS_MASK) == 0, vm, program_index, MVE_ERROR_REGISTER_OUT_OF_RANGE, "PUSHM failed! Invalid register mask. The mask cannot have registers bigger than MVE_REGISTERS_SIZE.");
+    MVE_AOT_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, program_index, MVE_ERROR_INVALID_LENGTH, "PUSHM failed! The length cannot be bigger than the size of a register.");
+
+    mask &= MVE_REGISTERS_MASK;
+
+    uint8_t count = 0;
+
+    for (uint16_t bits = mask; bits != 0; bits &= bits - 1)
+        count++;
+
+    MVE_AOT_ASSERT_MEMORY_ADDRESS(count * length + MEMORY_POINTER(vm), "PUSHM failed!", vm, program_index);
+
+    uint8_t *memory = vm->memory + MEMORY_POINTER(vm);
+
+    for (uint8_t reg = 0; reg < MVE_REGISTERS_MASK_SIZE; reg++)
+    {
+        if (!(mask & (1u << reg)))
+            continue;
+
+        mve_aot_write(memory, &vm->registers.all[reg], length);
+        memory += length;
+    }
+
+    MEMORY_POINTER(vm) = memory - vm->memory;
+}
+
+
+static inline void mve_aot_popm(MVE_VM *vm, uint32_t program_index, uint16_t mask, uint8_t length)
+{
+    MVE_AOT_ASSERT((mask & ~MVE_REGISTERS_MASK) == 0, vm, program_index, MVE_ERROR_REGISTER_OUT_OF_RANGE, "POPM failed! Invalid register mask. The mask cannot have registers bigger than MVE_REGISTERS_SIZE.");
+    MVE_AOT_ASSERT(!(mask & (1u << MVE_REGISTER_MP)), vm, program_index, MVE_ERROR_REGISTER_OUT_OF_RANGE, "POPM failed! The memory pointer cannot be popped.");
+    MVE_AOT_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, program_index, MVE_ERROR_INVALID_LENGTH, "POPM failed! The length cannot be bigger than the size of a register.");
+
+    mask &= MVE_REGISTERS_MASK & ~(1u << MVE_REGISTER_MP);
+
+    uint8_t count = 0;
+
+    for (uint16_t bits = mask; bits != 0; bits &= bits - 1)
+        count++;
+
+    MVE_AOT_ASSERT_MEMORY_ADDRESS(MEMORY_POINTER(vm) - count * length, "POPM failed!", vm, program_index);
+
+    uint8_t *memory = vm->memory + MEMORY_POINTER(vm);
+
+    for (int8_t reg = MVE_REGISTERS_MASK_SIZE - 1; reg >= 0; reg--)
+    {
+        if (!(mask & (1u << reg)))
+            continue;
+
+        memory -= length;
+        vm->registers.all[reg] = mve_aot_read(memory, length);
+    }
+
+    MEMORY_POINTER(vm) = memory - vm->memory;
+}
+
+
+static inline void mve_aot_ladr(MVE_VM *vm, uint32_t program_index, uint8_t reg, int32_t stack_address)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LADR failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, stack_address);
+
+    MVE_AOT_ASSERT_STACK_ADDRESS(address, "LADR failed!", vm, program_index);
+
+    vm->registers.all[reg].i = address;
+}
+
+
+static inline void mve_aot_strlen(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "STRLEN failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "STRLEN failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index].i);
+
+    MVE_AOT_ASSERT_STACK_ADDRESS(address, "STRLEN failed!", vm, program_index);
+
+    vm->registers.all[reg].i = mve_bytes_find(vm->stack + address, MVE_VM_STACK_SIZE(vm) - address, 0);
+}
+
+
+static inline void mve_aot_findbyte(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index, uint8_t reg_length, uint8_t reg_value)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "FINDBYTE failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "FINDBYTE failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "FINDBYTE failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_value, "FINDBYTE failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index].i);
+    uint32_t length = (uint32_t) vm->registers.all[reg_length].i;
+
+    MVE_AOT_ASSERT_STACK_RANGE(address, length, "FINDBYTE failed!", vm, program_index);
+
+    vm->registers.all[reg].i = mve_bytes_find(vm->stack + address, length, (uint8_t) vm->registers.all[reg_value].i);
+}
+
+
+static inline void mve_aot_memcmp(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index1, uint8_t reg_index2, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "MEMCMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index1, "MEMCMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index2, "MEMCMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "MEMCMP failed!", vm, program_index);
+
+    uint32_t address1 = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index1].i);
+    uint32_t address2 = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index2].i);
+    uint32_t length = (uint32_t) vm->registers.all[reg_length].i;
+
+    MVE_AOT_ASSERT_STACK_RANGE(address1, length, "MEMCMP failed!", vm, program_index);
+    MVE_AOT_ASSERT_STACK_RANGE(address2, length, "MEMCMP failed!", vm, program_index);
+
+    uint32_t mismatch = mve_bytes_mismatch(vm->stack + address1, vm->stack + address2, length);
+
+    vm->registers.all[reg].i = mismatch < length ? mismatch + 1 : 0;
+}
+
+
+static inline void mve_aot_crc32c(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t reg_index, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "CRC32C failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "CRC32C failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "CRC32C failed!", vm, program_index);
+
+    uint32_t address = mve_aot_stack_address(vm, (int32_t) vm->registers.all[reg_index].i);
+    uint32_t length = (uint32_t) vm->registers.all[reg_length].i;
+
+    MVE_AOT_ASSERT_STACK_RANGE(address, length, "CRC32C failed!", vm, program_index);
+
+    vm->registers.all[reg].i = mve_bytes_crc32c((uint32_t) vm->registers.all[reg].i, vm->stack + address, length);
+}
+
+
+
+#ifdef MVE_USE_REGIONS
+static inline MVE_Region *mve_aot_region(MVE_VM *vm, uint32_t program_index, uint8_t index)
+{
+    MVE_AOT_ASSERT(index < MVE_REGIONS_LIMIT && vm->regions[index].data != NULL, vm, program_index, MVE_ERROR_REGION_OUT_OF_RANGE, "Region failed! The region was not linked into the VM.");
+
+    return &vm->regions[index];
+}
+
+
+static inline void mve_aot_ldx(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t region_index, uint8_t reg_index, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "LDX failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "LDX failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "LDX failed!", vm, program_index);
+
+    MVE_Region *region = mve_aot_region(vm, program_index, region_index);
+
+    uint32_t address = (uint32_t) vm->registers.all[reg_index].i;
+    uint32_t length = (uint32_t) vm->registers.all[reg_length].i;
+
+    MVE_AOT_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, program_index, MVE_ERROR_INVALID_LENGTH, "LDX failed! The length cannot be bigger than the size of a register.");
+    MVE_AOT_ASSERT(address <= region->length && length <= region->length - address, vm, program_index, MVE_ERROR_REGION_ADDRESS_OUT_OF_RANGE, "LDX failed! The bytes cannot go past the end of the region.");
+
+    vm->registers.all[reg] = mve_aot_read(region->data + address, length);
+}
+
+
+static inline void mve_aot_stx(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t region_index, uint8_t reg_index, uint8_t reg_length)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "STX failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_index, "STX failed!", vm, program_index);
+    MVE_AOT_ASSERT_REGISTER(reg_length, "STX failed!", vm, program_index);
+
+    MVE_Region *region = mve_aot_region(vm, program_index, region_index);
+
+    uint32_t address = (uint32_t) vm->registers.all[reg_index].i;
+    uint32_t length = (uint32_t) vm->registers.all[reg_length].i;
+
+    MVE_AOT_ASSERT(region->writable, vm, program_index, MVE_ERROR_REGION_READ_ONLY, "STX failed! The region was linked as read only.");
+    MVE_AOT_ASSERT(length <= MVE_BASE_TYPE_SIZE, vm, program_index, MVE_ERROR_INVALID_LENGTH, "STX failed! The length cannot be bigger than the size of a register.");
+    MVE_AOT_ASSERT(address <= region->length && length <= region->length - address, vm, program_index, MVE_ERROR_REGION_ADDRESS_OUT_OF_RANGE, "STX failed! The bytes cannot go past the end of the region.");
+
+    mve_aot_write(region->data + address, &vm->registers.all[reg], length);
+}
+
+
+static inline void mve_aot_xlen(MVE_VM *vm, uint32_t program_index, uint8_t reg, uint8_t region_index)
+{
+    MVE_AOT_ASSERT_REGISTER(reg, "XLEN failed!", vm, program_index);
+
+    if (region_index < MVE_REGIONS_LIMIT && vm->regions[region_index].data != NULL)
+        vm->registers.all[reg].i = vm->regions[region_index].length;
+    else
+        vm->registers.all[reg].i = 0;
+}
+#endif
+
+
+static inline void mve_aot_undefined(MVE_VM *vm, uint32_t program_index)
+{
+    MVE_AOT_ASSERT(MVE_FALSE, vm, program_index, MVE_ERROR_UNDEFINED_OP, "Undefined instruction! Code does not exist.");
+    mve_stop(vm);
+}
+
+#endif
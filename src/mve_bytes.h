@@ -0,0 +1,194 @@
+#ifndef MVE_BYTES_H
+#define MVE_BYTES_H
+
+/**
+ * Kernels of the instructions over stack bytes, STRLEN, FINDBYTE, MEMCMP and CRC32C, shared by mve.c and src/mve_aot.h.
+ * They only see plain byte ranges, so the instructions check the stack bounds once, before calling them.
+ *
+ * Each kernel has a scalar version, and uses AVX2, SSE2 or NEON for the blocks of 32 or 16 bytes when the compiler targets them,
+ * with the rest done by the scalar version. CRC32C uses the SSE4.2 or ARMv8 CRC instructions if available.
+ * Define MVE_BYTES_SCALAR to always use the scalar versions.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(MVE_BYTES_SCALAR) && defined(__GNUC__)
+
+#if defined(__AVX2__)
+#define MVE_BYTES_AVX2
+#endif
+
+#if defined(__SSE2__)
+#define MVE_BYTES_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define MVE_BYTES_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(MVE_BYTES_AVX2)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE4_2__)
+#define MVE_BYTES_CRC_SSE42
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MVE_BYTES_CRC_ARM
+#include <arm_acle.h>
+#endif
+
+#endif
+
+
+/**
+ * @brief Returns the index of the first byte with a value, or length if there is none.
+ */
+static inline uint32_t mve_bytes_find(const uint8_t *bytes, uint32_t length, uint8_t value)
+{
+    uint32_t i = 0;
+
+#ifdef MVE_BYTES_AVX2
+    __m256i needle32 = _mm256_set1_epi8((char) value);
+
+    for (; i + 32 <= length; i += 32) {
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (bytes + i)), needle32));
+
+        if (mask != 0)
+            return i + (uint32_t) __builtin_ctz(mask);
+    }
+#endif
+
+#if defined(MVE_BYTES_SSE2)
+    __m128i needle = _mm_set1_epi8((char) value);
+
+    for (; i + 16 <= length; i += 16) {
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (bytes + i)), needle));
+
+        if (mask != 0)
+            return i + (uint32_t) __builtin_ctz(mask);
+    }
+#elif defined(MVE_BYTES_NEON)
+    uint8x16_t needle = vdupq_n_u8(value);
+
+    for (; i + 16 <= length; i += 16) {
+        // Each byte compared becomes 4 bits of the mask.
+        uint8x16_t equal = vceqq_u8(vld1q_u8(bytes + i), needle);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+
+        if (mask != 0)
+            return i + (uint32_t) (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (bytes[i] == value)
+            return i;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Returns the index of the first byte that differs between two ranges, or length if they are equal.
+ */
+static inline uint32_t mve_bytes_mismatch(const uint8_t *a, const uint8_t *b, uint32_t length)
+{
+    uint32_t i = 0;
+
+#ifdef MVE_BYTES_AVX2
+    for (; i + 32 <= length; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i)));
+        uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(equal);
+
+        if (mask != 0)
+            return i + (uint32_t) __builtin_ctz(mask);
+    }
+#endif
+
+#if defined(MVE_BYTES_SSE2)
+    for (; i + 16 <= length; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (a + i)), _mm_loadu_si128((const __m128i *) (b + i)));
+        uint32_t mask = ~(uint32_t) _mm_movemask_epi8(equal) & 0xFFFF;
+
+        if (mask != 0)
+            return i + (uint32_t) __builtin_ctz(mask);
+    }
+#elif defined(MVE_BYTES_NEON)
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t different = vmvnq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(different), 4)), 0);
+
+        if (mask != 0)
+            return i + (uint32_t) (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (a[i] != b[i])
+            return i;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Continues a CRC-32C (Castagnoli) with more bytes. Start with 0, and pass the result again to continue it.
+ */
+static inline uint32_t mve_bytes_crc32c(uint32_t crc, const uint8_t *bytes, uint32_t length)
+{
+    uint32_t i = 0;
+
+    crc = ~crc;
+
+#if defined(MVE_BYTES_CRC_SSE42) && defined(__x86_64__)
+    for (; i + 8 <= length; i += 8) {
+        uint64_t block;
+
+        memcpy(&block, bytes + i, 8);
+        crc = (uint32_t) _mm_crc32_u64(crc, block);
+    }
+
+    for (; i < length; i++)
+        crc = _mm_crc32_u8(crc, bytes[i]);
+#elif defined(MVE_BYTES_CRC_SSE42)
+    for (; i + 4 <= length; i += 4) {
+        uint32_t block;
+
+        memcpy(&block, bytes + i, 4);
+        crc = _mm_crc32_u32(crc, block);
+    }
+
+    for (; i < length; i++)
+        crc = _mm_crc32_u8(crc, bytes[i]);
+#elif defined(MVE_BYTES_CRC_ARM)
+    for (; i + 8 <= length; i += 8) {
+        uint64_t block;
+
+        memcpy(&block, bytes + i, 8);
+        crc = __crc32cd(crc, block);
+    }
+
+    for (; i < length; i++)
+        crc = __crc32cb(crc, bytes[i]);
+#else
+    // A table of 16 entries, done a nibble at a time, so it takes 64 bytes instead of 1 KB.
+    static const uint32_t table[16] = {
+        0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1, 0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+        0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9, 0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75
+    };
+
+    for (; i < length; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+#endif
+
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "mve_dual.h"
+
+#ifdef MVE_DUAL_WIDTH
+
+#include <string.h>
+
+
+extern const MVE_Dual_Engine mve_dual_engine32;
+extern const MVE_Dual_Engine mve_dual_engine64;
+
+static const MVE_Dual_Engine *mve_dual_engines[] = { &mve_dual_engine32, &mve_dual_engine64 };
+
+#define MVE_DUAL_ENGINES_COUNT (sizeof(mve_dual_engines) / sizeof(mve_dual_engines[0]))
+
+
+/**
+ * @brief Reads bytes of the program, before the engine is picked.
+ *
+ * @param vm VM with the program.
+ * @param bytes Receives the bytes.
+ * @param index Index of the bytes in the program.
+ * @param length Amount of bytes to read.
+ */
+static void mve_dual_read(MVE_Dual_VM *vm, uint8_t *bytes, uint32_t index, uint32_t length)
+{
+    #ifdef MVE_LOCAL_PROGRAM
+        memcpy(bytes, vm->program + index, length);
+    #else
+        vm->fun_load_next_block(vm, bytes, index, length);
+    #endif
+}
+
+
+/**
+ * @brief Reads the width of the values from the sections of the header, without loading the program.
+ *
+ * @param vm VM with the program.
+ * @return Returns the width declared by the program, or MVE_BASE_TYPE_SIZE if it declares none.
+ */
+static uint8_t mve_dual_read_width(MVE_Dual_VM *vm)
+{
+    uint8_t bytes[5];
+
+    mve_dual_read(vm, bytes, 0, 4);
+
+    // Header sections were added in the version 1.1.
+    if (MVE_BYTES_TO_UINT16(bytes, 2) < 1)
+        return MVE_BASE_TYPE_SIZE;
+
+    uint32_t index = 4;
+
+    // Each section is its tag, followed by its length.
+    mve_dual_read(vm, bytes, index, 5);
+
+    while (bytes[0] != MVE_HEADER_END)
+    {
+        uint32_t length = MVE_BYTES_TO_UINT32(bytes, 1);
+
+        if (bytes[0] == MVE_HEADER_WIDTH && length > 0)
+        {
+            mve_dual_read(vm, bytes, index + 5, 1);
+            return bytes[0];
+        }
+
+        index += 5 + length;
+        mve_dual_read(vm, bytes, index, 5);
+    }
+
+    return MVE_BASE_TYPE_SIZE;
+}
+
+
+/**
+ * @brief Picks the engine for the width of the program and initiates it.
+ */
+static MVEbool mve_dual_start_engine(MVE_Dual_VM *vm, void *storage, uint32_t storage_size)
+{
+    vm->engine = NULL;
+    vm->storage = storage;
+    vm->storage_size = storage_size;
+
+    memset(vm->functions, 0, sizeof(vm->functions));
+
+    uint8_t width = mve_dual_read_width(vm);
+
+    for (uint32_t i = 0; i < MVE_DUAL_ENGINES_COUNT; i++) {
+        const MVE_Dual_Engine *engine = mve_dual_engines[i];
+
+        if (engine->width != width)
+            continue;
+
+        if (storage_size < engine->storage_size || ((uintptr_t) storage & 7) != 0)
+            return MVE_FALSE;
+
+        vm->engine = engine;
+
+        if (!engine->init(vm))
+        {
+            vm->engine = NULL;
+            return MVE_FALSE;
+        }
+
+        return MVE_TRUE;
+    }
+
+    return MVE_FALSE;
+}
+
+
+MVE_API uint32_t mve_dual_storage_size(void)
+{
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < MVE_DUAL_ENGINES_COUNT; i++) {
+        if (mve_dual_engines[i]->storage_size > size)
+            size = mve_dual_engines[i]->storage_size;
+    }
+
+    return size;
+}
+
+
+#ifdef MVE_RUNTIME_SIZES
+MVE_API void mve_dual_configure(MVE_Dual_VM *vm, const MVE_Config *config, MVE_Arena *arena)
+{
+    vm->config = config;
+    vm->arena = arena;
+}
+#endif
+
+
+#ifdef MVE_LOCAL_PROGRAM
+MVE_API MVEbool mve_dual_init(MVE_Dual_VM *vm, void *storage, uint32_t storage_size, uint8_t *program)
+{
+    vm->program = program;
+
+    return mve_dual_start_engine(vm, storage, storage_size);
+}
+#else
+MVE_API MVEbool mve_dual_init(MVE_Dual_VM *vm, void *storage, uint32_t storage_size, void (*fun_load_next_block)(MVE_Dual_VM *, uint8_t *, uint32_t, uint32_t))
+{
+    vm->fun_load_next_block = fun_load_next_block;
+
+    return mve_dual_start_engine(vm, storage, storage_size);
+}
+#endif
+
+
+MVE_API uint8_t mve_dual_width(MVE_Dual_VM *vm)
+{
+    return vm->engine->width;
+}
+
+
+MVE_API void mve_dual_link_function(MVE_Dual_VM *vm, const char *name, MVE_Dual_Function function)
+{
+    vm->engine->link_function(vm, name, function);
+}
+
+
+MVE_API void mve_dual_start(MVE_Dual_VM *vm)
+{
+    vm->engine->start(vm);
+}
+
+
+MVE_API void mve_dual_run(MVE_Dual_VM *vm)
+{
+    vm->engine->run(vm);
+}
+
+
+MVE_API MVEbool mve_dual_is_running(MVE_Dual_VM *vm)
+{
+    return vm->engine->is_running(vm);
+}
+
+
+MVE_API void mve_dual_stop(MVE_Dual_VM *vm)
+{
+    vm->engine->stop(vm);
+}
+
+
+MVE_API uint64_t mve_dual_get_register(MVE_Dual_VM *vm, uint8_t reg)
+{
+    return vm->engine->get_register(vm, reg);
+}
+
+
+MVE_API void mve_dual_set_register(MVE_Dual_VM *vm, uint8_t reg, uint64_t value)
+{
+    vm->engine->set_register(vm, reg, value);
+}
+
+
+MVE_API double mve_dual_get_float(MVE_Dual_VM *vm, uint8_t reg)
+{
+    return vm->engine->get_float(vm, reg);
+}
+
+
+MVE_API void mve_dual_set_float(MVE_Dual_VM *vm, uint8_t reg, double value)
+{
+    vm->engine->set_float(vm, reg, value);
+}
+
+
+MVE_API uint8_t *mve_dual_get_stack(MVE_Dual_VM *vm)
+{
+    return vm->engine->get_stack(vm);
+}
+
+
+MVE_API uint8_t *mve_dual_get_memory(MVE_Dual_VM *vm)
+{
+    return vm->engine->get_memory(vm);
+}
+
+
+#ifdef MVE_GROWABLE_SCOPES
+MVE_API void mve_dual_release(MVE_Dual_VM *vm)
+{
+    if (vm->engine != NULL)
+        vm->engine->release(vm);
+}
+#endif
+
+#endif
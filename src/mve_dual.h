@@ -0,0 +1,173 @@
+#ifndef MVE_DUAL_H
+#define MVE_DUAL_H
+
+/**
+ * VMs that run programs with 32 or 64 bit values from the same build, with MVE_DUAL_WIDTH defined.
+ *
+ * mve.c is built twice, by mve_dual32.c and mve_dual64.c, once without and once with MVE_USE_64BIT_TYPES,
+ * so each engine keeps its own registers and instructions, with the rest of the config shared.
+ * mve_dual_init reads the width declared in the header of the program (MVE_HEADER_WIDTH) and picks the engine once,
+ * so the instructions run at the speed of a VM built for that width. Programs without it run with MVE_BASE_TYPE_SIZE of the config.
+ *
+ * External functions receive the MVE_Dual_VM, and access the registers through mve_dual_get_register and mve_dual_set_register,
+ * so the same function works with both widths.
+ */
+
+#include "mve.h"
+
+
+struct MVE_Dual_VM;
+typedef struct MVE_Dual_VM MVE_Dual_VM;
+
+typedef void (*MVE_Dual_Function)(MVE_Dual_VM *vm);
+
+
+/**
+ * The functions of an engine, each one on the MVE_VM of the engine placed in the storage of the VM.
+ */
+typedef struct {
+    uint8_t width;                                                  // Size of the values, in bytes.
+    uint32_t storage_size;                                          // Bytes taken by a VM of the engine.
+
+    MVEbool (*init)(MVE_Dual_VM *vm);
+    void (*link_function)(MVE_Dual_VM *vm, const char *name, MVE_Dual_Function function);
+    void (*start)(MVE_Dual_VM *vm);
+    void (*run)(MVE_Dual_VM *vm);
+    MVEbool (*is_running)(MVE_Dual_VM *vm);
+    void (*stop)(MVE_Dual_VM *vm);
+    uint64_t (*get_register)(MVE_Dual_VM *vm, uint8_t reg);
+    void (*set_register)(MVE_Dual_VM *vm, uint8_t reg, uint64_t value);
+    double (*get_float)(MVE_Dual_VM *vm, uint8_t reg);
+    void (*set_float)(MVE_Dual_VM *vm, uint8_t reg, double value);
+    uint8_t *(*get_stack)(MVE_Dual_VM *vm);
+    uint8_t *(*get_memory)(MVE_Dual_VM *vm);
+
+#ifdef MVE_GROWABLE_SCOPES
+    void (*release)(MVE_Dual_VM *vm);
+#endif
+} MVE_Dual_Engine;
+
+
+struct MVE_Dual_VM {
+    const MVE_Dual_Engine *engine;                                  // Engine picked on init. NULL if the init failed.
+    void *storage;                                                  // Where the engine places its MVE_VM.
+    uint32_t storage_size;
+
+#ifdef MVE_LOCAL_PROGRAM
+    uint8_t *program;
+#else
+    void (*fun_load_next_block)(MVE_Dual_VM *, uint8_t *, uint32_t, uint32_t);
+#endif
+
+#ifdef MVE_RUNTIME_SIZES
+    const MVE_Config *config;                                       // Given to mve_configure of the engine on init.
+    MVE_Arena *arena;
+#endif
+
+    MVE_Dual_Function functions[MVE_EXTERNAL_FUNCTIONS_LIMIT];      // Called by the engines, by the index of the INVOKE.
+};
+
+
+// The engines only need the types, since they are built with their own copy of the API of mve.c.
+#ifndef MVE_DUAL_ENGINE
+
+/**
+ * @brief Returns the bytes of storage that a VM of any width needs.
+ */
+MVE_API uint32_t mve_dual_storage_size(void);
+
+
+#ifdef MVE_RUNTIME_SIZES
+/**
+ * @brief Sets the sizes of the VM and where its storage is taken from, given to the engine picked on init. Must be called before init.
+ *
+ * @param vm VM to configure.
+ * @param config Sizes of the VM. Can be NULL to use the defaults.
+ * @param arena Arena to carve the storage from.
+ */
+MVE_API void mve_dual_configure(MVE_Dual_VM *vm, const MVE_Config *config, MVE_Arena *arena);
+#endif
+
+
+#ifdef MVE_LOCAL_PROGRAM
+/**
+ * @brief Initiates the VM with the engine for the width of the program.
+ *
+ * @param vm VM to be initiated.
+ * @param storage Memory for the engine, of at least mve_dual_storage_size bytes, aligned to 8 bytes.
+ * Aligned to MVE_CACHE_LINE_SIZE, like the blocks of mve_pool_alloc, the hot state of the VM starts on a cache line.
+ * @param storage_size Size of the storage.
+ * @param program Bytes of the program.
+ * @return Returns true if the VM was initiated successfully. False if the width is not supported, the storage is too small, or the program is not compatible.
+ */
+MVE_API MVEbool mve_dual_init(MVE_Dual_VM *vm, void *storage, uint32_t storage_size, uint8_t *program);
+#else
+/**
+ * @brief Initiates the VM with the engine for the width of the program.
+ *
+ * @param vm VM to be initiated.
+ * @param storage Memory for the engine, of at least mve_dual_storage_size bytes, aligned to 8 bytes.
+ * Aligned to MVE_CACHE_LINE_SIZE, like the blocks of mve_pool_alloc, the hot state of the VM starts on a cache line.
+ * @param storage_size Size of the storage.
+ * @param fun_load_next_block Function to load the bytes of the program, also used to read the width from the header.
+ * @return Returns true if the VM was initiated successfully. False if the width is not supported, the storage is too small, or the program is not compatible.
+ */
+MVE_API MVEbool mve_dual_init(MVE_Dual_VM *vm, void *storage, uint32_t storage_size, void (*fun_load_next_block)(MVE_Dual_VM *, uint8_t *, uint32_t, uint32_t));
+#endif
+
+/**
+ * @brief Returns the size of the values of the program being run, 4 or 8 bytes.
+ */
+MVE_API uint8_t mve_dual_width(MVE_Dual_VM *vm);
+
+/**
+ * @brief Links a C function into the VM, called with the MVE_Dual_VM on both widths.
+ *
+ * @param vm VM to link the function.
+ * @param name Name of the function that is declared in the program.
+ * @param function Function to be linked into the VM.
+ */
+MVE_API void mve_dual_link_function(MVE_Dual_VM *vm, const char *name, MVE_Dual_Function function);
+
+MVE_API void mve_dual_start(MVE_Dual_VM *vm);
+
+MVE_API void mve_dual_run(MVE_Dual_VM *vm);
+
+MVE_API MVEbool mve_dual_is_running(MVE_Dual_VM *vm);
+
+MVE_API void mve_dual_stop(MVE_Dual_VM *vm);
+
+/**
+ * @brief Returns the bits of a register, with the 32 bit values extended with zeros.
+ */
+MVE_API uint64_t mve_dual_get_register(MVE_Dual_VM *vm, uint8_t reg);
+
+/**
+ * @brief Sets the bits of a register. The 32 bit values keep the lowest 32 bits.
+ */
+MVE_API void mve_dual_set_register(MVE_Dual_VM *vm, uint8_t reg, uint64_t value);
+
+/**
+ * @brief Returns a register as a float, which is a double with 64 bit values.
+ */
+MVE_API double mve_dual_get_float(MVE_Dual_VM *vm, uint8_t reg);
+
+/**
+ * @brief Sets a register as a float, which is a double with 64 bit values.
+ */
+MVE_API void mve_dual_set_float(MVE_Dual_VM *vm, uint8_t reg, double value);
+
+MVE_API uint8_t *mve_dual_get_stack(MVE_Dual_VM *vm);
+
+MVE_API uint8_t *mve_dual_get_memory(MVE_Dual_VM *vm);
+
+#ifdef MVE_GROWABLE_SCOPES
+/**
+ * @brief Frees the scopes and frames of the engine.
+ */
+MVE_API void mve_dual_release(MVE_Dual_VM *vm);
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * The engine of mve_dual.c for the programs with 32 bit values.
+ */
+
+#include "config.h"
+
+#ifdef MVE_DUAL_WIDTH
+
+#undef MVE_USE_64BIT_TYPES
+#define MVE_DUAL_ENGINE mve_dual_engine32
+
+#include "mve_dual_engine.h"
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * The engine of mve_dual.c for the programs with 64 bit values.
+ */
+
+#include "config.h"
+
+#ifdef MVE_DUAL_WIDTH
+
+#ifndef MVE_USE_64BIT_TYPES
+#define MVE_USE_64BIT_TYPES
+#endif
+
+#define MVE_DUAL_ENGINE mve_dual_engine64
+
+#include "mve_dual_engine.h"
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef MVE_DUAL_ENGINE_H
+#define MVE_DUAL_ENGINE_H
+
+/**
+ * An engine of mve_dual.c. It is included once per translation unit, after defining MVE_DUAL_ENGINE to the name of the engine
+ * and MVE_USE_64BIT_TYPES for the 64 bit one. mve.c is included with MVE_API as static, so each engine keeps its own copy of the VM.
+ *
+ * The MVE_VM is the first member of a box placed in the storage of the MVE_Dual_VM, with a pointer back to it,
+ * so the functions called by the VM find the MVE_Dual_VM from the MVE_VM they receive.
+ */
+
+// The engines only call part of their copy of the API.
+#undef MVE_API
+#if defined(__GNUC__) || defined(__clang__)
+#define MVE_API static __attribute__((unused))
+#else
+#define MVE_API static
+#endif
+
+#include "mve.c"
+#include "mve_dual.h"
+
+
+typedef struct {
+    MVE_VM vm;
+    MVE_Dual_VM *dual;
+} MVE_Dual_Box;
+
+#define MVE_DUAL_VM(dual) (&((MVE_Dual_Box *) (dual)->storage)->vm)
+#define MVE_DUAL_OF(vm) (((MVE_Dual_Box *) (vm))->dual)
+
+
+/**
+ * @brief Called by INVOKE for every function, calls the function linked to the index invoked.
+ */
+static void mve_dual_invoke(MVE_VM *vm)
+{
+    MVE_Dual_VM *dual = MVE_DUAL_OF(vm);
+
+    dual->functions[vm->invoked_function](dual);
+}
+
+
+#ifndef MVE_LOCAL_PROGRAM
+static void mve_dual_load_next_block(MVE_VM *vm, uint8_t *buffer, uint32_t index, uint32_t length)
+{
+    MVE_Dual_VM *dual = MVE_DUAL_OF(vm);
+
+    dual->fun_load_next_block(dual, buffer, index, length);
+}
+#endif
+
+
+static MVEbool mve_dual_engine_init(MVE_Dual_VM *dual)
+{
+    MVE_Dual_Box *box = (MVE_Dual_Box *) dual->storage;
+
+    box->dual = dual;
+
+    #ifdef MVE_RUNTIME_SIZES
+        mve_configure(&box->vm, dual->config, dual->arena);
+    #endif
+
+    #ifdef MVE_LOCAL_PROGRAM
+        return mve_init(&box->vm, dual->program);
+    #else
+        return mve_init(&box->vm, mve_dual_load_next_block);
+    #endif
+}
+
+
+// The name is only looked up here. INVOKE calls mve_dual_invoke, which calls the function by the index invoked.
+static void mve_dual_engine_link_function(MVE_Dual_VM *dual, const char *name, MVE_Dual_Function function)
+{
+    MVE_VM *vm = MVE_DUAL_VM(dual);
+    uint16_t function_index = mve_find_function(vm, name);
+
+    if (function_index < vm->external_functions_count)
+    {
+        vm->external_functions[function_index] = (void *) mve_dual_invoke;
+        dual->functions[function_index] = function;
+    }
+}
+
+
+static void mve_dual_engine_start(MVE_Dual_VM *dual)
+{
+    mve_start(MVE_DUAL_VM(dual));
+}
+
+
+static void mve_dual_engine_run(MVE_Dual_VM *dual)
+{
+    mve_run(MVE_DUAL_VM(dual));
+}
+
+
+static MVEbool mve_dual_engine_is_running(MVE_Dual_VM *dual)
+{
+    return mve_is_running(MVE_DUAL_VM(dual));
+}
+
+
+static void mve_dual_engine_stop(MVE_Dual_VM *dual)
+{
+    mve_stop(MVE_DUAL_VM(dual));
+}
+
+
+static uint64_t mve_dual_engine_get_register(MVE_Dual_VM *dual, uint8_t reg)
+{
+    return MVE_DUAL_VM(dual)->registers.all[reg].i;
+}
+
+
+static void mve_dual_engine_set_register(MVE_Dual_VM *dual, uint8_t reg, uint64_t value)
+{
+    MVE_DUAL_VM(dual)->registers.all[reg].i = value;
+}
+
+
+static double mve_dual_engine_get_float(MVE_Dual_VM *dual, uint8_t reg)
+{
+    return MVE_DUAL_VM(dual)->registers.all[reg].f;
+}
+
+
+static void mve_dual_engine_set_float(MVE_Dual_VM *dual, uint8_t reg, double value)
+{
+    MVE_DUAL_VM(dual)->registers.all[reg].f = value;
+}
+
+
+static uint8_t *mve_dual_engine_get_stack(MVE_Dual_VM *dual)
+{
+    return MVE_DUAL_VM(dual)->stack;
+}
+
+
+static uint8_t *mve_dual_engine_get_memory(MVE_Dual_VM *dual)
+{
+    return MVE_DUAL_VM(dual)->memory;
+}
+
+
+#ifdef MVE_GROWABLE_SCOPES
+static void mve_dual_engine_release(MVE_Dual_VM *dual)
+{
+    mve_release(MVE_DUAL_VM(dual));
+}
+#endif
+
+
+const MVE_Dual_Engine MVE_DUAL_ENGINE = {
+    MVE_BASE_TYPE_SIZE,
+    sizeof(MVE_Dual_Box),
+    mve_dual_engine_init,
+    mve_dual_engine_link_function,
+    mve_dual_engine_start,
+    mve_dual_engine_run,
+    mve_dual_engine_is_running,
+    mve_dual_engine_stop,
+    mve_dual_engine_get_register,
+    mve_dual_engine_set_register,
+    mve_dual_engine_get_float,
+    mve_dual_engine_set_float,
+    mve_dual_engine_get_stack,
+    mve_dual_engine_get_memory,
+#ifdef MVE_GROWABLE_SCOPES
+    mve_dual_engine_release,
+#endif
+};
+
+#endif
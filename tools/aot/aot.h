@@ -0,0 +1,316 @@
+#ifndef MVE_TOOLS_AOT_H
+#define MVE_TOOLS_AOT_H
+
+/**
+ * Compiles a program ahead of time into a C file, which runs on the same MVE_VM state as the interpreter,
+ * using the runtime in src/mve_aot.h. Each instruction becomes a call with constant operands, jumps become gotos,
+ * and CALL and FCALL store the same program index to go back to as the interpreter, so END and RET go back through a switch of the places called from.
+ * SWITCH becomes a C switch, so the compiler of the host can make its own jump table.
+ *
+ * The C file has:
+ *  <name>_header       The header of the program, to be given to mve_init, so the external functions and the main scope are loaded.
+ *  <name>_run          Runs the program from the start, until EOP, an external function stops the VM, or the end of the program.
+ *
+ * SEND and RECV are not supported, since they can park the VM in the middle of the program.
+ * LDX, STX and XLEN need the C file to be compiled with MVE_USE_REGIONS, like the VM.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "../common/program.h"
+
+
+static void aot_write_bytes(FILE *out, const uint8_t *bytes, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        fprintf(out, "%s%s%u", i == 0 ? "" : ",", i % 16 == 0 ? "\n    " : " ", bytes[i]);
+
+    fprintf(out, "\n");
+}
+
+
+static uint32_t aot_target_index(const Program *program, const Program_Instruction *instruction, uint32_t end)
+{
+    return instruction->target < program->count ? program->code[instruction->target].offset : end;
+}
+
+
+static uint32_t aot_case_index(const Program *program, const Program_Case *entry, uint32_t end)
+{
+    return entry->target < program->count ? program->code[entry->target].offset : end;
+}
+
+
+/**
+ * @brief Writes a program as C.
+ *
+ * @param program The decoded program.
+ * @param bytes The bytecode of the program, which the header is copied from.
+ * @param size The size of the bytecode.
+ * @param name The prefix of the names in the C file.
+ * @param input The name of the program file, written in a comment.
+ * @param out The C file.
+ * @return Returns false if the program cannot be compiled, after printing why.
+ */
+static MVEbool aot_compile(Program *program, const uint8_t *bytes, uint32_t size, const char *name, const char *input, FILE *out)
+{
+    uint32_t header_size = program->count > 0 ? program->code[0].offset : size;
+    uint8_t *labels = calloc(size + 1, 1);
+    uint8_t *returns = calloc(size + 1, 1);
+    MVEbool has_return = MVE_FALSE;
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        const Program_Instruction *instruction = &program->code[i];
+
+        switch (instruction->operation)
+        {
+        case MVE_OP_SEND: case MVE_OP_RECV: case MVE_OP_SENDS: case MVE_OP_RECVS:
+            fprintf(stderr, "SEND and RECV at %u are not supported.\n", instruction->offset);
+            free(labels);
+            free(returns);
+            return MVE_FALSE;
+        case MVE_OP_END: case MVE_OP_RET:
+            has_return = MVE_TRUE;
+            break;
+        default:
+            break;
+        }
+
+        if (program_target_operand(instruction) < 0 || instruction->isa == NULL)
+            continue;
+
+        if (instruction->target == PROGRAM_NO_TARGET)
+        {
+            fprintf(stderr, "The jump at %u does not go to the start of an instruction.\n", instruction->offset);
+            free(labels);
+            free(returns);
+            return MVE_FALSE;
+        }
+
+        labels[aot_target_index(program, instruction, size)] = 1;
+
+        for (uint32_t j = 0; j < instruction->cases_count; j++) {
+            if (instruction->cases[j].target == PROGRAM_NO_TARGET)
+            {
+                fprintf(stderr, "The case %u of the SWITCH at %u does not go to the start of an instruction.\n", j, instruction->offset);
+                free(labels);
+                free(returns);
+                return MVE_FALSE;
+            }
+
+            labels[aot_case_index(program, &instruction->cases[j], size)] = 1;
+        }
+
+        // END and RET go back right after the CALL or FCALL.
+        if (instruction->operation == MVE_OP_CALL || instruction->operation == MVE_OP_FCALL)
+        {
+            uint32_t return_index = i + 1 < program->count ? program->code[i + 1].offset : size;
+
+            labels[return_index] = 1;
+            returns[return_index] = 1;
+        }
+    }
+
+    fprintf(out, "/* Compiled from %s by the MicroVE AOT compiler. */\n\n", input);
+    fprintf(out, "#include \"mve_aot.h\"\n\n\n");
+
+    fprintf(out, "const uint32_t %s_header_size = %u;\n\n", name, header_size);
+    fprintf(out, "uint8_t %s_header[] = {", name);
+    aot_write_bytes(out, bytes, header_size);
+    fprintf(out, "};\n\n");
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        const Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->operation == MVE_OP_SCOPE && instruction->isa != NULL && instruction->data_length > 0)
+        {
+            fprintf(out, "static const uint8_t %s_scope_%u[] = {", name, instruction->offset);
+            aot_write_bytes(out, instruction->data, instruction->data_length);
+            fprintf(out, "};\n\n");
+        }
+    }
+
+    fprintf(out, "\nvoid %s_run(MVE_VM *vm)\n{\n", name);
+
+    if (has_return)
+        fprintf(out, "    uint32_t return_index;\n\n");
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        const Program_Instruction *instruction = &program->code[i];
+        const uint64_t *v = instruction->values;
+        uint32_t pc = instruction->offset;
+
+        if (labels[pc])
+            fprintf(out, "L%u:\n", pc);
+
+        fprintf(out, "    MVE_AOT_STEP(vm, %u);\n", pc);
+
+        if (instruction->isa == NULL)
+        {
+            fprintf(out, "    mve_aot_undefined(vm, %u);\n    return;\n", pc);
+            continue;
+        }
+
+        switch (instruction->operation)
+        {
+        case MVE_OP_LDR: case MVE_OP_STR: case MVE_OP_ADD: case MVE_OP_SUB: case MVE_OP_MUL: case MVE_OP_DIV:
+        case MVE_OP_AND: case MVE_OP_ORR: case MVE_OP_XOR: case MVE_OP_LSL: case MVE_OP_LSR:
+        {
+            char function[8];
+            uint8_t j = 0;
+
+            for (; instruction->isa->name[j] != '\0' && j < sizeof(function) - 1; j++)
+                function[j] = (char) tolower((unsigned char) instruction->isa->name[j]);
+
+            function[j] = '\0';
+
+            fprintf(out, "    mve_aot_%s(vm, %u, %u, %u, %u);\n", function, pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2]);
+            break;
+        }
+        case MVE_OP_LDS:
+            fprintf(out, "    mve_aot_lds(vm, %u, %u, %d, %u);\n", pc, (unsigned) v[0], (int32_t) (uint32_t) v[1], (unsigned) v[2]);
+            break;
+        case MVE_OP_STS:
+            fprintf(out, "    mve_aot_sts(vm, %u, %u, %d, %u);\n", pc, (unsigned) v[0], (int32_t) (uint32_t) v[1], (unsigned) v[2]);
+            break;
+        case MVE_OP_LDI:
+            fprintf(out, "    mve_aot_ldi(vm, %u, %u, UINT64_C(%llu));\n", pc, (unsigned) v[0], (unsigned long long) v[1]);
+            break;
+        case MVE_OP_MOV:
+            fprintf(out, "    mve_aot_mov(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_NOT:
+            fprintf(out, "    mve_aot_not(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_NEG:
+            fprintf(out, "    mve_aot_neg(vm, %u, %u);\n", pc, (unsigned) v[0]);
+            break;
+        case MVE_OP_INC:
+            fprintf(out, "    mve_aot_inc(vm, %u, %u);\n", pc, (unsigned) v[0]);
+            break;
+        case MVE_OP_DEC:
+            fprintf(out, "    mve_aot_dec(vm, %u, %u);\n", pc, (unsigned) v[0]);
+            break;
+        case MVE_OP_CMP:
+            fprintf(out, "    mve_aot_cmp(vm, %u, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2], (unsigned) v[3]);
+            break;
+        case MVE_OP_INVOKE:
+            fprintf(out, "    if (!mve_aot_invoke(vm, %u, %u))\n        return;\n", pc, (unsigned) v[0]);
+            break;
+        case MVE_OP_SCOPE:
+            if (instruction->data_length > 0)
+                fprintf(out, "    mve_aot_scope(vm, %u, %s_scope_%u, %u, %u);\n", pc, name, pc, instruction->data_length, instruction->zero_length);
+            else
+                fprintf(out, "    mve_aot_scope(vm, %u, NULL, 0, %u);\n", pc, instruction->zero_length);
+            break;
+        case MVE_OP_END:
+            fprintf(out, "    return_index = mve_aot_end(vm, %u);\n", pc);
+            fprintf(out, "    if (return_index != 0)\n        goto aot_return;\n");
+            break;
+        case MVE_OP_JMP:
+            fprintf(out, "    goto L%u;\n", aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_JNZ:
+            fprintf(out, "    if (vm->registers.all[%u].i != 0)\n        goto L%u;\n", (unsigned) v[0], aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_LOOP:
+            fprintf(out, "    if (mve_aot_loop(vm, %u, %u))\n        goto L%u;\n", pc, (unsigned) v[0], aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_CALL:
+            fprintf(out, "    mve_aot_call(vm, %u, %u);\n", pc, i + 1 < program->count ? program->code[i + 1].offset : size);
+            fprintf(out, "    goto L%u;\n", aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_FCALL:
+            fprintf(out, "    mve_aot_fcall(vm, %u, %u);\n", pc, i + 1 < program->count ? program->code[i + 1].offset : size);
+            fprintf(out, "    goto L%u;\n", aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_RET:
+            fprintf(out, "    return_index = mve_aot_ret(vm, %u);\n", pc);
+            fprintf(out, "    goto aot_return;\n");
+            break;
+        case MVE_OP_TCALL:
+            fprintf(out, "    mve_aot_tcall(vm, %u);\n", pc);
+            fprintf(out, "    goto L%u;\n", aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_SWITCH:
+            fprintf(out, "    switch (mve_aot_switch(vm, %u, %u).i)\n    {\n", pc, (unsigned) v[0]);
+
+            for (uint32_t j = 0; j < instruction->cases_count; j++)
+                fprintf(out, "    case %u:\n        goto L%u;\n", j, aot_case_index(program, &instruction->cases[j], size));
+
+            fprintf(out, "    default:\n        goto L%u;\n    }\n", aot_target_index(program, instruction, size));
+            break;
+        case MVE_OP_PUSH:
+            fprintf(out, "    mve_aot_push(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_POP:
+            fprintf(out, "    mve_aot_pop(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_PUSHM:
+            fprintf(out, "    mve_aot_pushm(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_POPM:
+            fprintf(out, "    mve_aot_popm(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_STRLEN:
+            fprintf(out, "    mve_aot_strlen(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_FINDBYTE:
+            fprintf(out, "    mve_aot_findbyte(vm, %u, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2], (unsigned) v[3]);
+            break;
+        case MVE_OP_MEMCMP:
+            fprintf(out, "    mve_aot_memcmp(vm, %u, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2], (unsigned) v[3]);
+            break;
+        case MVE_OP_CRC32C:
+            fprintf(out, "    mve_aot_crc32c(vm, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2]);
+            break;
+        case MVE_OP_LDX:
+            fprintf(out, "    mve_aot_ldx(vm, %u, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2], (unsigned) v[3]);
+            break;
+        case MVE_OP_STX:
+            fprintf(out, "    mve_aot_stx(vm, %u, %u, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1], (unsigned) v[2], (unsigned) v[3]);
+            break;
+        case MVE_OP_XLEN:
+            fprintf(out, "    mve_aot_xlen(vm, %u, %u, %u);\n", pc, (unsigned) v[0], (unsigned) v[1]);
+            break;
+        case MVE_OP_LADR:
+            fprintf(out, "    mve_aot_ladr(vm, %u, %u, %d);\n", pc, (unsigned) v[0], (int32_t) (uint32_t) v[1]);
+            break;
+        case MVE_OP_EOP:
+            fprintf(out, "    mve_stop(vm);\n    return;\n");
+            break;
+        default:
+            fprintf(out, "    mve_aot_undefined(vm, %u);\n    return;\n", pc);
+            break;
+        }
+    }
+
+    // The end of the program, reached by a jump or by the last instruction.
+    if (labels[size])
+        fprintf(out, "L%u:\n", size);
+
+    fprintf(out, "    mve_stop(vm);\n    return;\n");
+
+    // END and RET go back to the program index stored by CALL or FCALL, which is always one of these.
+    if (has_return)
+    {
+        fprintf(out, "\naot_return:\n    switch (return_index)\n    {\n");
+
+        for (uint32_t pc = 0; pc <= size; pc++) {
+            if (returns[pc])
+                fprintf(out, "    case %u:\n        goto L%u;\n", pc, pc);
+        }
+
+        fprintf(out, "    default:\n        mve_stop(vm);\n        return;\n    }\n");
+    }
+
+    fprintf(out, "}\n");
+
+    free(labels);
+    free(returns);
+
+    return MVE_TRUE;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Compiles a program ahead of time into a C file. See aot.h.
+ *
+ * Usage: aot <program file> -o <output.c> [-n name]
+ */
+
+#include "../common/files.h"
+#include "aot.h"
+
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    const char *name = "program";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            name = argv[++i];
+        else
+            input = argv[i];
+    }
+
+    if (input == NULL || output == NULL)
+    {
+        fprintf(stderr, "Usage: %s <program file> -o <output.c> [-n name]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t *bytes = files_read(input, &size);
+    Program program;
+
+    if (bytes == NULL || program_decode(&program, bytes, size) != 0)
+    {
+        fprintf(stderr, "Cannot read the program %s.\n", input);
+        return 1;
+    }
+
+    FILE *out = fopen(output, "w");
+
+    if (out == NULL)
+    {
+        fprintf(stderr, "Cannot write %s.\n", output);
+        return 1;
+    }
+
+    MVEbool compiled = aot_compile(&program, bytes, size, name, input, out);
+
+    fclose(out);
+    free(bytes);
+    program_free(&program);
+
+    if (!compiled)
+        remove(output);
+
+    return compiled ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Assembles the text form of a program, as written by the disassembler, into bytecode.
+ * With -O the peephole optimizations are done before encoding. With -b the input is bytecode instead of text,
+ * so an existing program can be optimized.
+ *
+ * Usage: assembler [-O] [-b] <input> -o <output>
+ */
+
+#include "../common/assembly.h"
+#include "../common/files.h"
+#include "peephole.h"
+
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    MVEbool optimize = MVE_FALSE;
+    MVEbool binary = MVE_FALSE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-O") == 0)
+            optimize = MVE_TRUE;
+        else if (strcmp(argv[i], "-b") == 0)
+            binary = MVE_TRUE;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else
+            input = argv[i];
+    }
+
+    if (input == NULL || output == NULL)
+    {
+        fprintf(stderr, "Usage: %s [-O] [-b] <input> -o <output>\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t *content = files_read(input, &size);
+
+    if (content == NULL)
+    {
+        fprintf(stderr, "Cannot read %s.\n", input);
+        return 1;
+    }
+
+    Program program;
+    char error[256];
+    int result;
+
+    if (binary)
+    {
+        result = program_decode(&program, content, size);
+        snprintf(error, sizeof(error), "Not a valid program.");
+    }
+    else
+    {
+        result = assembly_parse(&program, (char *) content, error, sizeof(error));
+    }
+
+    free(content);
+
+    if (result != 0)
+    {
+        fprintf(stderr, "%s: %s\n", input, error);
+        program_free(&program);
+        return 1;
+    }
+
+    if (optimize)
+    {
+        Peephole_Stats stats;
+        uint32_t saved = peephole_optimize(&program, &stats);
+
+        fprintf(stderr, "Saved %u bytes: %u moves, %u folded and %u shrunk immediates, %u dead stores, %u fused loops, %u threaded and %u removed jumps.\n",
+            saved, stats.removed_moves, stats.folded_immediates, stats.shrunk_immediates, stats.dead_stores, stats.fused_loops, stats.threaded_jumps, stats.removed_jumps);
+    }
+
+    uint8_t *bytes = program_encode(&program, &size);
+
+    result = files_write(output, bytes, size);
+
+    if (result != 0)
+        fprintf(stderr, "Cannot write %s.\n", output);
+
+    free(bytes);
+    program_free(&program);
+
+    return result != 0 ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+#ifndef MVE_TOOLS_PEEPHOLE_H
+#define MVE_TOOLS_PEEPHOLE_H
+
+/**
+ * Peephole optimizations over a program. Each pass only looks inside a basic block, which starts at a jump target,
+ * so a jump never lands in the middle of a changed sequence. The passes run until none of them changes the program.
+ *
+ *  - MOV x, x is removed, and so is the second MOV of MOV a, b; MOV b, a.
+ *  - LDI followed by INC, DEC or NEG of the same register is folded, when the result does not overflow.
+ *  - LDI uses the smallest length that holds the value.
+ *  - Writes to a register that is written again before it is read are removed.
+ *  - DEC followed by JNZ of the same register becomes a LOOP.
+ *  - Jumps to a JMP go straight to its target, including the cases of SWITCH, and a JMP to the next instruction is removed.
+ *
+ * Only the instructions that read and write registers are changed or removed. Every other instruction,
+ * including the ones that can fail like DIV, keeps all the registers alive. Writes to sp and mp are never removed.
+ */
+
+#include "../common/program.h"
+
+#define PEEPHOLE_REGISTERS 5                    // r0 to r4. Writes to sp, mp and any higher register are kept.
+
+
+typedef struct {
+    uint32_t removed_moves;
+    uint32_t folded_immediates;
+    uint32_t shrunk_immediates;
+    uint32_t dead_stores;
+    uint32_t fused_loops;
+    uint32_t threaded_jumps;
+    uint32_t removed_jumps;
+} Peephole_Stats;
+
+
+/**
+ * @brief Returns the index of the register written by a pure instruction, or -1 if the instruction is not pure.
+ * Pure instructions only read and write registers, and cannot fail with valid registers.
+ */
+static int peephole_written_operand(const Program_Instruction *instruction)
+{
+    switch (instruction->operation)
+    {
+    case MVE_OP_LDI: case MVE_OP_MOV: case MVE_OP_NOT: case MVE_OP_NEG: case MVE_OP_INC: case MVE_OP_DEC:
+    case MVE_OP_ADD: case MVE_OP_SUB: case MVE_OP_MUL: case MVE_OP_AND: case MVE_OP_ORR: case MVE_OP_XOR:
+    case MVE_OP_LSL: case MVE_OP_LSR:
+        break;
+    case MVE_OP_CMP:
+        return instruction->values[0] <= MVE_CMP_LESSEQUAL ? 1 : -1;
+    default:
+        return -1;
+    }
+
+    if (instruction->operation == MVE_OP_LDI && instruction->lengths[1] > MVE_BASE_TYPE_SIZE)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * @brief Returns if every register of a pure instruction is valid, so removing it does not hide an error.
+ */
+static MVEbool peephole_valid_registers(const Program_Instruction *instruction)
+{
+    for (uint8_t j = 0; instruction->isa->operands[j] != '\0'; j++) {
+        if (instruction->isa->operands[j] == 'r' && instruction->values[j] >= MVE_REGISTERS_SIZE)
+            return MVE_FALSE;
+    }
+
+    return MVE_TRUE;
+}
+
+
+/**
+ * @brief Marks the instructions that start a basic block: the jump targets and the exports.
+ */
+static void peephole_leaders(const Program *program, uint8_t *leaders)
+{
+    memset(leaders, 0, program->count + 1);
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        for (uint32_t j = 0; j < program_jumps_count(&program->code[i]) && !program->code[i].removed; j++) {
+            if (program_jump(&program->code[i], j) != PROGRAM_NO_TARGET)
+                leaders[program_resolve(program, program_jump(&program->code[i], j))] = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < program->exports_count; i++) {
+        if (program->exports[i].target != PROGRAM_NO_TARGET)
+            leaders[program_resolve(program, program->exports[i].target)] = 1;
+    }
+}
+
+
+static uint32_t peephole_next(const Program *program, uint32_t index)
+{
+    return program_resolve(program, index + 1);
+}
+
+
+static uint8_t peephole_minimal_length(uint64_t value)
+{
+    uint8_t length = 0;
+
+    while (value != 0) {
+        value >>= 8;
+        length++;
+    }
+
+    return length;
+}
+
+
+static uint32_t peephole_moves(Program *program, const uint8_t *leaders, Peephole_Stats *stats)
+{
+    uint32_t changes = 0;
+
+    for (uint32_t i = program_resolve(program, 0); i < program->count; i = peephole_next(program, i)) {
+        Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->operation != MVE_OP_MOV || instruction->isa == NULL || !peephole_valid_registers(instruction))
+            continue;
+
+        if (instruction->values[0] == instruction->values[1])
+        {
+            instruction->removed = 1;
+            changes++;
+            continue;
+        }
+
+        uint32_t next = peephole_next(program, i);
+
+        if (next >= program->count || leaders[next])
+            continue;
+
+        Program_Instruction *second = &program->code[next];
+
+        if (second->operation == MVE_OP_MOV && second->isa != NULL && second->values[0] == instruction->values[1] && second->values[1] == instruction->values[0])
+        {
+            second->removed = 1;
+            changes++;
+        }
+    }
+
+    stats->removed_moves += changes;
+
+    return changes;
+}
+
+
+static uint32_t peephole_immediates(Program *program, const uint8_t *leaders, Peephole_Stats *stats)
+{
+    const uint64_t max = ((uint64_t) 1 << (MVE_BASE_TYPE_SIZE * 8 - 1)) - 1;
+    uint32_t changes = 0;
+
+    for (uint32_t i = program_resolve(program, 0); i < program->count; i = peephole_next(program, i)) {
+        Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->operation != MVE_OP_LDI || instruction->isa == NULL || instruction->lengths[1] > MVE_BASE_TYPE_SIZE)
+            continue;
+
+        uint32_t next = peephole_next(program, i);
+
+        if (next < program->count && !leaders[next] && program->code[next].isa != NULL && program->code[next].values[0] == instruction->values[0])
+        {
+            Program_Instruction *second = &program->code[next];
+            uint64_t value = instruction->values[1];
+            MVEbool folded = MVE_TRUE;
+
+            if (second->operation == MVE_OP_INC && value < max)
+                instruction->values[1] = value + 1;
+            else if (second->operation == MVE_OP_DEC && value > 0 && value <= max)
+                instruction->values[1] = value - 1;
+            else if (second->operation == MVE_OP_NEG && value == 0)
+                instruction->values[1] = 0;
+            else
+                folded = MVE_FALSE;
+
+            if (folded)
+            {
+                instruction->lengths[1] = MVE_BASE_TYPE_SIZE;
+                second->removed = 1;
+                stats->folded_immediates++;
+                changes++;
+            }
+        }
+
+        uint8_t length = peephole_minimal_length(instruction->values[1]);
+
+        if (length < instruction->lengths[1])
+        {
+            instruction->lengths[1] = length;
+            stats->shrunk_immediates++;
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+
+/**
+ * @brief Removes the pure instructions whose result is written again before it is read, going backwards in each block.
+ */
+static uint32_t peephole_dead_stores(Program *program, const uint8_t *leaders, Peephole_Stats *stats)
+{
+    uint32_t changes = 0;
+    uint8_t live[PEEPHOLE_REGISTERS];
+
+    memset(live, 1, sizeof(live));
+
+    for (uint32_t i = program->count; i-- > 0; ) {
+        Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->removed)
+            continue;
+
+        int written = instruction->isa != NULL ? peephole_written_operand(instruction) : -1;
+
+        if (written < 0 || !peephole_valid_registers(instruction))
+        {
+            memset(live, 1, sizeof(live));
+        }
+        else
+        {
+            uint64_t reg = instruction->values[written];
+
+            if (reg < PEEPHOLE_REGISTERS && !live[reg])
+            {
+                instruction->removed = 1;
+                changes++;
+            }
+            else
+            {
+                if (reg < PEEPHOLE_REGISTERS)
+                    live[reg] = 0;
+
+                // The registers read, including the written one for NEG, INC and DEC.
+                for (uint8_t j = 0; instruction->isa->operands[j] != '\0'; j++) {
+                    if (instruction->isa->operands[j] != 'r' || instruction->values[j] >= PEEPHOLE_REGISTERS)
+                        continue;
+
+                    if (j != written || instruction->operation == MVE_OP_NEG || instruction->operation == MVE_OP_INC || instruction->operation == MVE_OP_DEC)
+                        live[instruction->values[j]] = 1;
+                }
+            }
+        }
+
+        // Everything is alive at the end of the previous block.
+        if (leaders[i])
+            memset(live, 1, sizeof(live));
+    }
+
+    stats->dead_stores += changes;
+
+    return changes;
+}
+
+
+static uint32_t peephole_loops(Program *program, const uint8_t *leaders, Peephole_Stats *stats)
+{
+    uint32_t changes = 0;
+
+    for (uint32_t i = program_resolve(program, 0); i < program->count; i = peephole_next(program, i)) {
+        Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->operation != MVE_OP_DEC || instruction->isa == NULL || !peephole_valid_registers(instruction))
+            continue;
+
+        uint32_t next = peephole_next(program, i);
+
+        if (next >= program->count || leaders[next])
+            continue;
+
+        Program_Instruction *jump = &program->code[next];
+
+        if (jump->operation != MVE_OP_JNZ || jump->isa == NULL || jump->values[0] != instruction->values[0])
+            continue;
+
+        instruction->operation = MVE_OP_LOOP;
+        instruction->isa = isa_find(MVE_OP_LOOP);
+        instruction->values[1] = jump->values[1];
+        instruction->target = jump->target;
+        jump->removed = 1;
+        changes++;
+    }
+
+    stats->fused_loops += changes;
+
+    return changes;
+}
+
+
+static uint32_t peephole_jumps(Program *program, Peephole_Stats *stats)
+{
+    uint32_t changes = 0;
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        Program_Instruction *instruction = &program->code[i];
+
+        for (uint32_t j = 0; j < program_jumps_count(instruction) && !instruction->removed; j++) {
+            if (program_jump(instruction, j) == PROGRAM_NO_TARGET)
+                continue;
+
+            // Follow the chain of JMPs, stopping if it loops.
+            uint32_t target = program_resolve(program, program_jump(instruction, j));
+
+            for (uint32_t steps = 0; steps < program->count && target < program->count; steps++) {
+                const Program_Instruction *jump = &program->code[target];
+
+                if (jump->operation != MVE_OP_JMP || jump->isa == NULL || jump->target == PROGRAM_NO_TARGET || program_resolve(program, jump->target) == target)
+                    break;
+
+                target = program_resolve(program, jump->target);
+            }
+
+            if (target != program_resolve(program, program_jump(instruction, j)))
+            {
+                program_set_jump(instruction, j, target);
+                stats->threaded_jumps++;
+                changes++;
+            }
+        }
+
+        if (instruction->removed || instruction->target == PROGRAM_NO_TARGET)
+            continue;
+
+        if (instruction->operation == MVE_OP_JMP && program_resolve(program, instruction->target) == peephole_next(program, i))
+        {
+            instruction->removed = 1;
+            stats->removed_jumps++;
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+
+/**
+ * @brief Optimizes a program in place.
+ *
+ * @param program The program.
+ * @param stats Receives the amount of each optimization done.
+ * @return Returns the amount of bytes saved.
+ */
+static uint32_t peephole_optimize(Program *program, Peephole_Stats *stats)
+{
+    uint8_t *leaders = malloc(program->count + 1);
+    uint32_t size = program_layout(program);
+    uint32_t changes;
+
+    memset(stats, 0, sizeof(Peephole_Stats));
+
+    do {
+        changes = 0;
+
+        peephole_leaders(program, leaders);
+        changes += peephole_moves(program, leaders, stats);
+
+        peephole_leaders(program, leaders);
+        changes += peephole_immediates(program, leaders, stats);
+
+        peephole_leaders(program, leaders);
+        changes += peephole_dead_stores(program, leaders, stats);
+
+        peephole_leaders(program, leaders);
+        changes += peephole_loops(program, leaders, stats);
+
+        changes += peephole_jumps(program, stats);
+    } while (changes > 0);
+
+    free(leaders);
+
+    return size - program_layout(program);
+}
+
+#endif
@@ -0,0 +1,857 @@
+#ifndef MVE_TOOLS_ASSEMBLY_H
+#define MVE_TOOLS_ASSEMBLY_H
+
+/**
+ * The text form of a MicroVE program, written by the disassembler and read by the assembler.
+ *
+ *  ; Comments start with a semicolon.
+ *  .version 1, 2               Bytecode version. The current one by default.
+ *  .sizes 64, 32, 8            Stack size, memory size and scope limit required by the program.
+ *  .width 8                    Size of the values of the program, 4 or 8 bytes, and of the immediates after it.
+ *  .section 7, 1, 2            Any other header section, by its tag and bytes.
+ *  .export on_tick, loop       Function called by the host, by its name and the label where it starts.
+ *  .import print               External function. INVOKE uses the name or the index.
+ *  .memory 2, 4, 5             Main scope memory: the amount of initial bytes, a plus and the zero filled bytes, then the initial bytes.
+ *  .byte 200                   A single byte, for unknown OPs.
+ *
+ *  loop:                       Label, which can be used by JMP, JNZ and CALL.
+ *      LDI r0, 10              Immediates are as long as the width, unless the length is given after a colon: 10:1.
+ *      SCOPE 3+16, "ab\0"      The initial bytes can be numbers or strings.
+ *      PUSHM {r1,r2}, 4
+ *      CMP NE, r2, r0, r1
+ *      JNZ r2, loop
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <strings.h>
+
+#include "program.h"
+
+
+/**
+ * @brief Returns the FNV-1a hash of a name, which is all the VM keeps of an export.
+ */
+static uint32_t assembly_export_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const char *c = name; *c != '\0'; c++)
+        hash = (hash ^ (uint8_t) *c) * 16777619u;
+
+    return hash;
+}
+
+
+/**
+ * @brief Writes the operands of a scope: the amount of initial bytes, the zero filled bytes and the initial bytes.
+ */
+static void assembly_write_scope(FILE *out, const uint8_t *data, uint32_t data_length, uint32_t zero_length)
+{
+    if (zero_length > 0)
+        fprintf(out, "%u+%u", data_length, zero_length);
+    else
+        fprintf(out, "%u", data_length);
+
+    for (uint32_t i = 0; i < data_length; i++)
+        fprintf(out, ", %u", data[i]);
+}
+
+
+/**
+ * @brief Writes a jump as the label of the instruction it goes to, or as its program index after '@' if it does not go to the start of one.
+ */
+static void assembly_write_jump(const Program *program, FILE *out, uint32_t target, uint64_t value, uint32_t end)
+{
+    target = target != PROGRAM_NO_TARGET ? program_resolve(program, target) : PROGRAM_NO_TARGET;
+
+    if (target == PROGRAM_NO_TARGET)
+        fprintf(out, "@%u", (unsigned) value);
+    else
+        fprintf(out, "L%u", target < program->count ? program->code[target].offset : end);
+}
+
+
+/**
+ * @brief Writes a program as text. The instructions jumped to get labels named by their program index.
+ */
+static void assembly_write(Program *program, FILE *out)
+{
+    program_layout(program);
+
+    uint8_t *is_target = calloc(program->count + 1, 1);
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        for (uint32_t j = 0; j < program_jumps_count(&program->code[i]) && !program->code[i].removed; j++) {
+            uint32_t target = program_jump(&program->code[i], j);
+
+            if (target != PROGRAM_NO_TARGET)
+                is_target[program_resolve(program, target)] = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < program->exports_count; i++) {
+        if (program->exports[i].target != PROGRAM_NO_TARGET)
+            is_target[program_resolve(program, program->exports[i].target)] = 1;
+    }
+
+    fprintf(out, ".version %u, %u\n", program->major_version, program->minor_version);
+
+    for (uint32_t i = 0; i < program->sections_count; i++) {
+        const Program_Section *section = &program->sections[i];
+
+        if (section->tag == MVE_HEADER_SIZES && section->length == 12)
+        {
+            fprintf(out, ".sizes %u, %u, %u\n", isa_read_uint(section->data, 4), isa_read_uint(section->data + 4, 4), isa_read_uint(section->data + 8, 4));
+            continue;
+        }
+
+        if (section->tag == MVE_HEADER_WIDTH && section->length == 1)
+        {
+            fprintf(out, ".width %u\n", section->data[0]);
+            continue;
+        }
+
+        fprintf(out, ".section %u", section->tag);
+
+        for (uint32_t j = 0; j < section->length; j++)
+            fprintf(out, ", %u", section->data[j]);
+
+        fprintf(out, "\n");
+    }
+
+    uint32_t end = program_layout(program);
+
+    for (uint32_t i = 0; i < program->exports_count; i++) {
+        fprintf(out, ".export %s, ", program->exports[i].name);
+        assembly_write_jump(program, out, program->exports[i].target, program->exports[i].offset, end);
+        fprintf(out, "\n");
+    }
+
+    for (uint32_t i = 0; i < program->names_count; i++)
+        fprintf(out, ".import %s\n", program->names[i]);
+
+    fprintf(out, ".memory ");
+    assembly_write_scope(out, program->data, program->data_length, program->zero_length);
+    fprintf(out, "\n\n");
+
+    for (uint32_t i = 0; i <= program->count; i++) {
+        if (is_target[i])
+            fprintf(out, "L%u:\n", i < program->count ? program->code[i].offset : end);
+
+        if (i == program->count || program->code[i].removed)
+            continue;
+
+        const Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->isa == NULL)
+        {
+            fprintf(out, "    .byte %u\n", instruction->operation);
+            continue;
+        }
+
+        fprintf(out, "    %s", instruction->isa->name);
+
+        for (uint8_t j = 0; instruction->isa->operands[j] != '\0'; j++) {
+            uint64_t value = instruction->values[j];
+
+            // The cases write their own separators, so a table without cases has none.
+            if (instruction->isa->operands[j] != 't')
+                fprintf(out, j == 0 ? " " : ", ");
+
+            switch (instruction->isa->operands[j])
+            {
+            case 'r':
+                if (value < 7)
+                    fprintf(out, "%s", isa_register_names[value]);
+                else
+                    fprintf(out, "r%u", (unsigned) value);
+                break;
+            case 'b': case 'w':
+                fprintf(out, "%llu", (unsigned long long) value);
+                break;
+            case 'h':
+                if (instruction->operation == MVE_OP_INVOKE && value < program->names_count)
+                    fprintf(out, "%s", program->names[value]);
+                else
+                    fprintf(out, "%u", (unsigned) value);
+                break;
+            case 's':
+                fprintf(out, "[%d]", (int32_t) (uint32_t) value);
+                break;
+            case 'a':
+                assembly_write_jump(program, out, instruction->target, value, end);
+                break;
+            case 't':
+                for (uint32_t k = 0; k < instruction->cases_count; k++) {
+                    fprintf(out, ", ");
+                    assembly_write_jump(program, out, instruction->cases[k].target, instruction->cases[k].offset, end);
+                }
+                break;
+            case 'c':
+                if (value < sizeof(isa_compare_names) / sizeof(isa_compare_names[0]))
+                    fprintf(out, "%s", isa_compare_names[value]);
+                else
+                    fprintf(out, "%u", (unsigned) value);
+                break;
+            case 'm':
+            {
+                MVEbool first = MVE_TRUE;
+
+                fprintf(out, "{");
+
+                for (uint8_t k = 0; k < 16; k++) {
+                    if ((value & (1 << k)) == 0)
+                        continue;
+
+                    if (k < 7)
+                        fprintf(out, "%s%s", first ? "" : ",", isa_register_names[k]);
+                    else
+                        fprintf(out, "%sr%u", first ? "" : ",", k);
+
+                    first = MVE_FALSE;
+                }
+
+                fprintf(out, "}");
+                break;
+            }
+            case 'l':
+                fprintf(out, "%llu:%u", (unsigned long long) value, instruction->lengths[j]);
+                break;
+            case 'z':
+                assembly_write_scope(out, instruction->data, instruction->data_length, instruction->zero_length);
+                break;
+            }
+        }
+
+        fprintf(out, "\n");
+    }
+
+    free(is_target);
+}
+
+
+typedef struct {
+    char name[PROGRAM_NAME_SIZE];
+    uint32_t instruction;                       // Index of the instruction after the label.
+} Assembly_Label;
+
+
+typedef struct {
+    uint32_t instruction;                       // PROGRAM_NO_TARGET for the label of an export.
+    uint32_t jump;                              // Jump of the instruction, as in program_jump, or the index of the export.
+    char label[PROGRAM_NAME_SIZE];
+    uint32_t line;
+} Assembly_Reference;
+
+
+typedef struct {
+    Assembly_Label *labels;
+    uint32_t labels_count;
+
+    Assembly_Reference *references;
+    uint32_t references_count;
+
+    uint32_t line;
+    uint8_t width;
+    char error[256];
+} Assembly_Parser;
+
+
+static int assembly_fail(Assembly_Parser *parser, const char *message, const char *token)
+{
+    snprintf(parser->error, sizeof(parser->error), "Line %u: %s '%s'.", parser->line, message, token);
+    return -1;
+}
+
+
+/**
+ * @brief Splits the operands of a line by commas, except the ones inside strings and braces.
+ *
+ * @return Returns the amount of operands.
+ */
+static uint32_t assembly_split(char *text, char **operands, uint32_t max)
+{
+    uint32_t count = 0;
+    MVEbool in_string = MVE_FALSE;
+    int depth = 0;
+
+    while (isspace((unsigned char) *text))
+        text++;
+
+    if (*text == '\0')
+        return 0;
+
+    operands[count++] = text;
+
+    for (char *c = text; *c != '\0'; c++) {
+        if (*c == '"' && (c == text || c[-1] != '\\'))
+            in_string = !in_string;
+        else if (!in_string && *c == '{')
+            depth++;
+        else if (!in_string && *c == '}')
+            depth--;
+        else if (!in_string && depth == 0 && *c == ',' && count < max)
+        {
+            *c = '\0';
+            operands[count++] = c + 1;
+        }
+    }
+
+    // Trim the operands.
+    for (uint32_t i = 0; i < count; i++) {
+        while (isspace((unsigned char) *operands[i]))
+            operands[i]++;
+
+        char *end = operands[i] + strlen(operands[i]);
+
+        while (end > operands[i] && isspace((unsigned char) end[-1]))
+            *--end = '\0';
+    }
+
+    return count;
+}
+
+
+static int assembly_number(Assembly_Parser *parser, const char *text, uint64_t *value)
+{
+    char *end;
+
+    errno = 0;
+
+    if (text[0] == '-')
+        *value = (uint64_t) strtoll(text, &end, 0);
+    else
+        *value = strtoull(text, &end, 0);
+
+    if (end == text || *end != '\0' || errno != 0)
+        return assembly_fail(parser, "Invalid number", text);
+
+    return 0;
+}
+
+
+static int assembly_register(Assembly_Parser *parser, const char *text, uint64_t *value)
+{
+    for (uint8_t i = 0; i < sizeof(isa_register_names) / sizeof(isa_register_names[0]); i++) {
+        if (strcmp(text, isa_register_names[i]) == 0)
+        {
+            *value = i;
+            return 0;
+        }
+    }
+
+    if (text[0] == 'r' && isdigit((unsigned char) text[1]))
+        return assembly_number(parser, text + 1, value);
+
+    return assembly_fail(parser, "Invalid register", text);
+}
+
+
+/**
+ * @brief Reads the operands of a scope, as "3+16, 1, 2, "a"", into its initial bytes and zero filled length.
+ */
+static int assembly_scope(Assembly_Parser *parser, char **operands, uint32_t count, uint8_t **data, uint32_t *data_length, uint32_t *zero_length)
+{
+    uint64_t length = 0;
+    uint64_t zero = 0;
+    char *plus = strchr(operands[0], '+');
+
+    if (plus != NULL)
+    {
+        *plus = '\0';
+
+        if (assembly_number(parser, plus + 1, &zero) != 0)
+            return -1;
+    }
+
+    if (assembly_number(parser, operands[0], &length) != 0)
+        return -1;
+
+    *data = malloc(length > 0 ? length : 1);
+    *data_length = 0;
+    *zero_length = (uint32_t) zero;
+
+    for (uint32_t i = 1; i < count; i++) {
+        const char *operand = operands[i];
+
+        if (operand[0] != '"')
+        {
+            uint64_t byte;
+
+            if (assembly_number(parser, operand, &byte) != 0)
+                return -1;
+
+            if (*data_length < length)
+                (*data)[*data_length] = (uint8_t) byte;
+
+            (*data_length)++;
+            continue;
+        }
+
+        for (const char *c = operand + 1; *c != '\0' && *c != '"'; c++) {
+            uint8_t byte = (uint8_t) *c;
+
+            if (*c == '\\' && c[1] != '\0')
+            {
+                c++;
+                byte = *c == 'n' ? '\n' : *c == 't' ? '\t' : *c == '0' ? '\0' : (uint8_t) *c;
+            }
+
+            if (*data_length < length)
+                (*data)[*data_length] = byte;
+
+            (*data_length)++;
+        }
+    }
+
+    if (*data_length != length)
+        return assembly_fail(parser, "The amount of initial bytes does not match", operands[0]);
+
+    return 0;
+}
+
+
+/**
+ * @brief Reads the operand of a jump of the last instruction: a program index after '@', or a label, which is resolved once the whole program is read.
+ *
+ * @param jump The jump of the instruction, as in program_jump.
+ * @param value Receives the program index after '@'.
+ */
+static int assembly_jump(Program *program, Assembly_Parser *parser, const char *operand, uint32_t jump, uint64_t *value)
+{
+    if (operand[0] == '@')
+        return assembly_number(parser, operand + 1, value);
+
+    parser->references = realloc(parser->references, (parser->references_count + 1) * sizeof(Assembly_Reference));
+    parser->references[parser->references_count].instruction = program->count - 1;
+    parser->references[parser->references_count].jump = jump;
+    parser->references[parser->references_count].line = parser->line;
+    snprintf(parser->references[parser->references_count].label, PROGRAM_NAME_SIZE, "%s", operand);
+    parser->references_count++;
+
+    return 0;
+}
+
+
+static int assembly_instruction(Program *program, Assembly_Parser *parser, const char *mnemonic, char **operands, uint32_t count)
+{
+    char upper[16];
+    uint32_t i = 0;
+
+    for (; mnemonic[i] != '\0' && i < sizeof(upper) - 1; i++)
+        upper[i] = (char) toupper((unsigned char) mnemonic[i]);
+
+    upper[i] = '\0';
+
+    const ISA_Instruction *isa = isa_find_name(upper);
+
+    if (isa == NULL)
+        return assembly_fail(parser, "Unknown instruction", mnemonic);
+
+    uint32_t expected = strlen(isa->operands);
+
+    // The 'z' and 't' operands take all the operands left. A scope needs at least its length, and a table can have no cases.
+    const char *rest = strpbrk(isa->operands, "zt");
+    uint32_t minimum = rest == NULL ? expected : (uint32_t) (rest - isa->operands) + (*rest == 'z' ? 1 : 0);
+
+    if (count < minimum || (rest == NULL && count != expected))
+        return assembly_fail(parser, "Wrong amount of operands for", mnemonic);
+
+    Program_Instruction *instruction = program_append(program, isa->operation);
+
+    for (uint8_t j = 0; j < expected; j++) {
+        char *operand = j < count ? operands[j] : NULL;
+        uint64_t *value = &instruction->values[j];
+
+        switch (isa->operands[j])
+        {
+        case 'r':
+            if (assembly_register(parser, operand, value) != 0)
+                return -1;
+            break;
+        case 'b': case 'w':
+            if (assembly_number(parser, operand, value) != 0)
+                return -1;
+            break;
+        case 'h':
+        {
+            MVEbool found = MVE_FALSE;
+
+            for (uint32_t k = 0; k < program->names_count && isa->operation == MVE_OP_INVOKE; k++) {
+                if (strcmp(program->names[k], operand) == 0)
+                {
+                    *value = k;
+                    found = MVE_TRUE;
+                }
+            }
+
+            if (!found && assembly_number(parser, operand, value) != 0)
+                return -1;
+            break;
+        }
+        case 's':
+        {
+            size_t length = strlen(operand);
+
+            if (operand[0] == '[' && length > 2 && operand[length - 1] == ']')
+            {
+                operand[length - 1] = '\0';
+                operand++;
+            }
+
+            if (assembly_number(parser, operand, value) != 0)
+                return -1;
+
+            *value &= 0xFFFFFFFF;
+            break;
+        }
+        case 'a':
+            if (assembly_jump(program, parser, operand, 0, value) != 0)
+                return -1;
+            break;
+        case 't':
+            *value = count - j;
+
+            for (uint32_t k = j; k < count; k++) {
+                uint64_t offset = 0;
+
+                program_add_case(instruction, 0, PROGRAM_NO_TARGET);
+
+                if (assembly_jump(program, parser, operands[k], instruction->cases_count, &offset) != 0)
+                    return -1;
+
+                instruction->cases[instruction->cases_count - 1].offset = (uint32_t) offset;
+            }
+            break;
+        case 'c':
+        {
+            MVEbool found = MVE_FALSE;
+
+            for (uint8_t k = 0; k < sizeof(isa_compare_names) / sizeof(isa_compare_names[0]); k++) {
+                if (strcasecmp(operand, isa_compare_names[k]) == 0)
+                {
+                    *value = k;
+                    found = MVE_TRUE;
+                }
+            }
+
+            if (!found && assembly_number(parser, operand, value) != 0)
+                return -1;
+            break;
+        }
+        case 'm':
+        {
+            if (operand[0] != '{')
+            {
+                if (assembly_number(parser, operand, value) != 0)
+                    return -1;
+                break;
+            }
+
+            *value = 0;
+
+            for (char *name = strtok(operand + 1, ",} "); name != NULL; name = strtok(NULL, ",} ")) {
+                uint64_t reg;
+
+                if (assembly_register(parser, name, &reg) != 0)
+                    return -1;
+
+                *value |= 1 << reg;
+            }
+            break;
+        }
+        case 'l':
+        {
+            char *colon = strchr(operand, ':');
+            uint64_t length = parser->width;
+
+            if (colon != NULL)
+            {
+                *colon = '\0';
+
+                if (assembly_number(parser, colon + 1, &length) != 0)
+                    return -1;
+
+                if (length > 8)
+                    return assembly_fail(parser, "The immediate length cannot be bigger than 8 in", mnemonic);
+            }
+
+            if (assembly_number(parser, operand, value) != 0)
+                return -1;
+
+            instruction->lengths[j] = (uint8_t) length;
+
+            if (length < 8)
+            {
+                uint64_t limit = 1ULL << (length * 8);
+                int64_t signed_value = (int64_t) *value;
+
+                // Negative numbers fit if they are kept when sign extended, as -1:1.
+                MVEbool fits = *value < limit || (length > 0 && signed_value < 0 && signed_value >= -(int64_t) (limit / 2));
+
+                if (!fits)
+                    return assembly_fail(parser, "The immediate does not fit in its length", operand);
+
+                *value &= limit - 1;
+            }
+            break;
+        }
+        case 'z':
+            if (assembly_scope(parser, operands, count, &instruction->data, &instruction->data_length, &instruction->zero_length) != 0)
+                return -1;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+static int assembly_directive(Program *program, Assembly_Parser *parser, const char *directive, char **operands, uint32_t count)
+{
+    uint64_t values[3];
+
+    if (strcmp(directive, ".version") == 0 && count == 2)
+    {
+        if (assembly_number(parser, operands[0], &values[0]) != 0 || assembly_number(parser, operands[1], &values[1]) != 0)
+            return -1;
+
+        program->major_version = (uint16_t) values[0];
+        program->minor_version = (uint16_t) values[1];
+    }
+    else if (strcmp(directive, ".sizes") == 0 && count == 3)
+    {
+        uint8_t data[12];
+        uint32_t size = 0;
+
+        for (uint8_t i = 0; i < 3; i++) {
+            if (assembly_number(parser, operands[i], &values[i]) != 0)
+                return -1;
+
+            program_put(data, &size, values[i], 4);
+        }
+
+        program_add_section(program, MVE_HEADER_SIZES, data, sizeof(data));
+    }
+    else if (strcmp(directive, ".width") == 0 && count == 1)
+    {
+        if (assembly_number(parser, operands[0], &values[0]) != 0)
+            return -1;
+
+        if (values[0] != 4 && values[0] != 8)
+            return assembly_fail(parser, "The width must be 4 or 8 bytes, not", operands[0]);
+
+        uint8_t data = (uint8_t) values[0];
+
+        parser->width = data;
+        program_add_section(program, MVE_HEADER_WIDTH, &data, 1);
+    }
+    else if (strcmp(directive, ".section") == 0 && count >= 1)
+    {
+        if (assembly_number(parser, operands[0], &values[0]) != 0)
+            return -1;
+
+        uint8_t *data = malloc(count);
+
+        for (uint32_t i = 1; i < count; i++) {
+            uint64_t byte;
+
+            if (assembly_number(parser, operands[i], &byte) != 0)
+            {
+                free(data);
+                return -1;
+            }
+
+            data[i - 1] = (uint8_t) byte;
+        }
+
+        program_add_section(program, (uint8_t) values[0], data, count - 1);
+        free(data);
+    }
+    else if (strcmp(directive, ".export") == 0 && count == 2)
+    {
+        program_add_export(program, operands[0], 0, PROGRAM_NO_TARGET);
+
+        // The VM finds the exports by the hash of their names, so two of them cannot share it.
+        const char *name = program->exports[program->exports_count - 1].name;
+
+        for (uint32_t i = 0; i + 1 < program->exports_count; i++) {
+            if (strcmp(program->exports[i].name, name) == 0)
+                return assembly_fail(parser, "The export is declared twice", operands[0]);
+
+            if (assembly_export_hash(program->exports[i].name) == assembly_export_hash(name))
+                return assembly_fail(parser, "The export has the same hash as the one of", program->exports[i].name);
+        }
+
+        if (operands[1][0] == '@')
+        {
+            if (assembly_number(parser, operands[1] + 1, &values[0]) != 0)
+                return -1;
+
+            program->exports[program->exports_count - 1].offset = (uint32_t) values[0];
+            return 0;
+        }
+
+        parser->references = realloc(parser->references, (parser->references_count + 1) * sizeof(Assembly_Reference));
+        parser->references[parser->references_count].instruction = PROGRAM_NO_TARGET;
+        parser->references[parser->references_count].jump = program->exports_count - 1;
+        parser->references[parser->references_count].line = parser->line;
+        snprintf(parser->references[parser->references_count].label, PROGRAM_NAME_SIZE, "%s", operands[1]);
+        parser->references_count++;
+    }
+    else if (strcmp(directive, ".import") == 0 && count == 1)
+    {
+        program_add_name(program, operands[0]);
+    }
+    else if (strcmp(directive, ".memory") == 0 && count >= 1)
+    {
+        free(program->data);
+
+        if (assembly_scope(parser, operands, count, &program->data, &program->data_length, &program->zero_length) != 0)
+            return -1;
+    }
+    else if (strcmp(directive, ".byte") == 0 && count == 1)
+    {
+        if (assembly_number(parser, operands[0], &values[0]) != 0)
+            return -1;
+
+        Program_Instruction *instruction = program_append(program, (uint8_t) values[0]);
+        instruction->isa = NULL;
+    }
+    else
+    {
+        return assembly_fail(parser, "Invalid directive", directive);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Reads a program from text.
+ *
+ * @param program Receives the program.
+ * @param text The text. It is modified while read.
+ * @param error Receives the error message, if any.
+ * @param error_size Size of error.
+ * @return Returns 0 on success, or -1 on error.
+ */
+static int assembly_parse(Program *program, char *text, char *error, size_t error_size)
+{
+    Assembly_Parser parser;
+    int result = 0;
+
+    memset(&parser, 0, sizeof(parser));
+    parser.width = MVE_BASE_TYPE_SIZE;
+    program_init(program);
+
+    program->data = malloc(1);
+
+    for (char *line = text; line != NULL && result == 0; ) {
+        char *next = strchr(line, '\n');
+
+        if (next != NULL)
+            *next++ = '\0';
+
+        parser.line++;
+
+        // Remove the comment, unless it is inside a string.
+        MVEbool in_string = MVE_FALSE;
+
+        for (char *c = line; *c != '\0'; c++) {
+            if (*c == '"' && (c == line || c[-1] != '\\'))
+                in_string = !in_string;
+            else if (*c == ';' && !in_string)
+            {
+                *c = '\0';
+                break;
+            }
+        }
+
+        while (isspace((unsigned char) *line))
+            line++;
+
+        // Labels.
+        char *colon = strchr(line, ':');
+
+        while (colon != NULL && line[0] != '.' && line[0] != '"') {
+            char *c = line;
+
+            while (isalnum((unsigned char) *c) || *c == '_')
+                c++;
+
+            if (c != colon || c == line)
+                break;
+
+            *colon = '\0';
+
+            parser.labels = realloc(parser.labels, (parser.labels_count + 1) * sizeof(Assembly_Label));
+            snprintf(parser.labels[parser.labels_count].name, PROGRAM_NAME_SIZE, "%s", line);
+            parser.labels[parser.labels_count].instruction = program->count;
+            parser.labels_count++;
+
+            line = colon + 1;
+
+            while (isspace((unsigned char) *line))
+                line++;
+
+            colon = strchr(line, ':');
+        }
+
+        if (*line != '\0')
+        {
+            char *mnemonic = line;
+            char *operands[4096];
+
+            while (*line != '\0' && !isspace((unsigned char) *line))
+                line++;
+
+            if (*line != '\0')
+                *line++ = '\0';
+
+            uint32_t count = assembly_split(line, operands, sizeof(operands) / sizeof(operands[0]));
+
+            if (mnemonic[0] == '.')
+                result = assembly_directive(program, &parser, mnemonic, operands, count);
+            else
+                result = assembly_instruction(program, &parser, mnemonic, operands, count);
+        }
+
+        line = next;
+    }
+
+    // Resolve the labels used by the jumps.
+    for (uint32_t i = 0; i < parser.references_count && result == 0; i++) {
+        Assembly_Reference *reference = &parser.references[i];
+        MVEbool found = MVE_FALSE;
+
+        for (uint32_t j = 0; j < parser.labels_count && !found; j++) {
+            if (strcmp(parser.labels[j].name, reference->label) == 0)
+            {
+                if (reference->instruction == PROGRAM_NO_TARGET)
+                    program->exports[reference->jump].target = parser.labels[j].instruction;
+                else
+                    program_set_jump(&program->code[reference->instruction], reference->jump, parser.labels[j].instruction);
+
+                found = MVE_TRUE;
+            }
+        }
+
+        if (!found)
+        {
+            parser.line = reference->line;
+            result = assembly_fail(&parser, "Unknown label", reference->label);
+        }
+    }
+
+    if (result != 0)
+        snprintf(error, error_size, "%s", parser.error);
+
+    free(parser.labels);
+    free(parser.references);
+
+    return result;
+}
+
+#endif
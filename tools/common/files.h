@@ -0,0 +1,61 @@
+#ifndef MVE_TOOLS_FILES_H
+#define MVE_TOOLS_FILES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/**
+ * @brief Reads a whole file. A NUL is added after the end, so text files can be used as strings.
+ *
+ * @param path Path of the file.
+ * @param size Receives the size of the file, without the NUL.
+ * @return Returns the content, which must be freed, or NULL if the file cannot be read.
+ */
+static uint8_t *files_read(const char *path, uint32_t *size)
+{
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *content = length >= 0 ? malloc(length + 1) : NULL;
+
+    if (content != NULL && length > 0 && fread(content, length, 1, file) != 1)
+    {
+        free(content);
+        content = NULL;
+    }
+
+    fclose(file);
+
+    if (content != NULL)
+    {
+        content[length] = '\0';
+        *size = (uint32_t) length;
+    }
+
+    return content;
+}
+
+
+static int files_write(const char *path, const uint8_t *content, uint32_t size)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL)
+        return -1;
+
+    int result = size == 0 || fwrite(content, size, 1, file) == 1 ? 0 : -1;
+
+    fclose(file);
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef MVE_TOOLS_ISA_H
+#define MVE_TOOLS_ISA_H
+
+/**
+ * The instruction set of MicroVE, shared by the host tools.
+ * Each instruction has its operands described by a string, with a character per operand:
+ *
+ *  r   Register, as uint8.
+ *  b   Number, as uint8.
+ *  h   Number, as uint16.
+ *  w   Number, as uint32.
+ *  s   Stack address, as int32. Negative addresses are relative to the end of the stack.
+ *  a   Program index, as uint32. Target of a jump.
+ *  c   Compare operation, as uint8.
+ *  m   Register mask, as uint16.
+ *  l   Immediate value, as a uint8 length followed by that amount of bytes.
+ *  z   Scope memory length, as uint32, followed by the zero filled length as uint32 if it has MVE_SCOPE_ZERO_FILL. The initial bytes come after it.
+ *  t   Jump table, as a uint32 amount of cases. The program index of each case comes after it, as uint32.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/mve.h"
+
+
+typedef struct {
+    uint8_t operation;
+    const char *name;
+    const char *operands;
+} ISA_Instruction;
+
+
+static const ISA_Instruction isa_instructions[] = {
+    { MVE_OP_EOP,       "EOP",      "" },
+    { MVE_OP_LDR,       "LDR",      "rrr" },
+    { MVE_OP_STR,       "STR",      "rrr" },
+    { MVE_OP_LDS,       "LDS",      "rsb" },
+    { MVE_OP_STS,       "STS",      "rsb" },
+    { MVE_OP_LDI,       "LDI",      "rl" },
+    { MVE_OP_MOV,       "MOV",      "rr" },
+    { MVE_OP_NEG,       "NEG",      "r" },
+    { MVE_OP_INVOKE,    "INVOKE",   "h" },
+    { MVE_OP_ADD,       "ADD",      "rrr" },
+    { MVE_OP_SUB,       "SUB",      "rrr" },
+    { MVE_OP_MUL,       "MUL",      "rrr" },
+    { MVE_OP_DIV,       "DIV",      "rrr" },
+    { MVE_OP_SCOPE,     "SCOPE",    "z" },
+    { MVE_OP_END,       "END",      "" },
+    { MVE_OP_CMP,       "CMP",      "crrr" },
+    { MVE_OP_JMP,       "JMP",      "a" },
+    { MVE_OP_JNZ,       "JNZ",      "ra" },
+    { MVE_OP_CALL,      "CALL",     "a" },
+    { MVE_OP_AND,       "AND",      "rrr" },
+    { MVE_OP_ORR,       "ORR",      "rrr" },
+    { MVE_OP_NOT,       "NOT",      "rr" },
+    { MVE_OP_LSL,       "LSL",      "rrr" },
+    { MVE_OP_LSR,       "LSR",      "rrr" },
+    { MVE_OP_XOR,       "XOR",      "rrr" },
+    { MVE_OP_INC,       "INC",      "r" },
+    { MVE_OP_DEC,       "DEC",      "r" },
+    { MVE_OP_PUSH,      "PUSH",     "rb" },
+    { MVE_OP_POP,       "POP",      "rb" },
+    { MVE_OP_LADR,      "LADR",     "rs" },
+    { MVE_OP_SEND,      "SEND",     "br" },
+    { MVE_OP_RECV,      "RECV",     "br" },
+    { MVE_OP_SENDS,     "SENDS",    "brr" },
+    { MVE_OP_RECVS,     "RECVS",    "brr" },
+    { MVE_OP_PUSHM,     "PUSHM",    "mb" },
+    { MVE_OP_POPM,      "POPM",     "mb" },
+    { MVE_OP_FCALL,     "FCALL",    "a" },
+    { MVE_OP_RET,       "RET",      "" },
+    { MVE_OP_TCALL,     "TCALL",    "a" },
+    { MVE_OP_SWITCH,    "SWITCH",   "rat" },
+    { MVE_OP_LOOP,      "LOOP",     "ra" },
+    { MVE_OP_STRLEN,    "STRLEN",   "rr" },
+    { MVE_OP_FINDBYTE,  "FINDBYTE", "rrrr" },
+    { MVE_OP_MEMCMP,    "MEMCMP",   "rrrr" },
+    { MVE_OP_CRC32C,    "CRC32C",   "rrr" },
+    { MVE_OP_LDX,       "LDX",      "rbrr" },
+    { MVE_OP_STX,       "STX",      "rbrr" },
+    { MVE_OP_XLEN,      "XLEN",     "rb" },
+};
+
+#define ISA_INSTRUCTIONS_COUNT (sizeof(isa_instructions) / sizeof(isa_instructions[0]))
+
+
+static const char *isa_compare_names[] = { "EQ", "NE", "GT", "LT", "GE", "LE" };
+
+static const char *isa_register_names[] = { "r0", "r1", "r2", "r3", "r4", "sp", "mp" };
+
+
+static const ISA_Instruction *isa_find(uint8_t operation)
+{
+    for (uint32_t i = 0; i < ISA_INSTRUCTIONS_COUNT; i++) {
+        if (isa_instructions[i].operation == operation)
+            return &isa_instructions[i];
+    }
+
+    return NULL;
+}
+
+
+static const ISA_Instruction *isa_find_name(const char *name)
+{
+    for (uint32_t i = 0; i < ISA_INSTRUCTIONS_COUNT; i++) {
+        if (strcmp(isa_instructions[i].name, name) == 0)
+            return &isa_instructions[i];
+    }
+
+    return NULL;
+}
+
+
+static uint32_t isa_read_uint(const uint8_t *bytes, uint8_t length)
+{
+    uint32_t value = 0;
+
+    for (uint8_t i = 0; i < length && i < 4; i++)
+        value |= (uint32_t) bytes[i] << (i * 8);
+
+    return value;
+}
+
+
+/**
+ * @brief Returns the amount of bytes of an operand.
+ *
+ * @param kind Character of the operand.
+ * @param bytes The bytes of the operand.
+ * @param available Amount of bytes available, so a truncated operand is not read past it.
+ * @return Returns the amount of bytes, or 0 if they are not available.
+ */
+static uint32_t isa_operand_size(char kind, const uint8_t *bytes, uint32_t available)
+{
+    uint32_t size = 0;
+
+    switch (kind)
+    {
+    case 'r': case 'b': case 'c':
+        size = 1;
+        break;
+    case 'h': case 'm':
+        size = 2;
+        break;
+    case 'w': case 's': case 'a': case 't':
+        size = 4;
+        break;
+    case 'l':
+        size = available >= 1 ? 1 + bytes[0] : 1;
+        break;
+    case 'z':
+        size = available >= 4 && (isa_read_uint(bytes, 4) & MVE_SCOPE_ZERO_FILL) ? 8 : 4;
+        break;
+    }
+
+    return size <= available ? size : 0;
+}
+
+
+/**
+ * @brief Writes the operands of an instruction as text.
+ *
+ * @param instruction The instruction.
+ * @param bytes Operand bytes, following the OP.
+ * @param available Amount of operand bytes available.
+ * @param out Where to write the text.
+ * @param out_size Size of out.
+ * @return Returns the amount of operand bytes used. Less than needed if they were not available.
+ */
+static uint32_t isa_format_operands(const ISA_Instruction *instruction, const uint8_t *bytes, uint32_t available, char *out, size_t out_size)
+{
+    uint32_t used = 0;
+    size_t written = 0;
+
+    out[0] = '\0';
+
+    for (const char *kind = instruction->operands; *kind != '\0'; kind++) {
+        uint32_t size = isa_operand_size(*kind, bytes + used, available - used);
+        const uint8_t *operand = bytes + used;
+        char text[64];
+
+        if (size == 0)
+        {
+            snprintf(out + written, out_size - written, "%s?", written > 0 ? ", " : " ");
+            return used;
+        }
+
+        switch (*kind)
+        {
+        case 'r':
+            if (operand[0] < sizeof(isa_register_names) / sizeof(isa_register_names[0]))
+                snprintf(text, sizeof(text), "%s", isa_register_names[operand[0]]);
+            else
+                snprintf(text, sizeof(text), "r%u", operand[0]);
+            break;
+        case 'b': case 'h': case 'w':
+            snprintf(text, sizeof(text), "%u", isa_read_uint(operand, size));
+            break;
+        case 's':
+            snprintf(text, sizeof(text), "[%d]", (int32_t) isa_read_uint(operand, 4));
+            break;
+        case 'a':
+            snprintf(text, sizeof(text), "@%u", isa_read_uint(operand, 4));
+            break;
+        case 'c':
+            if (operand[0] < sizeof(isa_compare_names) / sizeof(isa_compare_names[0]))
+                snprintf(text, sizeof(text), "%s", isa_compare_names[operand[0]]);
+            else
+                snprintf(text, sizeof(text), "%u", operand[0]);
+            break;
+        case 'm':
+        {
+            uint32_t mask = isa_read_uint(operand, 2);
+            size_t length = 0;
+
+            text[length++] = '{';
+
+            for (uint8_t i = 0; i < 16; i++) {
+                if (mask & (1 << i))
+                    length += snprintf(text + length, sizeof(text) - length, "%s%s", length > 1 ? "," : "", i < 7 ? isa_register_names[i] : "r?");
+            }
+
+            snprintf(text + length, sizeof(text) - length, "}");
+            break;
+        }
+        case 'l':
+        {
+            uint64_t value = 0;
+
+            for (uint8_t i = 0; i < operand[0] && i < 8; i++)
+                value |= (uint64_t) operand[1 + i] << (i * 8);
+
+            snprintf(text, sizeof(text), "%llu:%u", (unsigned long long) value, operand[0]);
+            break;
+        }
+        case 'z':
+        {
+            uint32_t length = isa_read_uint(operand, 4);
+
+            if (length & MVE_SCOPE_ZERO_FILL)
+                snprintf(text, sizeof(text), "%u+%u", length & ~MVE_SCOPE_ZERO_FILL, isa_read_uint(operand + 4, 4));
+            else
+                snprintf(text, sizeof(text), "%u", length);
+            break;
+        }
+        case 't':
+            snprintf(text, sizeof(text), "%u cases", isa_read_uint(operand, 4));
+            break;
+        }
+
+        written += snprintf(out + written, out_size - written, "%s%s", written > 0 ? ", " : " ", text);
+        used += size;
+
+        if (written >= out_size)
+            written = out_size - 1;
+    }
+
+    return used;
+}
+
+#endif
@@ -0,0 +1,707 @@
+#ifndef MVE_TOOLS_PROGRAM_H
+#define MVE_TOOLS_PROGRAM_H
+
+/**
+ * A MicroVE program as a list of instructions, shared by the host tools.
+ * Jumps point to instructions instead of program indices, so instructions can be added, removed and moved,
+ * and the program indices are computed again when the program is encoded.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isa.h"
+
+#define PROGRAM_OPERANDS 4
+#define PROGRAM_NAME_SIZE 64
+#define PROGRAM_NO_TARGET UINT32_MAX
+
+
+typedef struct {
+    uint32_t offset;                            // Program index of the case, as written in the table.
+    uint32_t target;                            // Instruction jumped to. PROGRAM_NO_TARGET if the offset is not the start of an instruction.
+} Program_Case;
+
+
+typedef struct {
+    uint8_t operation;
+    const ISA_Instruction *isa;                 // NULL if the OP is unknown, which is kept as a single byte.
+
+    uint64_t values[PROGRAM_OPERANDS];          // Value of each operand, in the order of isa->operands.
+    uint8_t lengths[PROGRAM_OPERANDS];          // Length of the immediate of the 'l' operands.
+    uint32_t target;                            // Instruction jumped to by the 'a' operand. PROGRAM_NO_TARGET if it is not the start of an instruction.
+
+    uint8_t *data;                              // Initial bytes of the scope of the 'z' operand.
+    uint32_t data_length;
+    uint32_t zero_length;
+
+    Program_Case *cases;                        // Table of the 't' operand, jumped to by the index of the case.
+    uint32_t cases_count;
+
+    uint32_t offset;                            // Program index, set by program_layout.
+    uint8_t removed;                            // Removed instructions are skipped when encoding. Jumps to them go to the next instruction.
+} Program_Instruction;
+
+
+typedef struct {
+    uint8_t tag;
+    uint8_t *data;
+    uint32_t length;
+} Program_Section;
+
+
+typedef struct {
+    char name[PROGRAM_NAME_SIZE];
+    uint32_t offset;                            // Program index of the function, as written in the header.
+    uint32_t target;                            // Instruction where the function starts. PROGRAM_NO_TARGET if the offset is not the start of an instruction.
+} Program_Export;
+
+
+typedef struct {
+    uint16_t major_version;
+    uint16_t minor_version;
+
+    Program_Section *sections;                  // Header sections, without the end and the exports.
+    uint32_t sections_count;
+
+    Program_Export *exports;                    // Functions called by the host, written as the MVE_HEADER_EXPORTS section.
+    uint32_t exports_count;
+
+    char (*names)[PROGRAM_NAME_SIZE];           // External function names.
+    uint32_t names_count;
+
+    uint8_t *data;                              // Initial bytes of the main scope.
+    uint32_t data_length;
+    uint32_t zero_length;
+
+    Program_Instruction *code;
+    uint32_t count;
+    uint32_t capacity;
+} Program;
+
+
+static void program_init(Program *program)
+{
+    memset(program, 0, sizeof(Program));
+
+    program->major_version = MVE_VERSION_MAJOR;
+    program->minor_version = MVE_VERSION_MINOR;
+}
+
+
+static void program_free(Program *program)
+{
+    for (uint32_t i = 0; i < program->count; i++) {
+        free(program->code[i].data);
+        free(program->code[i].cases);
+    }
+
+    for (uint32_t i = 0; i < program->sections_count; i++)
+        free(program->sections[i].data);
+
+    free(program->sections);
+    free(program->exports);
+    free(program->names);
+    free(program->data);
+    free(program->code);
+}
+
+
+static Program_Instruction *program_append(Program *program, uint8_t operation)
+{
+    if (program->count == program->capacity)
+    {
+        program->capacity = program->capacity == 0 ? 64 : program->capacity * 2;
+        program->code = realloc(program->code, program->capacity * sizeof(Program_Instruction));
+    }
+
+    Program_Instruction *instruction = &program->code[program->count++];
+
+    memset(instruction, 0, sizeof(Program_Instruction));
+    instruction->operation = operation;
+    instruction->isa = isa_find(operation);
+    instruction->target = PROGRAM_NO_TARGET;
+
+    return instruction;
+}
+
+
+static void program_add_name(Program *program, const char *name)
+{
+    program->names = realloc(program->names, (program->names_count + 1) * PROGRAM_NAME_SIZE);
+    snprintf(program->names[program->names_count++], PROGRAM_NAME_SIZE, "%s", name);
+}
+
+
+static void program_add_section(Program *program, uint8_t tag, const uint8_t *data, uint32_t length)
+{
+    program->sections = realloc(program->sections, (program->sections_count + 1) * sizeof(Program_Section));
+
+    Program_Section *section = &program->sections[program->sections_count++];
+
+    section->tag = tag;
+    section->length = length;
+    section->data = malloc(length > 0 ? length : 1);
+    memcpy(section->data, data, length);
+}
+
+
+/**
+ * @brief Adds a function called by the host.
+ *
+ * @param offset The program index of the function, kept if target is PROGRAM_NO_TARGET.
+ * @param target The instruction where the function starts.
+ */
+static void program_add_export(Program *program, const char *name, uint32_t offset, uint32_t target)
+{
+    program->exports = realloc(program->exports, (program->exports_count + 1) * sizeof(Program_Export));
+
+    Program_Export *entry = &program->exports[program->exports_count++];
+
+    snprintf(entry->name, PROGRAM_NAME_SIZE, "%s", name);
+    entry->offset = offset;
+    entry->target = target;
+}
+
+
+/**
+ * @brief Returns the index of the 'a' operand of an instruction, or -1 if it has none.
+ */
+static int program_target_operand(const Program_Instruction *instruction)
+{
+    if (instruction->isa == NULL)
+        return -1;
+
+    const char *found = strchr(instruction->isa->operands, 'a');
+
+    return found != NULL ? (int) (found - instruction->isa->operands) : -1;
+}
+
+
+/**
+ * @brief Adds a case to the table of the 't' operand of an instruction.
+ *
+ * @param offset The program index of the case, kept if target is PROGRAM_NO_TARGET.
+ * @param target The instruction jumped to.
+ */
+static void program_add_case(Program_Instruction *instruction, uint32_t offset, uint32_t target)
+{
+    instruction->cases = realloc(instruction->cases, (instruction->cases_count + 1) * sizeof(Program_Case));
+    instruction->cases[instruction->cases_count].offset = offset;
+    instruction->cases[instruction->cases_count].target = target;
+    instruction->cases_count++;
+}
+
+
+/**
+ * @brief Returns the amount of jumps of an instruction, which are got by program_jump.
+ * Every instruction has one, the 'a' operand, which is PROGRAM_NO_TARGET if it has none, followed by the cases of the 't' operand.
+ */
+static uint32_t program_jumps_count(const Program_Instruction *instruction)
+{
+    return 1 + instruction->cases_count;
+}
+
+
+/**
+ * @brief Returns the target of a jump of an instruction. See program_jumps_count.
+ */
+static uint32_t program_jump(const Program_Instruction *instruction, uint32_t jump)
+{
+    return jump == 0 ? instruction->target : instruction->cases[jump - 1].target;
+}
+
+
+static void program_set_jump(Program_Instruction *instruction, uint32_t jump, uint32_t target)
+{
+    if (jump == 0)
+        instruction->target = target;
+    else
+        instruction->cases[jump - 1].target = target;
+}
+
+
+/**
+ * @brief Returns the instruction that is executed when jumping to an instruction, skipping the removed ones.
+ */
+static uint32_t program_resolve(const Program *program, uint32_t index)
+{
+    while (index < program->count && program->code[index].removed)
+        index++;
+
+    return index;
+}
+
+
+/**
+ * @brief Returns the amount of bytes of an instruction, including the OP and the initial bytes of a scope.
+ */
+static uint32_t program_instruction_size(const Program_Instruction *instruction)
+{
+    if (instruction->isa == NULL)
+        return 1;
+
+    uint32_t size = 1;
+
+    for (const char *kind = instruction->isa->operands; *kind != '\0'; kind++) {
+        switch (*kind)
+        {
+        case 'r': case 'b': case 'c':
+            size += 1;
+            break;
+        case 'h': case 'm':
+            size += 2;
+            break;
+        case 'w': case 's': case 'a':
+            size += 4;
+            break;
+        case 'l':
+            size += 1 + instruction->lengths[kind - instruction->isa->operands];
+            break;
+        case 'z':
+            size += (instruction->zero_length > 0 ? 8 : 4) + instruction->data_length;
+            break;
+        case 't':
+            size += 4 + 4 * instruction->cases_count;
+            break;
+        }
+    }
+
+    return size;
+}
+
+
+/**
+ * @brief Returns the program index where the code starts, after the header.
+ */
+static uint32_t program_code_start(const Program *program)
+{
+    uint32_t size = 4;
+
+    if (program->minor_version >= 1)
+    {
+        for (uint32_t i = 0; i < program->sections_count; i++)
+            size += 5 + program->sections[i].length;
+
+        if (program->exports_count > 0)
+            size += 5;
+
+        for (uint32_t i = 0; i < program->exports_count; i++)
+            size += strlen(program->exports[i].name) + 1 + 4;
+
+        size += 1;
+    }
+
+    size += 4;
+
+    for (uint32_t i = 0; i < program->names_count; i++)
+        size += strlen(program->names[i]) + 1;
+
+    size += (program->zero_length > 0 ? 8 : 4) + program->data_length;
+
+    return size;
+}
+
+
+/**
+ * @brief Sets the program index of each instruction.
+ *
+ * @return Returns the size of the encoded program.
+ */
+static uint32_t program_layout(Program *program)
+{
+    uint32_t offset = program_code_start(program);
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        program->code[i].offset = offset;
+
+        if (!program->code[i].removed)
+            offset += program_instruction_size(&program->code[i]);
+    }
+
+    return offset;
+}
+
+
+static void program_put(uint8_t *out, uint32_t *size, uint64_t value, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+        out[(*size)++] = (value >> (i * 8)) & 0xFF;
+}
+
+
+/**
+ * @brief Writes the program index of a jump: the instruction it goes to, or the offset if it does not go to the start of one.
+ *
+ * @param end The program index after the last instruction.
+ */
+static void program_put_jump(const Program *program, uint8_t *out, uint32_t *size, uint32_t target, uint64_t offset, uint32_t end)
+{
+    target = target != PROGRAM_NO_TARGET ? program_resolve(program, target) : PROGRAM_NO_TARGET;
+
+    if (target == PROGRAM_NO_TARGET)
+        program_put(out, size, offset, 4);
+    else if (target < program->count)
+        program_put(out, size, program->code[target].offset, 4);
+    else
+        program_put(out, size, end, 4);
+}
+
+
+static void program_put_scope(uint8_t *out, uint32_t *size, const uint8_t *data, uint32_t data_length, uint32_t zero_length)
+{
+    if (zero_length > 0)
+    {
+        program_put(out, size, data_length | MVE_SCOPE_ZERO_FILL, 4);
+        program_put(out, size, zero_length, 4);
+    }
+    else
+    {
+        program_put(out, size, data_length, 4);
+    }
+
+    memcpy(out + *size, data, data_length);
+    *size += data_length;
+}
+
+
+/**
+ * @brief Encodes the program into bytecode.
+ *
+ * @param program The program.
+ * @param size Receives the size of the bytecode.
+ * @return Returns the bytecode, which must be freed.
+ */
+static uint8_t *program_encode(Program *program, uint32_t *size)
+{
+    uint32_t capacity = program_layout(program);
+    uint8_t *out = malloc(capacity);
+
+    *size = 0;
+
+    program_put(out, size, program->major_version, 2);
+    program_put(out, size, program->minor_version, 2);
+
+    if (program->minor_version >= 1)
+    {
+        for (uint32_t i = 0; i < program->sections_count; i++) {
+            program_put(out, size, program->sections[i].tag, 1);
+            program_put(out, size, program->sections[i].length, 4);
+            memcpy(out + *size, program->sections[i].data, program->sections[i].length);
+            *size += program->sections[i].length;
+        }
+
+        if (program->exports_count > 0)
+        {
+            uint32_t length = 0;
+
+            for (uint32_t i = 0; i < program->exports_count; i++)
+                length += strlen(program->exports[i].name) + 1 + 4;
+
+            program_put(out, size, MVE_HEADER_EXPORTS, 1);
+            program_put(out, size, length, 4);
+
+            for (uint32_t i = 0; i < program->exports_count; i++) {
+                uint32_t name_length = strlen(program->exports[i].name) + 1;
+
+                memcpy(out + *size, program->exports[i].name, name_length);
+                *size += name_length;
+
+                program_put_jump(program, out, size, program->exports[i].target, program->exports[i].offset, capacity);
+            }
+        }
+
+        program_put(out, size, MVE_HEADER_END, 1);
+    }
+
+    program_put(out, size, program->names_count, 4);
+
+    for (uint32_t i = 0; i < program->names_count; i++) {
+        uint32_t length = strlen(program->names[i]) + 1;
+
+        memcpy(out + *size, program->names[i], length);
+        *size += length;
+    }
+
+    program_put_scope(out, size, program->data, program->data_length, program->zero_length);
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        const Program_Instruction *instruction = &program->code[i];
+
+        if (instruction->removed)
+            continue;
+
+        program_put(out, size, instruction->operation, 1);
+
+        if (instruction->isa == NULL)
+            continue;
+
+        for (uint8_t j = 0; instruction->isa->operands[j] != '\0'; j++) {
+            uint64_t value = instruction->values[j];
+
+            switch (instruction->isa->operands[j])
+            {
+            case 'r': case 'b': case 'c':
+                program_put(out, size, value, 1);
+                break;
+            case 'h': case 'm':
+                program_put(out, size, value, 2);
+                break;
+            case 'w': case 's':
+                program_put(out, size, value, 4);
+                break;
+            case 'a':
+                program_put_jump(program, out, size, instruction->target, value, capacity);
+                break;
+            case 't':
+                program_put(out, size, instruction->cases_count, 4);
+
+                for (uint32_t k = 0; k < instruction->cases_count; k++)
+                    program_put_jump(program, out, size, instruction->cases[k].target, instruction->cases[k].offset, capacity);
+                break;
+            case 'l':
+                program_put(out, size, instruction->lengths[j], 1);
+                program_put(out, size, value, instruction->lengths[j]);
+                break;
+            case 'z':
+                program_put_scope(out, size, instruction->data, instruction->data_length, instruction->zero_length);
+                break;
+            }
+        }
+    }
+
+    return out;
+}
+
+
+static uint64_t program_get(const uint8_t *bytes, uint32_t size, uint32_t *index, uint8_t length, int *error)
+{
+    uint64_t value = 0;
+
+    if (*index + length > size)
+    {
+        *error = 1;
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < length; i++)
+        value |= (uint64_t) bytes[*index + i] << (i * 8);
+
+    *index += length;
+
+    return value;
+}
+
+
+static uint8_t *program_get_scope(const uint8_t *bytes, uint32_t size, uint32_t *index, uint32_t *data_length, uint32_t *zero_length, int *error)
+{
+    uint32_t length = (uint32_t) program_get(bytes, size, index, 4, error);
+
+    *zero_length = 0;
+
+    if (length & MVE_SCOPE_ZERO_FILL)
+    {
+        length &= ~MVE_SCOPE_ZERO_FILL;
+        *zero_length = (uint32_t) program_get(bytes, size, index, 4, error);
+    }
+
+    if (*error || *index + length > size)
+    {
+        *error = 1;
+        return NULL;
+    }
+
+    uint8_t *data = malloc(length > 0 ? length : 1);
+
+    memcpy(data, bytes + *index, length);
+    *index += length;
+    *data_length = length;
+
+    return data;
+}
+
+
+/**
+ * @brief Returns the instruction that starts at a program index, or PROGRAM_NO_TARGET if none does.
+ * The end of the program is the instruction after the last one.
+ */
+static uint32_t program_find(const Program *program, uint32_t offset, uint32_t end)
+{
+    uint32_t low = 0;
+    uint32_t high = program->count;
+
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+
+        if (program->code[middle].offset < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < program->count && program->code[low].offset == offset)
+        return low;
+
+    return offset == end ? program->count : PROGRAM_NO_TARGET;
+}
+
+
+/**
+ * @brief Decodes bytecode into a program. The jumps to the start of an instruction point to it.
+ *
+ * @return Returns 0 on success, or -1 if the bytecode is not valid.
+ */
+static int program_decode(Program *program, const uint8_t *bytes, uint32_t size)
+{
+    uint32_t index = 0;
+    int error = 0;
+
+    program_init(program);
+
+    program->major_version = (uint16_t) program_get(bytes, size, &index, 2, &error);
+    program->minor_version = (uint16_t) program_get(bytes, size, &index, 2, &error);
+
+    if (program->minor_version >= 1)
+    {
+        uint8_t tag = (uint8_t) program_get(bytes, size, &index, 1, &error);
+
+        while (!error && tag != MVE_HEADER_END) {
+            uint32_t length = (uint32_t) program_get(bytes, size, &index, 4, &error);
+
+            if (error || index + length > size)
+                return -1;
+
+            if (tag == MVE_HEADER_EXPORTS)
+            {
+                uint32_t end = index + length;
+
+                while (index < end) {
+                    const uint8_t *name_end = memchr(bytes + index, '\0', end - index);
+
+                    if (name_end == NULL || name_end + 1 - bytes + 4 > end)
+                        return -1;
+
+                    const char *name = (const char *) bytes + index;
+
+                    index = name_end - bytes + 1;
+                    program_add_export(program, name, (uint32_t) program_get(bytes, size, &index, 4, &error), PROGRAM_NO_TARGET);
+                }
+            }
+            else
+            {
+                program_add_section(program, tag, bytes + index, length);
+                index += length;
+            }
+
+            tag = (uint8_t) program_get(bytes, size, &index, 1, &error);
+        }
+    }
+
+    uint32_t names_count = (uint32_t) program_get(bytes, size, &index, 4, &error);
+
+    for (uint32_t i = 0; i < names_count && !error; i++) {
+        const uint8_t *end = memchr(bytes + index, '\0', size - index);
+
+        if (end == NULL)
+            return -1;
+
+        program_add_name(program, (const char *) bytes + index);
+        index = end - bytes + 1;
+    }
+
+    program->data = program_get_scope(bytes, size, &index, &program->data_length, &program->zero_length, &error);
+
+    if (error)
+        return -1;
+
+    while (index < size) {
+        uint32_t start = index;
+        Program_Instruction *instruction = program_append(program, bytes[index++]);
+
+        instruction->offset = start;
+
+        if (instruction->isa == NULL)
+            continue;
+
+        for (uint8_t j = 0; instruction->isa->operands[j] != '\0' && !error; j++) {
+            switch (instruction->isa->operands[j])
+            {
+            case 'r': case 'b': case 'c':
+                instruction->values[j] = program_get(bytes, size, &index, 1, &error);
+                break;
+            case 'h': case 'm':
+                instruction->values[j] = program_get(bytes, size, &index, 2, &error);
+                break;
+            case 'w': case 's': case 'a':
+                instruction->values[j] = program_get(bytes, size, &index, 4, &error);
+                break;
+            case 'l':
+                instruction->lengths[j] = (uint8_t) program_get(bytes, size, &index, 1, &error);
+
+                if (instruction->lengths[j] > 8)
+                    error = 1;
+                else
+                    instruction->values[j] = program_get(bytes, size, &index, instruction->lengths[j], &error);
+                break;
+            case 'z':
+                instruction->data = program_get_scope(bytes, size, &index, &instruction->data_length, &instruction->zero_length, &error);
+                break;
+            case 't':
+            {
+                uint32_t count = (uint32_t) program_get(bytes, size, &index, 4, &error);
+
+                // Checked before reading, so a wrong count does not allocate a huge table.
+                if (error || count > (size - index) / 4)
+                {
+                    error = 1;
+                    break;
+                }
+
+                instruction->values[j] = count;
+
+                for (uint32_t k = 0; k < count; k++)
+                    program_add_case(instruction, (uint32_t) program_get(bytes, size, &index, 4, &error), PROGRAM_NO_TARGET);
+                break;
+            }
+            }
+        }
+
+        // A truncated instruction at the end is kept as unknown bytes.
+        if (error)
+        {
+            free(instruction->data);
+            free(instruction->cases);
+            program->count--;
+            index = start;
+            error = 0;
+
+            while (index < size) {
+                Program_Instruction *byte = program_append(program, bytes[index]);
+
+                byte->isa = NULL;
+                byte->offset = index++;
+            }
+        }
+    }
+
+    // Point the jumps to the instructions at their program indices.
+    for (uint32_t i = 0; i < program->count; i++) {
+        Program_Instruction *instruction = &program->code[i];
+        int operand = program_target_operand(instruction);
+
+        if (operand >= 0)
+            instruction->target = program_find(program, (uint32_t) instruction->values[operand], size);
+
+        for (uint32_t k = 0; k < instruction->cases_count; k++)
+            instruction->cases[k].target = program_find(program, instruction->cases[k].offset, size);
+    }
+
+    for (uint32_t i = 0; i < program->exports_count; i++)
+        program->exports[i].target = program_find(program, program->exports[i].offset, size);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MVE_TOOLS_RUNNER_H
+#define MVE_TOOLS_RUNNER_H
+
+#include <string.h>
+
+/**
+ * Runs programs in the tools, without the host they were made for. Must be included after mve.c, in streaming mode.
+ * External functions are linked as functions that do nothing, so programs that depend on their results may take other paths.
+ * Every region is linked to the same writable bytes, which start with zeros.
+ */
+
+
+static const uint8_t *runner_program;
+static uint32_t runner_size;
+
+
+/**
+ * @brief Sets the program read by runner_load_next_block. The bytes must stay valid while it runs.
+ */
+static void runner_set_program(const uint8_t *program, uint32_t size)
+{
+    runner_program = program;
+    runner_size = size;
+}
+
+
+/**
+ * @brief Loads the blocks of the program set by runner_set_program, with zeros after its end.
+ */
+static void runner_load_next_block(MVE_VM *vm, uint8_t *buffer, uint32_t read_index, uint32_t read_length)
+{
+    (void) vm;
+
+    for (uint32_t i = 0; i < read_length; i++)
+        buffer[i] = read_index + i < runner_size ? runner_program[read_index + i] : 0;
+}
+
+
+static void runner_nop(MVE_VM *vm)
+{
+    (void) vm;
+}
+
+
+#ifdef MVE_USE_REGIONS
+static uint8_t runner_region[65536];
+#endif
+
+
+/**
+ * @brief Links every function named in the header to a function that does nothing, and every region to the zeroed scratch bytes.
+ * Must be called after mve_init, before the names are cleared by mve_start.
+ */
+static void runner_link(MVE_VM *vm)
+{
+    for (uint32_t index = 0, function = 0; function < vm->external_functions_count; function++) {
+        const char *name = (const char *) vm->memory + index;
+
+        mve_link_function(vm, name, &runner_nop);
+        index += strlen(name) + 1;
+    }
+
+#ifdef MVE_USE_REGIONS
+    memset(runner_region, 0, sizeof(runner_region));
+
+    for (uint8_t i = 0; i < MVE_REGIONS_LIMIT; i++)
+        mve_link_region(vm, i, runner_region, sizeof(runner_region), MVE_TRUE);
+#endif
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef MVE_TOOLS_DIFFERENTIAL_ENGINE_H
+#define MVE_TOOLS_DIFFERENTIAL_ENGINE_H
+
+/**
+ * The engines compared by the differential harness. Every engine is a separate copy of the VM, with its own
+ * configuration, built from engine_vm.h in its own translation unit. They all have the same sizes,
+ * so their state can be compared byte for byte.
+ *
+ * Every engine links two regions: region 0 is writable and starts with zeros, and region 1 is read only, with the same bytes on every engine.
+ */
+
+#include <stdint.h>
+
+#define DIFFERENTIAL_STACK_SIZE 1024
+#define DIFFERENTIAL_MEMORY_SIZE 1024
+#define DIFFERENTIAL_SCOPE_LIMIT 16
+#define DIFFERENTIAL_REGISTERS 7
+#define DIFFERENTIAL_FUNCTIONS 8
+#define DIFFERENTIAL_FRAME_LIMIT 8
+#define DIFFERENTIAL_REGION_SIZE 64                     // Size of the regions linked into every engine.
+
+
+typedef struct {
+    uint32_t program_index;                             // Program index of the next instruction. Only valid while running.
+    uint8_t is_running;
+    uint64_t registers[DIFFERENTIAL_REGISTERS];
+    uint32_t scope_index;
+    uint32_t return_indexes[DIFFERENTIAL_SCOPE_LIMIT];  // Program index stored by CALL in each scope.
+    uint32_t stack_bases[DIFFERENTIAL_SCOPE_LIMIT];
+    uint32_t frame_index;
+    uint32_t frame_returns[DIFFERENTIAL_FRAME_LIMIT];  // Program index stored by FCALL in each frame.
+    uint32_t frame_scopes[DIFFERENTIAL_FRAME_LIMIT];
+    const uint8_t *stack;
+    const uint8_t *memory;
+    uint32_t stack_size;                                // Can be smaller than DIFFERENTIAL_STACK_SIZE when the program asks for its sizes.
+    uint32_t memory_size;
+    const uint8_t *region;                              // The writable region, written by STX.
+} Engine_State;
+
+
+typedef struct {
+    const char *name;
+
+    /**
+     * @brief Initializes the VM with a program, links its external functions and starts it.
+     *
+     * @param buffer_size Size of the program buffer, used by the streaming engines.
+     * @return Returns 0 on success.
+     */
+    int (*load)(const uint8_t *program, uint32_t size, uint32_t buffer_size);
+
+    /**
+     * @brief Executes one instruction. NULL for the compiled engines, which are driven by run instead.
+     */
+    void (*step)(void);
+
+    /**
+     * @brief Runs the compiled program, calling fun_step before each instruction. NULL for the interpreters.
+     */
+    void (*run)(void (*fun_step)(uint32_t program_index));
+
+    void (*state)(Engine_State *state);
+} Engine;
+
+
+extern const Engine engine_local;                       // Interpreter with the whole program in memory. The reference.
+extern const Engine engine_stream;                      // Interpreter loading the program in blocks, with a runtime buffer size.
+extern const Engine engine_growable;                    // Interpreter with the scopes and frames growing from the fewest.
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * The interpreter with growable scopes and frames, starting with the fewest of them,
+ * so the programs calling deep enough grow them while running.
+ */
+
+#define ENGINE engine_growable
+#define ENGINE_NAME "growable"
+
+#define MVE_LOCAL_PROGRAM
+#define MVE_GROWABLE_SCOPES
+#define MVE_SCOPE_LIMIT 4
+#define MVE_FRAME_LIMIT 1
+
+#include "engine_vm.h"
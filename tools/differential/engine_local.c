@@ -0,0 +1,10 @@
+/**
+ * The reference engine: the interpreter with the whole program in memory.
+ */
+
+#define ENGINE engine_local
+#define ENGINE_NAME "local"
+
+#define MVE_LOCAL_PROGRAM
+
+#include "engine_vm.h"
@@ -0,0 +1,15 @@
+/**
+ * The interpreter loading the program in blocks, with the buffer size given at runtime,
+ * so the jumps in and out of the buffer window are compared too. It also counts the loads and the usage,
+ * which must not change what the program does, and uses the scalar kernels of the byte instructions, so they are compared with the SIMD ones.
+ */
+
+#define ENGINE engine_stream
+#define ENGINE_NAME "stream"
+
+#define MVE_RUNTIME_SIZES
+#define MVE_LOADER_STATS
+#define MVE_TRACK_USAGE
+#define MVE_BYTES_SCALAR
+
+#include "engine_vm.h"
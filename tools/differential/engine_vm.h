@@ -0,0 +1,203 @@
+#ifndef MVE_TOOLS_DIFFERENTIAL_ENGINE_VM_H
+#define MVE_TOOLS_DIFFERENTIAL_ENGINE_VM_H
+
+/**
+ * An engine of the differential harness. It is included once per translation unit, after defining ENGINE to the name of
+ * the Engine to define, ENGINE_NAME to its printed name, and the macros of its mode. mve.c is included with MVE_API as static,
+ * so each engine keeps its own copy of the VM, which does not clash with the others.
+ *
+ * With DIFFERENTIAL_AOT the engine runs a program compiled by tools/aot, which is included after this file,
+ * with differential as its name.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "engine.h"
+
+#define MVE_STACK_SIZE DIFFERENTIAL_STACK_SIZE
+#define MVE_MEMORY_SIZE DIFFERENTIAL_MEMORY_SIZE
+#define MVE_EXTERNAL_FUNCTIONS_LIMIT DIFFERENTIAL_FUNCTIONS
+#define MVE_API static
+#define MVE_USE_BYTE_OPS
+#define MVE_USE_REGIONS
+
+// The engines with growable scopes start with less.
+#ifndef MVE_SCOPE_LIMIT
+#define MVE_SCOPE_LIMIT DIFFERENTIAL_SCOPE_LIMIT
+#endif
+
+#ifndef MVE_FRAME_LIMIT
+#define MVE_FRAME_LIMIT DIFFERENTIAL_FRAME_LIMIT
+#endif
+
+// A failed check means the program is not valid, so the engines cannot be compared.
+#define MVE_ERROR_LOG(vm, program_index, error_id, msg) engine_error(program_index, msg)
+
+static void engine_error(uint32_t program_index, const char *message)
+{
+    fprintf(stderr, "%s engine: %s Program index: %u.\n", ENGINE_NAME, message, program_index);
+    exit(2);
+}
+
+#include "../../src/mve.c"
+
+
+static MVE_VM engine_vm;
+static const uint8_t *engine_program;
+static uint32_t engine_program_size;
+static uint8_t engine_region[DIFFERENTIAL_REGION_SIZE];
+static uint8_t engine_constants[DIFFERENTIAL_REGION_SIZE];
+
+#ifdef MVE_RUNTIME_SIZES
+static uint8_t *engine_storage;
+#endif
+
+
+/**
+ * @brief The external function linked to every name. It only depends on the registers, so all the engines give the same result.
+ */
+static void engine_external_function(MVE_VM *vm)
+{
+    vm->registers.r0.i = vm->registers.r0.i * 3 + vm->registers.r1.i;
+}
+
+
+#ifndef MVE_LOCAL_PROGRAM
+static void engine_load_next_block(MVE_VM *vm, uint8_t *buffer, uint32_t index, uint32_t length)
+{
+    (void) vm;
+
+    for (uint32_t i = 0; i < length; i++)
+        buffer[i] = index + i < engine_program_size ? engine_program[index + i] : 0;
+}
+#endif
+
+
+static int engine_load(const uint8_t *program, uint32_t size, uint32_t buffer_size)
+{
+#ifdef MVE_GROWABLE_SCOPES
+    mve_release(&engine_vm);
+#endif
+
+    memset(&engine_vm, 0, sizeof(engine_vm));
+
+    engine_program = program;
+    engine_program_size = size;
+
+#ifdef MVE_RUNTIME_SIZES
+    MVE_Config config = { DIFFERENTIAL_STACK_SIZE, DIFFERENTIAL_MEMORY_SIZE, DIFFERENTIAL_SCOPE_LIMIT, buffer_size };
+    uint32_t storage_size = DIFFERENTIAL_STACK_SIZE + DIFFERENTIAL_MEMORY_SIZE + DIFFERENTIAL_SCOPE_LIMIT * sizeof(MVE_Scope_Info) + buffer_size + 8 * MVE_CACHE_LINE_SIZE;
+    static MVE_Arena arena;
+
+    free(engine_storage);
+    engine_storage = calloc(storage_size, 1);
+
+    mve_arena_init(&arena, engine_storage, storage_size);
+    mve_configure(&engine_vm, &config, &arena);
+#else
+    (void) buffer_size;
+#endif
+
+#ifdef MVE_LOCAL_PROGRAM
+    if (!mve_init(&engine_vm, (uint8_t *) program))
+        return -1;
+#else
+    if (!mve_init(&engine_vm, engine_load_next_block))
+        return -1;
+#endif
+
+    // The names of the external functions are at the start of the memory, as loaded from the header.
+    uint32_t index = 0;
+
+    for (uint32_t i = 0; i < engine_vm.external_functions_count; i++) {
+        const char *name = (const char *) engine_vm.memory + index;
+
+        mve_link_function(&engine_vm, name, engine_external_function);
+        index += strlen(name) + 1;
+    }
+
+    memset(engine_region, 0, sizeof(engine_region));
+
+    for (uint32_t i = 0; i < DIFFERENTIAL_REGION_SIZE; i++)
+        engine_constants[i] = (uint8_t) (i * 37 + 11);
+
+    mve_link_region(&engine_vm, 0, engine_region, DIFFERENTIAL_REGION_SIZE, MVE_TRUE);
+    mve_link_region(&engine_vm, 1, engine_constants, DIFFERENTIAL_REGION_SIZE, MVE_FALSE);
+
+    mve_start(&engine_vm);
+
+    return 0;
+}
+
+
+static void engine_state(Engine_State *state)
+{
+    memset(state, 0, sizeof(Engine_State));
+
+    state->program_index = mve_get_program_index(&engine_vm);
+    state->is_running = engine_vm.is_running;
+    state->scope_index = engine_vm.scope_index;
+    state->stack = engine_vm.stack;
+    state->memory = engine_vm.memory;
+    state->stack_size = MVE_VM_STACK_SIZE((&engine_vm));
+    state->memory_size = MVE_VM_MEMORY_SIZE((&engine_vm));
+    state->region = engine_region;
+
+    for (uint32_t i = 0; i < DIFFERENTIAL_REGISTERS; i++)
+        state->registers[i] = engine_vm.registers.all[i].i;
+
+    for (uint32_t i = 0; i < MVE_VM_SCOPE_LIMIT((&engine_vm)) && i < DIFFERENTIAL_SCOPE_LIMIT; i++) {
+        state->return_indexes[i] = engine_vm.scopes[i].program_index;
+        state->stack_bases[i] = engine_vm.scopes[i].stack_base;
+    }
+
+    state->frame_index = engine_vm.frame_index;
+
+    for (uint32_t i = 0; i < engine_vm.frame_index && i < DIFFERENTIAL_FRAME_LIMIT; i++) {
+        state->frame_returns[i] = engine_vm.frames[i].return_index;
+        state->frame_scopes[i] = engine_vm.frames[i].scope_index;
+    }
+}
+
+
+#ifdef DIFFERENTIAL_AOT
+
+static void (*engine_fun_step)(uint32_t program_index);
+static uint32_t engine_program_index;
+
+#define MVE_AOT_STEP(vm, program_index) (engine_program_index = program_index, engine_fun_step(program_index))
+
+void differential_run(MVE_VM *vm);
+
+
+static void engine_run(void (*fun_step)(uint32_t program_index))
+{
+    engine_fun_step = fun_step;
+    differential_run(&engine_vm);
+}
+
+
+// The compiled program does not move the program index of the VM.
+static void engine_aot_state(Engine_State *state)
+{
+    engine_state(state);
+    state->program_index = engine_program_index;
+}
+
+
+const Engine ENGINE = { ENGINE_NAME, engine_load, NULL, engine_run, engine_aot_state };
+
+#else
+
+static void engine_step(void)
+{
+    mve_run(&engine_vm);
+}
+
+
+const Engine ENGINE = { ENGINE_NAME, engine_load, engine_step, NULL, engine_state };
+
+#endif
+
+#endif
@@ -0,0 +1,507 @@
+#ifndef MVE_TOOLS_DIFFERENTIAL_GENERATOR_H
+#define MVE_TOOLS_DIFFERENTIAL_GENERATOR_H
+
+/**
+ * Generates random programs that are valid on every engine, so any difference between them is a bug of an engine.
+ *
+ *  - Only r0 to r4 are written. sp and mp are only changed by the instructions that manage them.
+ *  - Stack addresses are inside the main scope, or inside the current scope when relative. Lengths are 1 to 4 bytes.
+ *  - Divisors are never 0, and shifts are smaller than 32.
+ *  - Every PUSH has its POP, every SCOPE has its END or a RET that ends it, and there is never an END on the main scope.
+ *  - Loops count down a register which their body does not write, with LOOP or with DEC and JNZ,
+ *    and functions only call the functions after them, so every program ends.
+ *
+ * LDX and STX access the regions inside their bounds, and STX only writes into region 0.
+ *
+ * SWITCH goes to blocks that all jump to the end of the statement, like a C switch with a break in each case.
+ *
+ * Functions keep a random set of registers with PUSHM and POPM. A call is only done when it keeps every register
+ * a loop around it depends on. Some functions are called with FCALL instead of CALL, and may have no scope,
+ * return early outside of PUSH/POP pairs, or end with a TCALL to a later function that keeps at least the same registers.
+ */
+
+#include "../common/program.h"
+
+#define GENERATOR_REGISTERS 5                   // r0 to r4.
+#define GENERATOR_ALL_REGISTERS ((1 << GENERATOR_REGISTERS) - 1)
+#define GENERATOR_FUNCTIONS 4
+#define GENERATOR_DEPTH 3                       // Maximum nesting of conditions, loops, scopes and PUSH/POP pairs.
+#define GENERATOR_MAIN_SCOPE 64                 // Size of the main scope, addressed with absolute addresses.
+#define GENERATOR_MIN_SCOPE 8                   // Smallest scope, which the functions without a scope address relatively.
+#define GENERATOR_REGION_SIZE 64                // Size of the regions linked by the engines. Region 0 is writable and region 1 is read only.
+
+
+typedef struct {
+    Program *program;
+    uint32_t random;                            // State of the xorshift generator.
+
+    uint32_t *call_sites;                       // CALL, FCALL and TCALL instructions, which target is set once the functions are generated.
+    uint8_t *call_functions;
+    uint32_t calls_count;
+
+    uint32_t functions[GENERATOR_FUNCTIONS];    // First instruction of each function.
+    uint8_t preserved[GENERATOR_FUNCTIONS];     // Registers kept by each function, as a mask.
+    uint8_t framed[GENERATOR_FUNCTIONS];        // If each function is called with FCALL and returns with RET.
+    uint32_t pushes;                            // PUSH and PUSHM not popped yet, around the statement being generated.
+} Generator;
+
+
+static uint32_t generator_random(Generator *generator, uint32_t limit)
+{
+    uint32_t x = generator->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    generator->random = x;
+
+    return x % limit;
+}
+
+
+/**
+ * @brief Returns a random register out of a mask, or -1 if the mask is empty.
+ */
+static int generator_pick(Generator *generator, uint8_t mask)
+{
+    int count = 0;
+
+    for (int i = 0; i < GENERATOR_REGISTERS; i++)
+        count += (mask >> i) & 1;
+
+    if (count == 0)
+        return -1;
+
+    int n = generator_random(generator, count);
+
+    for (int i = 0; i < GENERATOR_REGISTERS; i++) {
+        if (((mask >> i) & 1) && n-- == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+
+static Program_Instruction *generator_emit(Generator *generator, uint8_t operation, uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+{
+    Program_Instruction *instruction = program_append(generator->program, operation);
+
+    instruction->values[0] = a;
+    instruction->values[1] = b;
+    instruction->values[2] = c;
+    instruction->values[3] = d;
+
+    return instruction;
+}
+
+
+static void generator_ldi(Generator *generator, int reg, uint32_t value, uint8_t length)
+{
+    Program_Instruction *instruction = generator_emit(generator, MVE_OP_LDI, reg, length < 4 ? value & ((1u << (length * 8)) - 1) : value, 0, 0);
+
+    instruction->lengths[1] = length;
+}
+
+
+/**
+ * @brief Returns a stack address for an access of length bytes, absolute in the main scope or relative to the current scope.
+ */
+static int32_t generator_stack_address(Generator *generator, uint32_t scope_size, uint8_t length)
+{
+    if (generator_random(generator, 2) == 0)
+        return generator_random(generator, GENERATOR_MAIN_SCOPE - length + 1);
+
+    return -(int32_t) (length + generator_random(generator, scope_size - length + 1));
+}
+
+
+static void generator_block(Generator *generator, uint32_t depth, uint8_t protected_registers, uint32_t scope_size, int function);
+
+
+/**
+ * @brief Emits a CALL, FCALL or TCALL to a function, which target is set once the functions are generated.
+ */
+static void generator_call(Generator *generator, uint8_t operation, int callee)
+{
+    generator->call_sites = realloc(generator->call_sites, (generator->calls_count + 1) * sizeof(uint32_t));
+    generator->call_functions = realloc(generator->call_functions, generator->calls_count + 1);
+    generator->call_sites[generator->calls_count] = generator->program->count;
+    generator->call_functions[generator->calls_count++] = callee;
+
+    generator_emit(generator, operation, 0, 0, 0, 0);
+}
+
+
+/**
+ * @brief Generates a single statement, which can be a sequence of instructions.
+ *
+ * @param depth Nesting of the statement.
+ * @param protected_registers Registers that must not be written, as a mask.
+ * @param scope_size Size of the current scope.
+ * @param function Index of the function being generated, or -1 for the main code.
+ */
+static void generator_statement(Generator *generator, uint32_t depth, uint8_t protected_registers, uint32_t scope_size, int function)
+{
+    Program *program = generator->program;
+    uint8_t free_registers = GENERATOR_ALL_REGISTERS & ~protected_registers;
+    int rd = generator_pick(generator, free_registers);
+    int ra = generator_random(generator, GENERATOR_REGISTERS);
+    int rb = generator_random(generator, GENERATOR_REGISTERS);
+    int rt = generator_pick(generator, free_registers & ~(1 << rd));
+    uint8_t length = 1 + generator_random(generator, 4);
+    uint32_t kind = generator_random(generator, depth < GENERATOR_DEPTH ? 28 : 17);
+
+    static const uint8_t binary[] = { MVE_OP_ADD, MVE_OP_SUB, MVE_OP_MUL, MVE_OP_AND, MVE_OP_ORR, MVE_OP_XOR };
+
+    // Every statement needs a free register, except STS.
+    if (rd < 0)
+        kind = 6;
+
+    // The ones needing a second free register become a simple operation.
+    if (rt < 0 && (kind == 3 || kind == 4 || kind == 7 || kind == 8 || kind == 19 || kind == 24 || kind == 25 || kind == 26))
+        kind = 0;
+
+    switch (kind)
+    {
+    case 0: case 1: case 2:
+        generator_emit(generator, binary[generator_random(generator, sizeof(binary))], rd, ra, rb, 0);
+        break;
+    case 3:
+        generator_ldi(generator, rt, 1, 1);
+        generator_emit(generator, MVE_OP_ORR, rt, rt, rb, 0);
+        generator_emit(generator, MVE_OP_DIV, rd, ra, rt, 0);
+        break;
+    case 4:
+        generator_ldi(generator, rt, generator_random(generator, 32), 1);
+        generator_emit(generator, generator_random(generator, 2) ? MVE_OP_LSL : MVE_OP_LSR, rd, ra, rt, 0);
+        break;
+    case 5:
+        generator_emit(generator, MVE_OP_LDS, rd, (uint32_t) generator_stack_address(generator, scope_size, length), length, 0);
+        break;
+    case 6:
+        generator_emit(generator, MVE_OP_STS, ra, (uint32_t) generator_stack_address(generator, scope_size, length), length, 0);
+        break;
+    case 7: case 8:
+        generator_ldi(generator, rt, (uint32_t) generator_stack_address(generator, scope_size, length), 4);
+        generator_ldi(generator, rd, length, 1);
+        generator_emit(generator, kind == 7 ? MVE_OP_LDR : MVE_OP_STR, kind == 7 ? rd : ra, rt, rd, 0);
+        break;
+    case 9:
+        generator_ldi(generator, rd, generator_random(generator, UINT32_MAX), generator_random(generator, 5));
+        break;
+    case 10:
+        generator_emit(generator, MVE_OP_MOV, rd, ra, 0, 0);
+        break;
+    case 11:
+        generator_emit(generator, MVE_OP_NOT, rd, ra, 0, 0);
+        break;
+    case 12:
+    {
+        static const uint8_t unary[] = { MVE_OP_NEG, MVE_OP_INC, MVE_OP_DEC };
+
+        generator_emit(generator, unary[generator_random(generator, sizeof(unary))], rd, 0, 0, 0);
+        break;
+    }
+    case 13: case 14:
+        generator_emit(generator, MVE_OP_CMP, generator_random(generator, MVE_CMP_LESSEQUAL + 1), rd, ra, rb);
+        break;
+    case 15:
+        generator_emit(generator, MVE_OP_LADR, rd, (uint32_t) generator_stack_address(generator, scope_size, 1), 0, 0);
+        break;
+    case 16:
+        // The external function writes r0.
+        if ((protected_registers & 1) == 0)
+            generator_emit(generator, MVE_OP_INVOKE, 0, 0, 0, 0);
+        break;
+    case 17:
+    {
+        // if (ra == 0) { ... }
+        uint32_t jump = program->count;
+
+        generator_emit(generator, MVE_OP_JNZ, ra, 0, 0, 0);
+        generator_block(generator, depth + 1, protected_registers, scope_size, function);
+        program->code[jump].target = program->count;
+        break;
+    }
+    case 18:
+    {
+        // if (ra != 0) { ... } else { ... }
+        uint32_t jump = program->count;
+
+        generator_emit(generator, MVE_OP_JNZ, ra, 0, 0, 0);
+        generator_block(generator, depth + 1, protected_registers, scope_size, function);
+
+        uint32_t skip = program->count;
+
+        generator_emit(generator, MVE_OP_JMP, 0, 0, 0, 0);
+        program->code[jump].target = program->count;
+        generator_block(generator, depth + 1, protected_registers, scope_size, function);
+        program->code[skip].target = program->count;
+        break;
+    }
+    case 19:
+    {
+        // A counted loop, with rd as the counter. rt is only taken so another register stays free for the body.
+        generator_ldi(generator, rd, 1 + generator_random(generator, 6), 1);
+
+        uint32_t start = program->count;
+
+        generator_block(generator, depth + 1, protected_registers | (1 << rd), scope_size, function);
+
+        if (generator_random(generator, 2) == 0)
+        {
+            generator_emit(generator, MVE_OP_LOOP, rd, 0, 0, 0)->target = start;
+            break;
+        }
+
+        generator_emit(generator, MVE_OP_DEC, rd, 0, 0, 0);
+        generator_emit(generator, MVE_OP_JNZ, rd, 0, 0, 0)->target = start;
+        break;
+    }
+    case 20:
+    {
+        uint32_t data_length = generator_random(generator, 17);
+        uint32_t zero_length = 8 + generator_random(generator, 25);
+        Program_Instruction *instruction = generator_emit(generator, MVE_OP_SCOPE, 0, 0, 0, 0);
+
+        instruction->data = malloc(data_length > 0 ? data_length : 1);
+        instruction->data_length = data_length;
+        instruction->zero_length = zero_length;
+
+        for (uint32_t i = 0; i < data_length; i++)
+            instruction->data[i] = generator_random(generator, 256);
+
+        generator_block(generator, depth + 1, protected_registers, data_length + zero_length, function);
+        generator_emit(generator, MVE_OP_END, 0, 0, 0, 0);
+        break;
+    }
+    case 21:
+        generator_emit(generator, MVE_OP_PUSH, ra, length, 0, 0);
+        generator->pushes++;
+        generator_block(generator, depth + 1, protected_registers, scope_size, function);
+        generator->pushes--;
+        generator_emit(generator, MVE_OP_POP, rd, length, 0, 0);
+        break;
+    case 22:
+    {
+        uint8_t mask = free_registers & (1 + generator_random(generator, GENERATOR_ALL_REGISTERS));
+
+        if (mask == 0)
+            break;
+
+        generator_emit(generator, MVE_OP_PUSHM, mask, length, 0, 0);
+        generator->pushes++;
+        generator_block(generator, depth + 1, protected_registers, scope_size, function);
+        generator->pushes--;
+        generator_emit(generator, MVE_OP_POPM, mask, length, 0, 0);
+        break;
+    }
+    case 23:
+    {
+        // if (ra == 0) return; RET ends the scopes of the function, but the memory must be as on entry.
+        if (function < 0 || !generator->framed[function] || generator->pushes > 0)
+            break;
+
+        uint32_t jump = program->count;
+
+        generator_emit(generator, MVE_OP_JNZ, ra, 0, 0, 0);
+
+        if (generator->preserved[function] != 0)
+            generator_emit(generator, MVE_OP_POPM, generator->preserved[function], sizeof(MVE_Value), 0, 0);
+
+        generator_emit(generator, MVE_OP_RET, 0, 0, 0, 0);
+        program->code[jump].target = program->count;
+        break;
+    }
+    case 24:
+    {
+        // switch (ra & 7), with up to 5 cases, some of them sharing a block, and the rest going to the default block.
+        uint32_t cases = 1 + generator_random(generator, 5);
+        uint32_t blocks[6];
+        uint32_t skips[6];
+
+        generator_ldi(generator, rt, 7, 1);
+        generator_emit(generator, MVE_OP_AND, rt, ra, rt, 0);
+
+        uint32_t table = program->count;
+
+        generator_emit(generator, MVE_OP_SWITCH, rt, 0, cases, 0);
+
+        // The last block is the default.
+        for (uint32_t k = 0; k <= cases; k++) {
+            blocks[k] = program->count;
+            generator_block(generator, depth + 1, protected_registers, scope_size, function);
+            skips[k] = program->count;
+            generator_emit(generator, MVE_OP_JMP, 0, 0, 0, 0);
+        }
+
+        for (uint32_t k = 0; k <= cases; k++)
+            program->code[skips[k]].target = program->count;
+
+        program->code[table].target = blocks[cases];
+
+        for (uint32_t k = 0; k < cases; k++)
+            program_add_case(&program->code[table], 0, blocks[generator_random(generator, cases + 1)]);
+        break;
+    }
+    case 25:
+    {
+        // The byte instructions, with addresses and lengths below 32, so every range is inside the main scope.
+        generator_ldi(generator, rt, generator_random(generator, 32), 1);
+        generator_ldi(generator, rd, generator_random(generator, 32), 1);
+
+        switch (generator_random(generator, 4))
+        {
+        case 0:
+            generator_emit(generator, MVE_OP_STRLEN, rd, rt, 0, 0);
+            break;
+        case 1:
+            generator_emit(generator, MVE_OP_FINDBYTE, rd, rt, rd, ra);
+            break;
+        case 2:
+            generator_emit(generator, MVE_OP_MEMCMP, rd, rt, rd, rt);
+            break;
+        default:
+            generator_emit(generator, MVE_OP_CRC32C, rd, rt, rt, 0);
+            break;
+        }
+        break;
+    }
+    case 26:
+    {
+        uint32_t region = generator_random(generator, 2);
+
+        generator_ldi(generator, rt, generator_random(generator, GENERATOR_REGION_SIZE - length + 1), 1);
+        generator_ldi(generator, rd, length, 1);
+
+        switch (generator_random(generator, 3))
+        {
+        case 0:
+            generator_emit(generator, MVE_OP_LDX, rd, region, rt, rd);
+            break;
+        case 1:
+            generator_emit(generator, MVE_OP_STX, ra, 0, rt, rd);
+            break;
+        default:
+            // Region 2 is not linked, so XLEN gives 0.
+            generator_emit(generator, MVE_OP_XLEN, rd, generator_random(generator, 3), 0, 0);
+            break;
+        }
+        break;
+    }
+    default:
+    {
+        // Calls a later function that keeps every protected register.
+        int callee = function + 1 + generator_random(generator, GENERATOR_FUNCTIONS);
+
+        if (callee >= GENERATOR_FUNCTIONS || (generator->preserved[callee] & protected_registers) != protected_registers)
+            break;
+
+        generator_call(generator, generator->framed[callee] ? MVE_OP_FCALL : MVE_OP_CALL, callee);
+        break;
+    }
+    }
+}
+
+
+static void generator_block(Generator *generator, uint32_t depth, uint8_t protected_registers, uint32_t scope_size, int function)
+{
+    uint32_t count = 1 + generator_random(generator, depth == 0 ? 24 : 8);
+
+    for (uint32_t i = 0; i < count; i++)
+        generator_statement(generator, depth, protected_registers, scope_size, function);
+}
+
+
+/**
+ * @brief Generates a random program.
+ *
+ * @param program Receives the program, which must be freed.
+ * @param seed Seed of the random generator. The same seed gives the same program.
+ */
+static void generator_program(Program *program, uint32_t seed)
+{
+    Generator generator;
+
+    memset(&generator, 0, sizeof(Generator));
+    generator.program = program;
+    generator.random = seed * 2654435761u + 1;
+
+    program_init(program);
+    program_add_name(program, "host");
+
+    program->data_length = generator_random(&generator, 17);
+    program->zero_length = GENERATOR_MAIN_SCOPE - program->data_length;
+    program->data = malloc(program->data_length > 0 ? program->data_length : 1);
+
+    for (uint32_t i = 0; i < program->data_length; i++)
+        program->data[i] = generator_random(&generator, 256);
+
+    // The registers kept by a function are pushed with the whole size of a value, so POPM restores them.
+    for (int i = 0; i < GENERATOR_FUNCTIONS; i++) {
+        generator.preserved[i] = generator_random(&generator, GENERATOR_ALL_REGISTERS + 1);
+        generator.framed[i] = generator_random(&generator, 2);
+    }
+
+    generator_block(&generator, 0, 0, GENERATOR_MAIN_SCOPE, -1);
+    generator_emit(&generator, MVE_OP_EOP, 0, 0, 0, 0);
+
+    for (int i = 0; i < GENERATOR_FUNCTIONS; i++) {
+        uint32_t scope_size = GENERATOR_MIN_SCOPE + generator_random(&generator, 25);
+        MVEbool has_scope = !generator.framed[i] || generator_random(&generator, 2);
+
+        generator.functions[i] = program->count;
+
+        // Without a scope, the function addresses the scope of its caller, which has at least GENERATOR_MIN_SCOPE bytes.
+        if (has_scope)
+        {
+            Program_Instruction *scope = generator_emit(&generator, MVE_OP_SCOPE, 0, 0, 0, 0);
+
+            scope->data = malloc(1);
+            scope->zero_length = scope_size;
+        }
+        else
+        {
+            scope_size = GENERATOR_MIN_SCOPE;
+        }
+
+        if (generator.preserved[i] != 0)
+            generator_emit(&generator, MVE_OP_PUSHM, generator.preserved[i], sizeof(MVE_Value), 0, 0);
+
+        generator_block(&generator, 1, 0, scope_size, i);
+
+        if (generator.preserved[i] != 0)
+            generator_emit(&generator, MVE_OP_POPM, generator.preserved[i], sizeof(MVE_Value), 0, 0);
+
+        if (!generator.framed[i])
+        {
+            generator_emit(&generator, MVE_OP_END, 0, 0, 0, 0);
+            continue;
+        }
+
+        // The callee of a TCALL returns to the caller of this function, so it must keep the same registers.
+        int callee = i + 1 + generator_random(&generator, GENERATOR_FUNCTIONS);
+
+        if (callee < GENERATOR_FUNCTIONS && generator.framed[callee] && (generator.preserved[callee] & generator.preserved[i]) == generator.preserved[i])
+        {
+            generator_call(&generator, MVE_OP_TCALL, callee);
+            continue;
+        }
+
+        // RET also ends the scope, so the END is optional.
+        if (has_scope && generator_random(&generator, 2))
+            generator_emit(&generator, MVE_OP_END, 0, 0, 0, 0);
+
+        generator_emit(&generator, MVE_OP_RET, 0, 0, 0, 0);
+    }
+
+    for (uint32_t i = 0; i < generator.calls_count; i++)
+        program->code[generator.call_sites[i]].target = generator.functions[generator.call_functions[i]];
+
+    free(generator.call_sites);
+    free(generator.call_functions);
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include <dlfcn.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Runs the same program on every engine in lockstep, comparing the registers, the stack, the memory, the writable region and the scopes
+ * with the reference interpreter before each instruction, or with -b only at the start of each basic block.
+ *
+ * The engines are the interpreter with the whole program in memory, which is the reference, the interpreter loading
+ * the program in blocks of -w bytes, the interpreter with growable scopes and frames, and with -c the program compiled by tools/aot, built with the given C compiler
+ * and loaded as a shared library. The compiled program calls back before each instruction, which steps the interpreters.
+ *
+ * Without program files, it runs -n random programs from the seed given by -s. The first program that differs
+ * is written to -o, to be disassembled or run again. Programs taking more than -m instructions are skipped.
+ *
+ * Usage: differential [-n count] [-s seed] [-w buffer] [-m max] [-b] [-c compiler] [-o failed] [program files]
+ */
+
+#include "../aot/aot.h"
+#include "../common/files.h"
+#include "engine.h"
+#include "generator.h"
+
+#define DIFFERENTIAL_ENGINES 4
+
+
+typedef struct {
+    uint32_t buffer_size;
+    uint64_t max_steps;
+    MVEbool blocks;
+    const char *compiler;
+    const char *failed;
+} Options;
+
+
+static const Engine *engines[DIFFERENTIAL_ENGINES];
+static uint32_t engines_count;
+static uint8_t *leaders;                        // Program indexes where a basic block starts, compared with -b.
+static uint32_t program_size;
+static uint64_t steps;
+static uint64_t max_steps;
+static MVEbool blocks;
+static MVEbool differs;
+static jmp_buf stop_jump;
+
+
+/**
+ * @brief Compares the state of an engine with the reference.
+ *
+ * @return Returns true if they are the same, or writes the first difference.
+ */
+static MVEbool compare(const Engine_State *reference, const Engine_State *state, char *difference, uint32_t size)
+{
+    if (reference->is_running != state->is_running)
+    {
+        snprintf(difference, size, "is %s running", state->is_running ? "still" : "not");
+        return MVE_FALSE;
+    }
+
+    if (reference->is_running && reference->program_index != state->program_index)
+    {
+        snprintf(difference, size, "program index %u instead of %u", state->program_index, reference->program_index);
+        return MVE_FALSE;
+    }
+
+    for (uint32_t i = 0; i < DIFFERENTIAL_REGISTERS; i++) {
+        if (reference->registers[i] != state->registers[i])
+        {
+            snprintf(difference, size, "register %u is %llu instead of %llu", i, (unsigned long long) state->registers[i], (unsigned long long) reference->registers[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    if (reference->scope_index != state->scope_index)
+    {
+        snprintf(difference, size, "scope index %u instead of %u", state->scope_index, reference->scope_index);
+        return MVE_FALSE;
+    }
+
+    // The next scope has the program index stored by a CALL, before its SCOPE.
+    for (uint32_t i = 0; i <= reference->scope_index + 1 && i < DIFFERENTIAL_SCOPE_LIMIT; i++) {
+        if (reference->return_indexes[i] != state->return_indexes[i] || reference->stack_bases[i] != state->stack_bases[i])
+        {
+            snprintf(difference, size, "scope %u goes back to %u with base %u instead of %u with base %u",
+                i, state->return_indexes[i], state->stack_bases[i], reference->return_indexes[i], reference->stack_bases[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    if (reference->frame_index != state->frame_index)
+    {
+        snprintf(difference, size, "frame index %u instead of %u", state->frame_index, reference->frame_index);
+        return MVE_FALSE;
+    }
+
+    for (uint32_t i = 0; i < reference->frame_index; i++) {
+        if (reference->frame_returns[i] != state->frame_returns[i] || reference->frame_scopes[i] != state->frame_scopes[i])
+        {
+            snprintf(difference, size, "frame %u goes back to %u in scope %u instead of %u in scope %u",
+                i, state->frame_returns[i], state->frame_scopes[i], reference->frame_returns[i], reference->frame_scopes[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    // Only the runtime sized engines follow the sizes asked by the program, so the bytes after the smallest size are not compared.
+    for (uint32_t i = 0; i < reference->stack_size && i < state->stack_size; i++) {
+        if (reference->stack[i] != state->stack[i])
+        {
+            snprintf(difference, size, "stack[%u] is %u instead of %u", i, state->stack[i], reference->stack[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    for (uint32_t i = 0; i < reference->memory_size && i < state->memory_size; i++) {
+        if (reference->memory[i] != state->memory[i])
+        {
+            snprintf(difference, size, "memory[%u] is %u instead of %u", i, state->memory[i], reference->memory[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    for (uint32_t i = 0; i < DIFFERENTIAL_REGION_SIZE; i++) {
+        if (reference->region[i] != state->region[i])
+        {
+            snprintf(difference, size, "region[%u] is %u instead of %u", i, state->region[i], reference->region[i]);
+            return MVE_FALSE;
+        }
+    }
+
+    return MVE_TRUE;
+}
+
+
+/**
+ * @brief Compares every engine with the reference. Stops the run at the first difference.
+ */
+static void check(void)
+{
+    Engine_State reference;
+
+    engines[0]->state(&reference);
+
+    if (blocks && reference.is_running && reference.program_index <= program_size && !leaders[reference.program_index])
+        return;
+
+    for (uint32_t i = 1; i < engines_count; i++) {
+        Engine_State state;
+        char difference[160];
+
+        engines[i]->state(&state);
+
+        if (!compare(&reference, &state, difference, sizeof(difference)))
+        {
+            printf("The %s engine differs after %llu instructions, at program index %u: %s.\n",
+                engines[i]->name, (unsigned long long) steps, reference.program_index, difference);
+
+            differs = MVE_TRUE;
+            longjmp(stop_jump, 1);
+        }
+    }
+}
+
+
+/**
+ * @brief Compares the engines, then runs an instruction on each interpreter.
+ */
+static void step(uint32_t program_index)
+{
+    (void) program_index;
+
+    check();
+
+    if (++steps > max_steps)
+        longjmp(stop_jump, 1);
+
+    for (uint32_t i = 0; i < engines_count; i++) {
+        if (engines[i]->step != NULL)
+            engines[i]->step();
+    }
+}
+
+
+/**
+ * @brief Marks the start of each basic block: the jump targets and the instructions after a jump or END.
+ */
+static void mark_leaders(const uint8_t *bytes, uint32_t size)
+{
+    Program program;
+
+    leaders = calloc(size + 1, 1);
+
+    if (program_decode(&program, bytes, size) != 0)
+    {
+        program_free(&program);
+        return;
+    }
+
+    for (uint32_t i = 0; i < program.count; i++) {
+        const Program_Instruction *instruction = &program.code[i];
+
+        for (uint32_t j = 0; j < program_jumps_count(instruction); j++) {
+            if (program_jump(instruction, j) < program.count)
+                leaders[program.code[program_jump(instruction, j)].offset] = 1;
+        }
+
+        switch (instruction->operation)
+        {
+        case MVE_OP_JMP: case MVE_OP_JNZ: case MVE_OP_LOOP: case MVE_OP_CALL: case MVE_OP_END:
+        case MVE_OP_FCALL: case MVE_OP_RET: case MVE_OP_TCALL: case MVE_OP_SWITCH:
+            if (i + 1 < program.count)
+                leaders[program.code[i + 1].offset] = 1;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (program.count > 0)
+        leaders[program.code[0].offset] = 1;
+
+    program_free(&program);
+}
+
+
+/**
+ * @brief Compiles a program with tools/aot and the C compiler, and loads it as an engine.
+ *
+ * @return Returns the shared library, or NULL if it cannot be built.
+ */
+static void *load_compiled(const uint8_t *bytes, uint32_t size, const char *compiler, const Engine **engine)
+{
+    char directory[] = "/tmp/differentialXXXXXX";
+    char path[512];
+    char command[2048];
+    Program program;
+
+    if (mkdtemp(directory) == NULL || program_decode(&program, bytes, size) != 0)
+        return NULL;
+
+    snprintf(path, sizeof(path), "%s/program.c", directory);
+
+    FILE *out = fopen(path, "w");
+    MVEbool compiled = out != NULL && aot_compile(&program, bytes, size, "differential", "the differential harness", out);
+
+    if (out != NULL)
+        fclose(out);
+
+    program_free(&program);
+
+    snprintf(path, sizeof(path), "%s/engine.c", directory);
+    out = compiled ? fopen(path, "w") : NULL;
+
+    if (out != NULL)
+    {
+        fprintf(out, "#define ENGINE engine_aot\n#define ENGINE_NAME \"aot\"\n\n#define MVE_LOCAL_PROGRAM\n#define DIFFERENTIAL_AOT\n\n");
+        fprintf(out, "#include \"%s/engine_vm.h\"\n#include \"program.c\"\n", DIFFERENTIAL_SOURCE_DIR);
+        fclose(out);
+
+        snprintf(command, sizeof(command), "%s -O1 -shared -fPIC -I%s/../../src %s/engine.c -o %s/engine.so", compiler, DIFFERENTIAL_SOURCE_DIR, directory, directory);
+        compiled = system(command) == 0;
+    }
+
+    void *library = NULL;
+
+    if (compiled)
+    {
+        snprintf(path, sizeof(path), "%s/engine.so", directory);
+        library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        *engine = library != NULL ? dlsym(library, "engine_aot") : NULL;
+    }
+
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+
+    if (system(command) != 0)
+        fprintf(stderr, "Cannot remove %s.\n", directory);
+
+    return library;
+}
+
+
+/**
+ * @brief Runs a program on every engine.
+ *
+ * @return Returns 0 if they all match, 1 if one differs, or -1 if the program cannot run.
+ */
+static int run(const uint8_t *bytes, uint32_t size, const Options *options)
+{
+    void *library = NULL;
+    const Engine *compiled = NULL;
+
+    engines_count = 0;
+    engines[engines_count++] = &engine_local;
+    engines[engines_count++] = &engine_stream;
+    engines[engines_count++] = &engine_growable;
+
+    if (options->compiler != NULL)
+    {
+        library = load_compiled(bytes, size, options->compiler, &compiled);
+
+        if (compiled == NULL)
+        {
+            fprintf(stderr, "Cannot compile the program with %s.\n", options->compiler);
+
+            if (library != NULL)
+                dlclose(library);
+
+            return -1;
+        }
+
+        engines[engines_count++] = compiled;
+    }
+
+    for (uint32_t i = 0; i < engines_count; i++) {
+        if (engines[i]->load(bytes, size, options->buffer_size) != 0)
+        {
+            fprintf(stderr, "The %s engine cannot load the program.\n", engines[i]->name);
+
+            if (library != NULL)
+                dlclose(library);
+
+            return -1;
+        }
+    }
+
+    mark_leaders(bytes, size);
+    program_size = size;
+    steps = 0;
+    max_steps = options->max_steps;
+    blocks = options->blocks;
+    differs = MVE_FALSE;
+
+    if (setjmp(stop_jump) == 0)
+    {
+        Engine_State reference;
+
+        if (compiled != NULL)
+        {
+            compiled->run(step);
+        }
+        else
+        {
+            engines[0]->state(&reference);
+
+            while (reference.is_running) {
+                step(reference.program_index);
+                engines[0]->state(&reference);
+            }
+        }
+
+        // The final state is always compared.
+        blocks = MVE_FALSE;
+        check();
+    }
+
+    free(leaders);
+
+    if (library != NULL)
+        dlclose(library);
+
+    if (!differs && steps > max_steps)
+    {
+        fprintf(stderr, "Skipped, since it runs more than %llu instructions.\n", (unsigned long long) max_steps);
+        return -1;
+    }
+
+    return differs ? 1 : 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    Options options = { 64, 1000000, MVE_FALSE, NULL, "differential_failed.bin" };
+    uint32_t count = 100;
+    uint32_t seed = 1;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            options.buffer_size = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            options.max_steps = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0)
+            options.blocks = MVE_TRUE;
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            options.compiler = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            options.failed = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "Usage: %s [-n count] [-s seed] [-w buffer] [-m max] [-b] [-c compiler] [-o failed] [program files]\n", argv[0]);
+            return 1;
+        }
+        else
+            argv[files++] = argv[i];
+    }
+
+    if (options.buffer_size < 32)
+    {
+        fprintf(stderr, "The buffer must have at least 32 bytes.\n");
+        return 1;
+    }
+
+    uint32_t passed = 0;
+    uint32_t skipped = 0;
+    uint64_t instructions = 0;
+    uint32_t total = files > 0 ? (uint32_t) files : count;
+
+    for (uint32_t i = 0; i < total; i++) {
+        uint8_t *bytes;
+        uint32_t size;
+
+        if (files > 0)
+        {
+            bytes = files_read(argv[i], &size);
+
+            if (bytes == NULL)
+            {
+                fprintf(stderr, "Cannot read %s.\n", argv[i]);
+                skipped++;
+                continue;
+            }
+
+            printf("%s\n", argv[i]);
+        }
+        else
+        {
+            Program program;
+
+            generator_program(&program, seed + i);
+            bytes = program_encode(&program, &size);
+            program_free(&program);
+        }
+
+        int result = run(bytes, size, &options);
+
+        if (result == 1)
+        {
+            if (files == 0)
+                printf("Seed %u. The program is written to %s.\n", seed + i, options.failed);
+
+            if (files == 0 && files_write(options.failed, bytes, size) != 0)
+                fprintf(stderr, "Cannot write %s.\n", options.failed);
+
+            free(bytes);
+            return 1;
+        }
+
+        passed += result == 0;
+        skipped += result != 0;
+        instructions += result == 0 ? steps : 0;
+
+        free(bytes);
+    }
+
+    printf("%u programs match on %u engines, running %llu instructions. %u skipped.\n", passed, engines_count, (unsigned long long) instructions, skipped);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Disassembles bytecode into text, which the assembler reads back into the same bytes.
+ * With -O the peephole optimizations are done first, to see what they change.
+ *
+ * Usage: disassembler [-O] <program file> [-o <output>]
+ */
+
+#include "../common/assembly.h"
+#include "../common/files.h"
+#include "../assembler/peephole.h"
+
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    MVEbool optimize = MVE_FALSE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-O") == 0)
+            optimize = MVE_TRUE;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else
+            input = argv[i];
+    }
+
+    if (input == NULL)
+    {
+        fprintf(stderr, "Usage: %s [-O] <program file> [-o <output>]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t *content = files_read(input, &size);
+
+    if (content == NULL)
+    {
+        fprintf(stderr, "Cannot read %s.\n", input);
+        return 1;
+    }
+
+    Program program;
+    int result = program_decode(&program, content, size);
+
+    free(content);
+
+    if (result != 0)
+    {
+        fprintf(stderr, "%s is not a valid program.\n", input);
+        program_free(&program);
+        return 1;
+    }
+
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+
+    if (out == NULL)
+    {
+        fprintf(stderr, "Cannot write %s.\n", output);
+        program_free(&program);
+        return 1;
+    }
+
+    if (optimize)
+    {
+        Peephole_Stats stats;
+        uint32_t saved = peephole_optimize(&program, &stats);
+
+        fprintf(out, "; Optimized, saving %u bytes.\n", saved);
+    }
+
+    assembly_write(&program, out);
+
+    if (out != stdout)
+        fclose(out);
+
+    program_free(&program);
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define IMAGE_POSIX
+#endif
+
+/**
+ * Keeps images of program files in a cache directory, so they can be loaded with mve_image_load instead of mve_init.
+ * Each image is in a file named by the hash of the program and the fingerprint of the build, so a changed program or a VM built
+ * with other macros uses another file, and stale files are never loaded. On a miss, the program is loaded with mve_init,
+ * and its image is written into a temporary file that is renamed into place, so a concurrent reader never sees a partial image.
+ * Images are memory-mapped when the platform supports it.
+ *
+ * Then both ways of loading the program are timed, with the bytes each one reads from the program, to show what the image saves.
+ *
+ * Usage: image_cache [-d cache directory] [-r runs] <program file>
+ */
+
+#define MVE_USE_IMAGES
+#define MVE_USE_EXPORTS
+#define MVE_EXPORTS_LIMIT 64
+
+#define MVE_BUFFER_SIZE 64
+#define MVE_STACK_SIZE 65536
+#define MVE_MEMORY_SIZE 65536
+#define MVE_EXTERNAL_FUNCTIONS_LIMIT 256
+
+static jmp_buf error_jump;
+
+#define MVE_ERROR_LOG(vm, program_index, error_id, msg) { fprintf(stderr, "%s Program index: %u.\n", msg, (unsigned) (program_index)); longjmp(error_jump, 1); }
+
+#include "../../src/mve.c"
+#include "../common/files.h"
+
+
+static uint8_t *program;
+static uint32_t program_size;
+static unsigned long long bytes_read;
+
+
+void load_next_block(MVE_VM *vm, uint8_t *buffer, uint32_t read_index, uint32_t read_length)
+{
+    (void) vm;
+
+    bytes_read += read_length;
+
+    for (uint32_t i = 0; i < read_length; i++)
+        buffer[i] = read_index + i < program_size ? program[read_index + i] : 0;
+}
+
+
+typedef struct {
+    const void *data;
+    uint32_t size;
+} Image_File;
+
+
+/**
+ * @brief Opens an image file, memory-mapped if possible.
+ * 
+ * @return Returns false if the file does not exist or is empty.
+ */
+static MVEbool image_open(Image_File *image, const char *path)
+{
+    image->data = NULL;
+    image->size = 0;
+
+#ifdef IMAGE_POSIX
+    int file = open(path, O_RDONLY);
+
+    if (file < 0)
+        return MVE_FALSE;
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0 || (uint64_t) info.st_size > UINT32_MAX)
+    {
+        close(file);
+        return MVE_FALSE;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED)
+        return MVE_FALSE;
+
+    image->data = data;
+    image->size = (uint32_t) info.st_size;
+#else
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+        return MVE_FALSE;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = size > 0 ? malloc(size) : NULL;
+
+    if (data == NULL || fread(data, size, 1, file) != 1)
+    {
+        free(data);
+        fclose(file);
+        return MVE_FALSE;
+    }
+
+    fclose(file);
+
+    image->data = data;
+    image->size = (uint32_t) size;
+#endif
+
+    return MVE_TRUE;
+}
+
+
+static void image_close(Image_File *image)
+{
+    if (image->data == NULL)
+        return;
+
+#ifdef IMAGE_POSIX
+    munmap((void *) image->data, image->size);
+#else
+    free((void *) image->data);
+#endif
+
+    image->data = NULL;
+}
+
+
+/**
+ * @brief Writes the image of the program loaded by the VM, through a temporary file renamed into the path.
+ *
+ * @return Returns false if the image cannot be written, or the name of the temporary file does not fit.
+ */
+static MVEbool image_store(MVE_VM *vm, uint64_t program_hash, const char *path)
+{
+    uint32_t size = mve_image_size(vm);
+    uint8_t *image = malloc(size);
+
+    if (image == NULL || mve_image_write(vm, program_hash, image, size) != size)
+    {
+        free(image);
+        return MVE_FALSE;
+    }
+
+#ifdef IMAGE_POSIX
+    long id = (long) getpid();
+#else
+    long id = (long) time(NULL);
+#endif
+
+    // A truncated name could be the path itself, which a concurrent reader would see being written.
+    char temporary[1024];
+    int length = snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, id);
+
+    if (length < 0 || (size_t) length >= sizeof(temporary))
+    {
+        free(image);
+        return MVE_FALSE;
+    }
+
+    FILE *file = fopen(temporary, "wb");
+    MVEbool result = file != NULL && fwrite(image, size, 1, file) == 1;
+
+    if (file != NULL && fclose(file) != 0)
+        result = MVE_FALSE;
+
+    if (result)
+        result = rename(temporary, path) == 0;
+
+    if (!result)
+        remove(temporary);
+
+    free(image);
+
+    return result;
+}
+
+
+int main(int argc, char **argv)
+{
+    static MVE_VM vm;
+    const char *directory = ".";
+    long runs = 100000;
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-d") == 0)
+            directory = argv[first + 1];
+        else if (strcmp(argv[first], "-r") == 0)
+            runs = strtol(argv[first + 1], NULL, 10);
+        else
+            break;
+
+        first += 2;
+    }
+
+    if (first + 1 != argc || runs <= 0)
+    {
+        fprintf(stderr, "Usage: %s [-d cache directory] [-r runs] <program file>\n", argv[0]);
+        return 1;
+    }
+
+    program = files_read(argv[first], &program_size);
+
+    if (program == NULL || program_size == 0)
+    {
+        fprintf(stderr, "Cannot read %s.\n", argv[first]);
+        return 1;
+    }
+
+    if (setjmp(error_jump) != 0)
+    {
+        fprintf(stderr, "%s is not a valid program.\n", argv[first]);
+        return 2;
+    }
+
+    uint64_t program_hash = mve_image_hash(program, program_size);
+    uint64_t config = mve_image_config();
+
+    char path[1024];
+    int length = snprintf(path, sizeof(path), "%s/%016llx-%016llx.mvei", directory, (unsigned long long) program_hash, (unsigned long long) config);
+
+    if (length < 0 || (size_t) length >= sizeof(path))
+    {
+        fprintf(stderr, "The path of the image in %s is too long.\n", directory);
+        return 1;
+    }
+
+    Image_File image;
+    MVEbool hit = image_open(&image, path) && mve_image_load(&vm, &load_next_block, program_hash, image.data, image.size);
+
+    if (!hit)
+    {
+        image_close(&image);
+
+        if (!mve_init(&vm, &load_next_block))
+        {
+            fprintf(stderr, "%s is not a valid program.\n", argv[first]);
+            return 2;
+        }
+
+        if (!image_store(&vm, program_hash, path) || !image_open(&image, path))
+        {
+            fprintf(stderr, "Cannot write %s.\n", path);
+            return 2;
+        }
+    }
+
+    printf("%s %s (%u bytes)\n", hit ? "hit" : "miss", path, image.size);
+
+    bytes_read = 0;
+    clock_t start = clock();
+
+    for (long i = 0; i < runs; i++)
+        mve_init(&vm, &load_next_block);
+
+    clock_t init_time = clock() - start;
+    unsigned long long init_bytes = bytes_read / runs;
+
+    bytes_read = 0;
+    start = clock();
+
+    for (long i = 0; i < runs; i++)
+        mve_image_load(&vm, &load_next_block, program_hash, image.data, image.size);
+
+    clock_t image_time = clock() - start;
+    unsigned long long image_bytes = bytes_read / runs;
+
+    image_close(&image);
+
+    double init_ns = (double) init_time * 1e9 / CLOCKS_PER_SEC / runs;
+    double image_ns = (double) image_time * 1e9 / CLOCKS_PER_SEC / runs;
+
+    printf("%-16s %12s %12s\n", "", "time", "bytes read");
+    printf("%-16s %9.1f ns %12llu\n", "mve_init", init_ns, init_bytes);
+    printf("%-16s %9.1f ns %12llu\n", "mve_image_load", image_ns, image_bytes);
+
+    return 0;
+}
@@ -0,0 +1,617 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Reorders the basic blocks of a program so the blocks that run one after another are next to each other,
+ * which reduces the buffer reloads in streaming mode.
+ *
+ * The profile comes from a binary trace, written by mve_trace_write_binary, or from running the program here.
+ * The hottest edges between blocks become fall throughs, building chains of blocks, like hot loops.
+ * The chains are then placed next to the chains they are most connected to, like callers and callees.
+ * JMPs are added where a fall through was broken, and removed where the target became the next block.
+ *
+ * The reloads before and after are measured by running both programs with a buffer of the given size, as described in tools/common/runner.h.
+ * If the new layout does not reduce the reloads, the program is written unchanged.
+ *
+ * Usage: layout [-w buffer size] [-t trace file] [-n max instructions] <program file> -o <output>
+ */
+
+#define MVE_RUNTIME_SIZES
+#define MVE_LOADER_STATS
+
+#define MVE_STACK_SIZE 65536
+#define MVE_MEMORY_SIZE 65536
+#define MVE_SCOPE_LIMIT 256
+#define MVE_EXTERNAL_FUNCTIONS_LIMIT 256
+#define MVE_USE_BYTE_OPS
+#define MVE_USE_REGIONS
+
+static jmp_buf error_jump;
+
+#define MVE_ERROR_LOG(vm, program_index, error_id, msg) { fprintf(stderr, "  %s Program index: %u.\n", msg, (unsigned) (program_index)); longjmp(error_jump, 1); }
+
+#include "../../src/mve.c"
+#include "../common/files.h"
+#include "../common/program.h"
+#include "../common/runner.h"
+#include "../assembler/peephole.h"
+
+#define LAYOUT_NONE UINT32_MAX
+
+
+typedef struct {
+    uint32_t to;
+    uint64_t count;
+} Layout_Edge;
+
+
+typedef struct {
+    uint32_t first;                             // First instruction.
+    uint32_t last;                              // Last instruction, included.
+    uint32_t fallthrough;                       // Block run when the last instruction does not jump. LAYOUT_NONE after JMP, RET, TCALL, SWITCH and EOP, the amount of blocks at the end of the program.
+    uint32_t jump;                              // Block jumped to by the last instruction, or LAYOUT_NONE. The default of SWITCH, whose cases are only in the edges.
+    uint64_t count;                             // Times the block was entered from its start.
+
+    Layout_Edge *edges;                         // Blocks run after this one, including calls and returns.
+    uint32_t edges_count;
+
+    uint32_t chain;                             // First block of the chain with this block.
+    uint32_t next;                              // Next block in the chain, or LAYOUT_NONE.
+    uint32_t tail;                              // Last block of the chain, only valid in its first block.
+} Layout_Block;
+
+
+typedef struct {
+    Program *program;
+    uint32_t size;
+
+    uint32_t *instruction_at;                   // Instruction starting at each program index, or LAYOUT_NONE.
+    uint32_t *block_of;                         // Block of each instruction.
+
+    Layout_Block *blocks;
+    uint32_t blocks_count;
+
+    uint32_t previous;                          // Instruction run before, while recording the profile.
+} Layout;
+
+
+static uint8_t arena_memory[1 << 20];
+
+
+static MVEbool is_block_end(const Program_Instruction *instruction)
+{
+    switch (instruction->operation)
+    {
+    case MVE_OP_JMP: case MVE_OP_JNZ: case MVE_OP_END: case MVE_OP_EOP: case MVE_OP_RET: case MVE_OP_TCALL: case MVE_OP_SWITCH: case MVE_OP_LOOP:
+        return MVE_TRUE;
+    default:
+        return MVE_FALSE;
+    }
+}
+
+
+/**
+ * @brief Splits the program into basic blocks. A block starts at the program start, at jump targets and after JMP, JNZ, LOOP, END, RET, TCALL, SWITCH and EOP.
+ * CALL and FCALL do not end a block, since END and RET come back right after them. END may also continue to the next instruction, if its scope was not called.
+ */
+static MVEbool layout_init(Layout *layout, Program *program, uint32_t size)
+{
+    memset(layout, 0, sizeof(Layout));
+
+    layout->program = program;
+    layout->size = size;
+    layout->previous = LAYOUT_NONE;
+
+    // Only programs where every jump goes to the start of an instruction can be moved.
+    for (uint32_t i = 0; i < program->count; i++) {
+        if (program->code[i].isa == NULL || (program_target_operand(&program->code[i]) >= 0 && program->code[i].target == PROGRAM_NO_TARGET))
+            return MVE_FALSE;
+
+        for (uint32_t j = 0; j < program->code[i].cases_count; j++) {
+            if (program->code[i].cases[j].target == PROGRAM_NO_TARGET)
+                return MVE_FALSE;
+        }
+    }
+
+    for (uint32_t i = 0; i < program->exports_count; i++) {
+        if (program->exports[i].target == PROGRAM_NO_TARGET)
+            return MVE_FALSE;
+    }
+
+    uint8_t *leaders = calloc(program->count + 1, 1);
+
+    leaders[0] = 1;
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        for (uint32_t j = 0; j < program_jumps_count(&program->code[i]); j++) {
+            if (program_jump(&program->code[i], j) != PROGRAM_NO_TARGET)
+                leaders[program_jump(&program->code[i], j)] = 1;
+        }
+
+        if (is_block_end(&program->code[i]))
+            leaders[i + 1] = 1;
+    }
+
+    for (uint32_t i = 0; i < program->exports_count; i++)
+        leaders[program->exports[i].target] = 1;
+
+    layout->block_of = malloc((program->count + 1) * sizeof(uint32_t));
+    layout->blocks = calloc(program->count + 1, sizeof(Layout_Block));
+
+    for (uint32_t i = 0; i < program->count; i++) {
+        if (leaders[i])
+            layout->blocks[layout->blocks_count++].first = i;
+
+        layout->block_of[i] = layout->blocks_count - 1;
+        layout->blocks[layout->blocks_count - 1].last = i;
+    }
+
+    // The end of the program, jumped to or reached by falling through, is like a block after the last one.
+    layout->block_of[program->count] = layout->blocks_count;
+
+    for (uint32_t b = 0; b < layout->blocks_count; b++) {
+        Layout_Block *block = &layout->blocks[b];
+        const Program_Instruction *last = &program->code[block->last];
+
+        block->fallthrough = last->operation == MVE_OP_JMP || last->operation == MVE_OP_EOP || last->operation == MVE_OP_RET || last->operation == MVE_OP_TCALL || last->operation == MVE_OP_SWITCH ? LAYOUT_NONE : b + 1;
+        block->jump = (last->operation == MVE_OP_JMP || last->operation == MVE_OP_JNZ || last->operation == MVE_OP_LOOP || last->operation == MVE_OP_TCALL || last->operation == MVE_OP_SWITCH) ? layout->block_of[last->target] : LAYOUT_NONE;
+        block->chain = b;
+        block->next = LAYOUT_NONE;
+        block->tail = b;
+    }
+
+    layout->instruction_at = malloc(size * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < size; i++)
+        layout->instruction_at[i] = LAYOUT_NONE;
+
+    for (uint32_t i = 0; i < program->count; i++)
+        layout->instruction_at[program->code[i].offset] = i;
+
+    free(leaders);
+
+    return MVE_TRUE;
+}
+
+
+static void layout_free(Layout *layout)
+{
+    for (uint32_t b = 0; b < layout->blocks_count; b++)
+        free(layout->blocks[b].edges);
+
+    free(layout->blocks);
+    free(layout->block_of);
+    free(layout->instruction_at);
+}
+
+
+/**
+ * @brief Records that the instruction at a program index was run, counting the blocks entered and the edges between blocks.
+ */
+static void layout_record(Layout *layout, uint32_t program_index)
+{
+    uint32_t instruction = program_index < layout->size ? layout->instruction_at[program_index] : LAYOUT_NONE;
+
+    if (instruction == LAYOUT_NONE)
+    {
+        layout->previous = LAYOUT_NONE;
+        return;
+    }
+
+    uint32_t block = layout->block_of[instruction];
+    uint32_t previous = layout->previous;
+
+    layout->previous = instruction;
+
+    if (instruction == layout->blocks[block].first)
+        layout->blocks[block].count++;
+    else if (previous != LAYOUT_NONE && layout->block_of[previous] == block)
+        return;
+
+    if (previous == LAYOUT_NONE)
+        return;
+
+    Layout_Block *from = &layout->blocks[layout->block_of[previous]];
+
+    for (uint32_t i = 0; i < from->edges_count; i++) {
+        if (from->edges[i].to == block)
+        {
+            from->edges[i].count++;
+            return;
+        }
+    }
+
+    from->edges = realloc(from->edges, (from->edges_count + 1) * sizeof(Layout_Edge));
+    from->edges[from->edges_count].to = block;
+    from->edges[from->edges_count].count = 1;
+    from->edges_count++;
+}
+
+
+/**
+ * @brief Records the profile from a binary trace of the same program.
+ */
+static MVEbool layout_read_trace(Layout *layout, const char *path)
+{
+    uint32_t size;
+    uint8_t *trace = files_read(path, &size);
+
+    if (trace == NULL || size < 13 || memcmp(trace, "MVET", 4) != 0)
+    {
+        free(trace);
+        return MVE_FALSE;
+    }
+
+    uint32_t registers_size = trace[6] * trace[8];
+    uint32_t entry_size = 6 + trace[7] + registers_size;
+    uint32_t count = isa_read_uint(trace + 9, 4);
+
+    for (uint32_t i = 0; i < count && 13 + (i + 1) * entry_size <= size; i++)
+        layout_record(layout, isa_read_uint(trace + 13 + i * entry_size, 4));
+
+    free(trace);
+
+    return MVE_TRUE;
+}
+
+
+/**
+ * @brief Runs a program in streaming mode, with a buffer of the given size.
+ *
+ * @param layout If not NULL, receives the profile of the run.
+ * @return Returns MVE_FALSE if the program failed.
+ */
+static MVEbool layout_run(const uint8_t *bytes, uint32_t size, uint32_t buffer_size, unsigned long long max_instructions, Layout *layout, MVE_Loader_Stats *stats, unsigned long long *instructions)
+{
+    static MVE_VM vm;
+    static MVE_Arena arena;
+
+    MVE_Config config = { 0, 0, 0, buffer_size };
+    volatile unsigned long long count = 0;
+
+    runner_set_program(bytes, size);
+
+    *instructions = 0;
+
+    if (setjmp(error_jump) != 0)
+    {
+        fprintf(stderr, "The program failed after %llu instructions.\n", count);
+        return MVE_FALSE;
+    }
+
+    memset(&vm, 0, sizeof(vm));
+    mve_arena_init(&arena, arena_memory, sizeof(arena_memory));
+    mve_configure(&vm, &config, &arena);
+
+    if (!mve_init(&vm, &runner_load_next_block))
+        return MVE_FALSE;
+
+    runner_link(&vm);
+
+    mve_start(&vm);
+
+    while (mve_is_running(&vm) && count < max_instructions) {
+        if (layout != NULL)
+            layout_record(layout, mve_get_program_index(&vm));
+
+        mve_run(&vm);
+        count++;
+    }
+
+    *stats = *mve_loader_stats_get(&vm);
+    *instructions = count;
+
+    return MVE_TRUE;
+}
+
+
+static uint64_t layout_edge_count(const Layout *layout, uint32_t from, uint32_t to)
+{
+    for (uint32_t i = 0; i < layout->blocks[from].edges_count; i++) {
+        if (layout->blocks[from].edges[i].to == to)
+            return layout->blocks[from].edges[i].count;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Joins blocks into chains, from the hottest edge to the coldest, when the edge can be a fall through or a jump to the next block.
+ * The first block is never placed after another, since the program starts there.
+ */
+static void layout_chains(Layout *layout)
+{
+    while (MVE_TRUE) {
+        uint64_t best = 0;
+        uint32_t best_from = LAYOUT_NONE;
+        uint32_t best_to = LAYOUT_NONE;
+
+        for (uint32_t b = 0; b < layout->blocks_count; b++) {
+            const Layout_Block *block = &layout->blocks[b];
+            uint32_t successors[2] = { block->fallthrough, block->jump };
+
+            if (block->next != LAYOUT_NONE)
+                continue;
+
+            for (uint8_t s = 0; s < 2; s++) {
+                uint32_t to = successors[s];
+
+                if (to == LAYOUT_NONE || to == 0 || to >= layout->blocks_count || layout->blocks[to].chain != to || layout->blocks[to].chain == block->chain)
+                    continue;
+
+                uint64_t count = layout_edge_count(layout, b, to);
+
+                if (count > best)
+                {
+                    best = count;
+                    best_from = b;
+                    best_to = to;
+                }
+            }
+        }
+
+        if (best_from == LAYOUT_NONE)
+            break;
+
+        uint32_t head = layout->blocks[best_from].chain;
+
+        layout->blocks[best_from].next = best_to;
+        layout->blocks[head].tail = layout->blocks[best_to].tail;
+
+        for (uint32_t b = best_to; b != LAYOUT_NONE; b = layout->blocks[b].next)
+            layout->blocks[b].chain = head;
+    }
+}
+
+
+/**
+ * @brief Orders the chains, starting with the one of the first block. The next chain is the one most connected to the last chain placed,
+ * then to any chain placed. Chains that are not connected keep their original order.
+ *
+ * @param order Receives the blocks in their new order.
+ */
+static void layout_order(Layout *layout, uint32_t *order)
+{
+    uint32_t count = layout->blocks_count;
+    uint8_t *placed = calloc(count, 1);
+    uint64_t *to_last = malloc(count * sizeof(uint64_t));
+    uint64_t *to_any = calloc(count, sizeof(uint64_t));
+    uint32_t placed_count = 0;
+    uint32_t chain = 0;
+
+    while (chain != LAYOUT_NONE) {
+        for (uint32_t b = chain; b != LAYOUT_NONE; b = layout->blocks[b].next)
+            order[placed_count++] = b;
+
+        placed[chain] = 1;
+        memset(to_last, 0, count * sizeof(uint64_t));
+
+        // Connections of the unplaced chains to the chain just placed, in both directions.
+        for (uint32_t b = 0; b < count; b++) {
+            for (uint32_t e = 0; e < layout->blocks[b].edges_count; e++) {
+                uint32_t to = layout->blocks[b].edges[e].to;
+
+                if (to >= count)
+                    continue;
+
+                uint32_t from_chain = layout->blocks[b].chain;
+                uint32_t to_chain = layout->blocks[to].chain;
+                uint64_t weight = layout->blocks[b].edges[e].count;
+
+                if (from_chain == chain && !placed[to_chain])
+                    to_last[to_chain] += weight;
+                else if (to_chain == chain && !placed[from_chain])
+                    to_last[from_chain] += weight;
+            }
+        }
+
+        chain = LAYOUT_NONE;
+
+        for (uint32_t b = 0; b < count; b++) {
+            if (layout->blocks[b].chain != b || placed[b])
+                continue;
+
+            to_any[b] += to_last[b];
+
+            if (chain == LAYOUT_NONE || to_last[b] > to_last[chain] || (to_last[b] == to_last[chain] && to_any[b] > to_any[chain]))
+                chain = b;
+        }
+    }
+
+    free(placed);
+    free(to_last);
+    free(to_any);
+}
+
+
+/**
+ * @brief Builds the program with the blocks in a new order. JMPs are added where a block does not fall through to its original next block anymore.
+ */
+static void layout_build(Layout *layout, const uint32_t *order, Program *out)
+{
+    Program *program = layout->program;
+    uint32_t *new_index = malloc((program->count + 1) * sizeof(uint32_t));
+
+    program_init(out);
+
+    out->major_version = program->major_version;
+    out->minor_version = program->minor_version;
+
+    for (uint32_t i = 0; i < program->sections_count; i++)
+        program_add_section(out, program->sections[i].tag, program->sections[i].data, program->sections[i].length);
+
+    for (uint32_t i = 0; i < program->names_count; i++)
+        program_add_name(out, program->names[i]);
+
+    for (uint32_t i = 0; i < program->exports_count; i++)
+        program_add_export(out, program->exports[i].name, program->exports[i].offset, program->exports[i].target);
+
+    out->data = malloc(program->data_length > 0 ? program->data_length : 1);
+    memcpy(out->data, program->data, program->data_length);
+    out->data_length = program->data_length;
+    out->zero_length = program->zero_length;
+
+    for (uint32_t k = 0; k < layout->blocks_count; k++) {
+        const Layout_Block *block = &layout->blocks[order[k]];
+
+        for (uint32_t i = block->first; i <= block->last; i++) {
+            Program_Instruction *instruction = program_append(out, program->code[i].operation);
+
+            *instruction = program->code[i];
+
+            if (program->code[i].data != NULL)
+            {
+                instruction->data = malloc(program->code[i].data_length > 0 ? program->code[i].data_length : 1);
+                memcpy(instruction->data, program->code[i].data, program->code[i].data_length);
+            }
+
+            if (program->code[i].cases != NULL)
+            {
+                instruction->cases = malloc(program->code[i].cases_count * sizeof(Program_Case));
+                memcpy(instruction->cases, program->code[i].cases, program->code[i].cases_count * sizeof(Program_Case));
+            }
+
+            new_index[i] = out->count - 1;
+        }
+
+        uint32_t next = k + 1 < layout->blocks_count ? order[k + 1] : layout->blocks_count;
+
+        // The target is the original instruction, like the other jumps, until all of them are moved.
+        if (block->fallthrough != LAYOUT_NONE && block->fallthrough != next)
+            program_append(out, MVE_OP_JMP)->target = block->fallthrough < layout->blocks_count ? layout->blocks[block->fallthrough].first : program->count;
+    }
+
+    new_index[program->count] = out->count;
+
+    for (uint32_t i = 0; i < out->exports_count; i++)
+        out->exports[i].target = new_index[out->exports[i].target];
+
+    for (uint32_t i = 0; i < out->count; i++) {
+        for (uint32_t j = 0; j < program_jumps_count(&out->code[i]); j++) {
+            if (program_jump(&out->code[i], j) != PROGRAM_NO_TARGET)
+                program_set_jump(&out->code[i], j, new_index[program_jump(&out->code[i], j)]);
+        }
+    }
+
+    free(new_index);
+
+    // Remove the JMPs whose target became the next block.
+    Peephole_Stats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    peephole_jumps(out, &stats);
+}
+
+
+static void print_stats(const char *name, const MVE_Loader_Stats *stats, uint32_t size, unsigned long long instructions)
+{
+    printf("%-8s %10u %10u %10u %10u %12llu %10u %14llu\n", name, stats->sequential_loads + stats->jump_loads + stats->direct_loads,
+        stats->sequential_loads, stats->jump_loads, stats->direct_loads, (unsigned long long) stats->bytes, size, instructions);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    const char *trace = NULL;
+    uint32_t buffer_size = MVE_BUFFER_SIZE;
+    unsigned long long max_instructions = 100000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            trace = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            buffer_size = (uint32_t) strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            max_instructions = strtoull(argv[++i], NULL, 10);
+        else
+            input = argv[i];
+    }
+
+    if (input == NULL || output == NULL || buffer_size < 32)
+    {
+        fprintf(stderr, "Usage: %s [-w buffer size] [-t trace file] [-n max instructions] <program file> -o <output>\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t *bytes = files_read(input, &size);
+    Program program;
+    Layout layout;
+
+    if (bytes == NULL || program_decode(&program, bytes, size) != 0)
+    {
+        fprintf(stderr, "Cannot read the program %s.\n", input);
+        return 1;
+    }
+
+    if (!layout_init(&layout, &program, size))
+    {
+        fprintf(stderr, "%s has unknown OPs or jumps into the middle of instructions, so its blocks cannot be moved.\n", input);
+        return 1;
+    }
+
+    MVE_Loader_Stats before;
+    MVE_Loader_Stats after;
+    unsigned long long before_instructions;
+    unsigned long long after_instructions;
+
+    if (trace != NULL && !layout_read_trace(&layout, trace))
+    {
+        fprintf(stderr, "Cannot read the trace %s.\n", trace);
+        return 1;
+    }
+
+    if (!layout_run(bytes, size, buffer_size, max_instructions, trace == NULL ? &layout : NULL, &before, &before_instructions))
+        return 1;
+
+    uint32_t *order = malloc(layout.blocks_count * sizeof(uint32_t));
+    Program reordered;
+    uint32_t new_size;
+
+    layout_chains(&layout);
+    layout_order(&layout, order);
+    layout_build(&layout, order, &reordered);
+
+    uint8_t *new_bytes = program_encode(&reordered, &new_size);
+
+    if (!layout_run(new_bytes, new_size, buffer_size, max_instructions, NULL, &after, &after_instructions))
+        return 1;
+
+    printf("%u blocks, buffer of %u bytes.\n\n", layout.blocks_count, buffer_size);
+    printf("%-8s %10s %10s %10s %10s %12s %10s %14s\n", "", "reloads", "sequential", "jump", "direct", "bytes loaded", "size", "instructions");
+    print_stats("before", &before, size, before_instructions);
+    print_stats("after", &after, new_size, after_instructions);
+
+    uint32_t before_loads = before.sequential_loads + before.jump_loads + before.direct_loads;
+    uint32_t after_loads = after.sequential_loads + after.jump_loads + after.direct_loads;
+    int result;
+
+    if (after_loads < before_loads)
+    {
+        result = files_write(output, new_bytes, new_size);
+    }
+    else
+    {
+        printf("\nThe new layout does not reduce the reloads, so the program is written unchanged.\n");
+        result = files_write(output, bytes, size);
+    }
+
+    if (result != 0)
+        fprintf(stderr, "Cannot write %s.\n", output);
+
+    free(order);
+    free(new_bytes);
+    free(bytes);
+    program_free(&reordered);
+    program_free(&program);
+    layout_free(&layout);
+
+    return result != 0 ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Decodes a binary trace, written by mve_trace_write_binary, into text.
+ * Each line has the program index, the instruction with its operands and the registers it changed.
+ *
+ * Usage: trace_decode <trace file>
+ */
+
+// The trace format version is only declared when tracing is enabled.
+#define MVE_TRACE
+
+#include "../common/isa.h"
+
+
+static uint64_t read_value(const uint8_t *bytes, uint8_t length)
+{
+    uint64_t value = 0;
+
+    for (uint8_t i = 0; i < length && i < 8; i++)
+        value |= (uint64_t) bytes[i] << (i * 8);
+
+    return value;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Cannot open %s.\n", argv[1]);
+        return 1;
+    }
+
+    uint8_t header[13];
+
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, "MVET", 4) != 0)
+    {
+        fprintf(stderr, "%s is not a MicroVE trace.\n", argv[1]);
+        return 1;
+    }
+
+    uint16_t version = (uint16_t) read_value(header + 4, 2);
+
+    if (version != MVE_TRACE_FORMAT_VERSION)
+    {
+        fprintf(stderr, "Unsupported trace format version %u.\n", version);
+        return 1;
+    }
+
+    uint8_t registers_count = header[6];
+    uint8_t operands_size = header[7];
+    uint8_t register_size = header[8];
+    uint32_t count = (uint32_t) read_value(header + 9, 4);
+
+    uint32_t entry_size = 6 + operands_size + registers_count * register_size;
+    uint8_t *entry = malloc(entry_size);
+    uint8_t *previous = malloc(entry_size);
+
+    for (uint32_t i = 0; i < count && fread(entry, entry_size, 1, file) == 1; i++) {
+        uint32_t program_index = (uint32_t) read_value(entry, 4);
+        uint8_t operation = entry[4];
+        uint8_t operands_length = entry[5];
+        const ISA_Instruction *instruction = isa_find(operation);
+
+        char operands[256] = "";
+
+        if (instruction != NULL)
+        {
+            uint32_t available = operands_length < operands_size ? operands_length : operands_size;
+            isa_format_operands(instruction, entry + 6, available, operands, sizeof(operands));
+
+            printf("%8u  %-6s%-32s |", program_index, instruction->name, operands);
+        }
+        else
+        {
+            printf("%8u  OP %-29u |", program_index, operation);
+        }
+
+        const uint8_t *registers = entry + 6 + operands_size;
+
+        for (uint8_t j = 0; j < registers_count; j++) {
+            uint64_t value = read_value(registers + j * register_size, register_size);
+
+            if (i > 0 && value == read_value(previous + 6 + operands_size + j * register_size, register_size))
+                continue;
+
+            if (j < 7)
+                printf(" %s=%llu", isa_register_names[j], (unsigned long long) value);
+            else
+                printf(" r%u=%llu", j, (unsigned long long) value);
+        }
+
+        printf("\n");
+
+        uint8_t *swap = previous;
+        previous = entry;
+        entry = swap;
+    }
+
+    free(entry);
+    free(previous);
+    fclose(file);
+
+    return 0;
+}
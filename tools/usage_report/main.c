@@ -0,0 +1,141 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Runs a set of program files, as described in tools/common/runner.h, and recommends the smallest config values that fit all of them.
+ *
+ * Usage: usage_report [-n max instructions] <program files...>
+ */
+
+#define MVE_TRACK_USAGE
+#define MVE_USAGE_BLOCKS 4096
+
+#define MVE_BUFFER_SIZE 64
+#define MVE_STACK_SIZE 65536
+#define MVE_MEMORY_SIZE 65536
+#define MVE_EXTERNAL_FUNCTIONS_LIMIT 256
+#define MVE_USE_BYTE_OPS
+#define MVE_USE_REGIONS
+
+// The scopes and frames grow, up to MVE_SCOPE_MAX and MVE_FRAME_MAX, so deep calls are measured instead of failing.
+#define MVE_GROWABLE_SCOPES
+
+static jmp_buf error_jump;
+
+#define MVE_ERROR_LOG(vm, program_index, error_id, msg) { fprintf(stderr, "  %s Program index: %u.\n", msg, (unsigned) (program_index)); longjmp(error_jump, 1); }
+
+#include "../../src/mve.c"
+#include "../common/files.h"
+#include "../common/runner.h"
+
+
+int main(int argc, char **argv)
+{
+    static MVE_VM vm;
+
+    unsigned long long max_instructions = 100000000;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        max_instructions = strtoull(argv[2], NULL, 10);
+        first = 3;
+    }
+
+    if (first >= argc)
+    {
+        fprintf(stderr, "Usage: %s [-n max instructions] <program files...>\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t stack_size = 0;
+    uint32_t memory_size = 0;
+    uint32_t scope_limit = 0;
+    uint32_t frame_limit = 0;
+    uint32_t external_functions = 0;
+    uint32_t failed = 0;
+
+    printf("%-32s %10s %10s %8s %8s %8s %12s\n", "program", "stack", "memory", "scopes", "frames", "blocks", "instructions");
+
+    uint8_t *program = NULL;
+
+    for (int i = first; i < argc; i++) {
+        uint32_t program_size = 0;
+
+        free(program);
+        program = files_read(argv[i], &program_size);
+
+        if (program == NULL)
+        {
+            fprintf(stderr, "Cannot read %s.\n", argv[i]);
+            failed++;
+            continue;
+        }
+
+        runner_set_program(program, program_size);
+
+        volatile unsigned long long instructions = 0;
+
+        if (setjmp(error_jump) != 0)
+        {
+            fprintf(stderr, "%s failed after %llu instructions.\n", argv[i], instructions);
+            failed++;
+            continue;
+        }
+
+        mve_release(&vm);
+
+        if (!mve_init(&vm, &runner_load_next_block))
+        {
+            fprintf(stderr, "%s is not a valid program.\n", argv[i]);
+            failed++;
+            continue;
+        }
+
+        runner_link(&vm);
+
+        if (vm.external_functions_count > external_functions)
+            external_functions = vm.external_functions_count;
+
+        mve_start(&vm);
+
+        while (mve_is_running(&vm) && instructions < max_instructions) {
+            mve_run(&vm);
+            instructions++;
+        }
+
+        if (mve_is_running(&vm))
+            fprintf(stderr, "%s stopped after %llu instructions.\n", argv[i], instructions);
+
+        const MVE_Usage *usage = mve_usage_get(&vm);
+
+        printf("%-32s %10u %10u %8u %8u %8u %12llu\n", argv[i], usage->peak_stack, usage->peak_memory, usage->peak_scope + 1, usage->peak_frame, usage->blocks_loaded, instructions);
+
+        if (usage->peak_stack > stack_size)
+            stack_size = usage->peak_stack;
+
+        if (usage->peak_memory > memory_size)
+            memory_size = usage->peak_memory;
+
+        if (usage->peak_scope + 1 > scope_limit)
+            scope_limit = usage->peak_scope + 1;
+
+        if (usage->peak_frame > frame_limit)
+            frame_limit = usage->peak_frame;
+    }
+
+    // The memory addresses are checked including the end, so one more byte is needed than the highest pointer.
+    // mve.h does not build with less than 4 scopes.
+    printf("\nRecommended config:\n");
+    printf("#define MVE_STACK_SIZE %u\n", stack_size + 1);
+    printf("#define MVE_MEMORY_SIZE %u\n", memory_size + 1);
+    printf("#define MVE_SCOPE_LIMIT %u\n", scope_limit > 4 ? scope_limit : 4);
+    printf("#define MVE_FRAME_LIMIT %u\n", frame_limit > 0 ? frame_limit : 1);
+    printf("#define MVE_EXTERNAL_FUNCTIONS_LIMIT %u\n", external_functions > 0 ? external_functions : 1);
+
+    free(program);
+
+    return failed > 0 ? 2 : 0;
+}